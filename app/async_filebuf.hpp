@@ -0,0 +1,253 @@
+#pragma once
+
+#include "../common/sepia.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+namespace gen4 {
+    /// async_filebuf is a stream buffer that hands full chunks to a writer thread.
+    /// The producer only copies bytes into preallocated chunks, while system calls happen on the writer thread.
+    /// Files can be closed and reopened without restarting the thread or reallocating chunks, and closing does not
+    /// wait for pending chunks to reach the disk.
+    class async_filebuf : public std::streambuf {
+        public:
+        /// statistics summarises the writer activity.
+        struct statistics {
+            uint64_t bytes_submitted;
+            uint64_t bytes_written;
+            std::size_t queue_depth;
+            std::size_t chunks_count;
+            std::chrono::nanoseconds maximum_write_duration;
+            uint64_t writes;
+            std::chrono::nanoseconds total_write_duration;
+        };
+
+        async_filebuf(std::size_t chunk_size, std::size_t chunks_count) :
+            _chunks(chunks_count, std::vector<char>(chunk_size)),
+            _file(nullptr),
+            _active_chunk(chunks_count),
+            _running(true),
+            _bytes_submitted(0),
+            _bytes_written(0),
+            _maximum_write_duration(0),
+            _writes(0),
+            _total_write_duration(0),
+            _queue_depth(0) {
+            if (chunk_size == 0 || chunks_count < 2) {
+                throw std::logic_error("async_filebuf requires a non-zero chunk size and at least two chunks");
+            }
+            _available_chunks.reserve(chunks_count);
+            for (std::size_t index = 0; index < chunks_count; ++index) {
+                _available_chunks.push_back(index);
+            }
+            _writer = std::thread([this]() {
+                std::unique_lock<std::mutex> lock(_mutex);
+                for (;;) {
+                    _queue_changed.wait(lock, [this]() { return !_queue.empty() || !_running; });
+                    if (_queue.empty()) {
+                        break;
+                    }
+                    const auto entry = _queue.front();
+                    _queue.pop_front();
+                    _queue_depth.store(_queue.size(), std::memory_order_relaxed);
+                    lock.unlock();
+                    if (entry.chunk < _chunks.size()) {
+                        const auto begin = std::chrono::steady_clock::now();
+                        const auto written = std::fwrite(_chunks[entry.chunk].data(), 1, entry.size, entry.file);
+                        const auto duration = std::chrono::steady_clock::now() - begin;
+                        _bytes_written.fetch_add(written, std::memory_order_relaxed);
+                        _writes.store(_writes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                        _total_write_duration.store(
+                            _total_write_duration.load(std::memory_order_relaxed)
+                                + std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+                            std::memory_order_relaxed);
+                        if (std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()
+                            > _maximum_write_duration.load(std::memory_order_relaxed)) {
+                            _maximum_write_duration.store(
+                                std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+                                std::memory_order_relaxed);
+                        }
+                        lock.lock();
+                        if (written != entry.size && !_exception) {
+                            _exception = std::make_exception_ptr(std::runtime_error("writing to a file failed"));
+                        }
+                        _available_chunks.push_back(entry.chunk);
+                        _chunk_available.notify_one();
+                    } else {
+                        std::fclose(entry.file);
+                        lock.lock();
+                    }
+                }
+            });
+        }
+        async_filebuf(const async_filebuf&) = delete;
+        async_filebuf(async_filebuf&&) = delete;
+        async_filebuf& operator=(const async_filebuf&) = delete;
+        async_filebuf& operator=(async_filebuf&&) = delete;
+        virtual ~async_filebuf() {
+            if (_file) {
+                close();
+            }
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _running = false;
+            }
+            _queue_changed.notify_one();
+            _writer.join();
+        }
+
+        /// open starts writing to a new file.
+        virtual void open(const std::string& filename) {
+            if (_file) {
+                close();
+            }
+            _file = std::fopen(filename.c_str(), "wb");
+            if (!_file) {
+                throw sepia::unwritable_file(filename);
+            }
+            std::setvbuf(_file, nullptr, _IONBF, 0);
+            acquire_chunk();
+        }
+
+        /// close submits the buffered bytes and schedules the file closure.
+        virtual void close() {
+            if (_file) {
+                submit_chunk();
+                std::lock_guard<std::mutex> lock(_mutex);
+                _queue.push_back({_chunks.size(), 0, _file});
+                _queue_depth.store(_queue.size(), std::memory_order_relaxed);
+                _file = nullptr;
+                _queue_changed.notify_one();
+            }
+        }
+
+        /// is_open returns true if a file is open.
+        virtual bool is_open() const {
+            return _file != nullptr;
+        }
+
+        /// writer returns the writer thread, for instance to pin it.
+        virtual std::thread& writer() {
+            return _writer;
+        }
+
+        /// get_statistics returns the writer activity and resets the maximum write duration.
+        /// It can be called from any thread. Bytes still in the active chunk are not counted as submitted.
+        virtual statistics get_statistics() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return {
+                _bytes_submitted.load(std::memory_order_relaxed),
+                _bytes_written.load(std::memory_order_relaxed),
+                _queue.size(),
+                _chunks.size(),
+                std::chrono::nanoseconds(_maximum_write_duration.exchange(0, std::memory_order_relaxed)),
+                _writes.load(std::memory_order_relaxed),
+                std::chrono::nanoseconds(_total_write_duration.load(std::memory_order_relaxed)),
+            };
+        }
+
+        /// get_cumulative_statistics returns the writer activity without resetting the maximum write duration.
+        /// The returned maximum write duration is the current value. Unlike get_statistics, it does not lock the queue.
+        virtual statistics get_cumulative_statistics() const {
+            return {
+                _bytes_submitted.load(std::memory_order_relaxed),
+                _bytes_written.load(std::memory_order_relaxed),
+                _queue_depth.load(std::memory_order_relaxed),
+                _chunks.size(),
+                std::chrono::nanoseconds(_maximum_write_duration.load(std::memory_order_relaxed)),
+                _writes.load(std::memory_order_relaxed),
+                std::chrono::nanoseconds(_total_write_duration.load(std::memory_order_relaxed)),
+            };
+        }
+
+        protected:
+        /// entry represents a chunk waiting for the writer thread.
+        /// chunk is equal to the number of chunks for closure entries.
+        struct entry {
+            std::size_t chunk;
+            std::size_t size;
+            std::FILE* file;
+        };
+
+        /// overflow submits the active chunk when it is full.
+        virtual int_type overflow(int_type character) override {
+            if (!_file) {
+                return traits_type::eof();
+            }
+            submit_chunk();
+            acquire_chunk();
+            if (!traits_type::eq_int_type(character, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(character);
+                pbump(1);
+            }
+            return traits_type::not_eof(character);
+        }
+
+        /// sync submits the active chunk, even if it is not full.
+        virtual int sync() override {
+            if (_file && pptr() != pbase()) {
+                submit_chunk();
+                acquire_chunk();
+            }
+            return 0;
+        }
+
+        /// acquire_chunk waits for an available chunk and makes it the put area.
+        virtual void acquire_chunk() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _chunk_available.wait(lock, [this]() { return !_available_chunks.empty(); });
+            if (_exception) {
+                auto exception = _exception;
+                _exception = nullptr;
+                std::rethrow_exception(exception);
+            }
+            _active_chunk = _available_chunks.back();
+            _available_chunks.pop_back();
+            auto& chunk = _chunks[_active_chunk];
+            setp(chunk.data(), chunk.data() + chunk.size());
+        }
+
+        /// submit_chunk sends the active chunk to the writer thread.
+        virtual void submit_chunk() {
+            if (_active_chunk < _chunks.size()) {
+                const auto size = static_cast<std::size_t>(pptr() - pbase());
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (size == 0) {
+                    _available_chunks.push_back(_active_chunk);
+                } else {
+                    _queue.push_back({_active_chunk, size, _file});
+                    _queue_depth.store(_queue.size(), std::memory_order_relaxed);
+                    _bytes_submitted.fetch_add(size, std::memory_order_relaxed);
+                    _queue_changed.notify_one();
+                }
+                _active_chunk = _chunks.size();
+                setp(nullptr, nullptr);
+            }
+        }
+
+        std::vector<std::vector<char>> _chunks;
+        std::FILE* _file;
+        std::size_t _active_chunk;
+        bool _running;
+        std::vector<std::size_t> _available_chunks;
+        std::deque<entry> _queue;
+        std::exception_ptr _exception;
+        std::mutex _mutex;
+        std::condition_variable _queue_changed;
+        std::condition_variable _chunk_available;
+        std::atomic<uint64_t> _bytes_submitted;
+        std::atomic<uint64_t> _bytes_written;
+        std::atomic<int64_t> _maximum_write_duration;
+        std::atomic<uint64_t> _writes;
+        std::atomic<int64_t> _total_write_duration;
+        std::atomic<std::size_t> _queue_depth;
+        std::thread _writer;
+    };
+}
@@ -4,6 +4,7 @@ local dependencies = {
     blob_display = {'background_cleaner'},
     color_display = {'background_cleaner'},
     delta_t_display = {'background_cleaner'},
+    dvs_array_display = {'background_cleaner'},
     dvs_display = {'background_cleaner'},
     flow_display = {'background_cleaner'},
     frame_generator = {'grey_display'},
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "percentile_histogram.hpp"
 #include <QQmlParserStatus>
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLFunctions_3_3_Core>
@@ -29,6 +30,7 @@ namespace chameleon {
             _discards_changed(false),
             _automatic_calibration(true),
             _program_setup(false) {
+            _histogram.add(std::numeric_limits<uint32_t>::max(), _counts.size());
             _accessing_counts.clear(std::memory_order_release);
             _accessing_discards.clear(std::memory_order_release);
         }
@@ -80,7 +82,20 @@ namespace chameleon {
                 static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * _canvas_size.width();
             while (_accessing_counts.test_and_set(std::memory_order_acquire)) {
             }
-            _counts[index] = static_cast<uint32_t>(event.count);
+            set_count(index, static_cast<uint32_t>(event.count));
+            _accessing_counts.clear(std::memory_order_release);
+        }
+
+        /// push_range adds several events to the display with a single lock.
+        template <typename Iterator>
+        void push_range(Iterator begin, Iterator end) {
+            while (_accessing_counts.test_and_set(std::memory_order_acquire)) {
+            }
+            for (; begin != end; ++begin) {
+                set_count(
+                    static_cast<std::size_t>(begin->x) + static_cast<std::size_t>(begin->y) * _canvas_size.width(),
+                    static_cast<uint32_t>(begin->count));
+            }
             _accessing_counts.clear(std::memory_order_release);
         }
 
@@ -90,6 +105,12 @@ namespace chameleon {
             while (_accessing_counts.test_and_set(std::memory_order_acquire)) {
             }
             _counts.assign(begin, end);
+            _histogram.clear();
+            for (auto count : _counts) {
+                if (calibrated(count)) {
+                    _histogram.add(count);
+                }
+            }
             _accessing_counts.clear(std::memory_order_release);
         }
 
@@ -300,29 +321,24 @@ namespace chameleon {
                 while (_accessing_counts.test_and_set(std::memory_order_acquire)) {
                 }
                 std::copy(_counts.begin(), _counts.end(), buffer);
+                _calibration_histogram = _histogram;
                 _accessing_counts.clear(std::memory_order_release);
                 while (_accessing_discards.test_and_set(std::memory_order_acquire)) {
                 }
                 if (_automatic_calibration) {
                     auto previous_discards = _discards;
-                    std::vector<uint32_t> sorted_counts(_counts.size());
-                    const auto end =
-                        std::copy_if(buffer, buffer + _counts.size(), sorted_counts.begin(), [](uint32_t count) {
-                            return count > 1;
-                        });
-                    const auto size = static_cast<std::size_t>(std::distance(sorted_counts.begin(), end));
+                    const auto size = _calibration_histogram.size();
                     if (size > 0) {
-                        std::sort(sorted_counts.begin(), end);
                         auto white_discard_candidate =
-                            sorted_counts[static_cast<std::size_t>(size * (1.0f - _discard_ratio))];
+                            _calibration_histogram.at(static_cast<uint64_t>(size * (1.0f - _discard_ratio)));
                         auto black_discard_candidate =
-                            sorted_counts[static_cast<std::size_t>(size * _discard_ratio + 0.5f)];
+                            _calibration_histogram.at(static_cast<uint64_t>(size * _discard_ratio + 0.5f));
                         if (white_discard_candidate > black_discard_candidate) {
                             _discards.setX(black_discard_candidate);
                             _discards.setY(white_discard_candidate);
                         } else {
-                            black_discard_candidate = sorted_counts.front();
-                            white_discard_candidate = *std::prev(end);
+                            black_discard_candidate = _calibration_histogram.front();
+                            white_discard_candidate = _calibration_histogram.back();
                             if (white_discard_candidate > black_discard_candidate) {
                                 _discards.setX(black_discard_candidate);
                                 _discards.setY(white_discard_candidate);
@@ -354,6 +370,23 @@ namespace chameleon {
         }
 
         protected:
+        /// calibrated returns true if the count is used to compute the discards.
+        static bool calibrated(uint32_t count) {
+            return count > 1;
+        }
+
+        /// set_count updates a pixel and the calibration histogram.
+        /// The caller must hold _accessing_counts.
+        void set_count(std::size_t index, uint32_t count) {
+            if (calibrated(_counts[index])) {
+                _histogram.remove(_counts[index]);
+            }
+            if (calibrated(count)) {
+                _histogram.add(count);
+            }
+            _counts[index] = count;
+        }
+
         /// check_opengl_error throws if openGL generated an error.
         virtual void check_opengl_error() {
             switch (glGetError()) {
@@ -400,6 +433,8 @@ namespace chameleon {
         float _discard_ratio;
         std::size_t _colormap;
         std::vector<uint32_t> _counts;
+        percentile_histogram _histogram;
+        percentile_histogram _calibration_histogram;
         std::atomic_flag _accessing_counts;
         QRectF _clear_area;
         QRectF _paint_area;
@@ -523,6 +558,14 @@ namespace chameleon {
             _count_display_renderer->push<Event>(event);
         }
 
+        /// push_range adds several events to the display with a single lock.
+        template <typename Iterator>
+        void push_range(Iterator begin, Iterator end) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _count_display_renderer->push_range<Iterator>(begin, end);
+        }
+
         /// assign sets all the pixels at once.
         template <typename Iterator>
         void assign(Iterator begin, Iterator end) {
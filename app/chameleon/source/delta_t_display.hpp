@@ -1,5 +1,6 @@
 #pragma once
 
+#include "percentile_histogram.hpp"
 #include <QQmlParserStatus>
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLFunctions_3_3_Core>
@@ -80,7 +81,7 @@ namespace chameleon {
                 static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * _canvas_size.width();
             while (_accessing_delta_ts.test_and_set(std::memory_order_acquire)) {
             }
-            _delta_ts[index] = static_cast<uint32_t>(event.delta_t);
+            set_delta_t(index, static_cast<uint32_t>(event.delta_t));
             _accessing_delta_ts.clear(std::memory_order_release);
         }
 
@@ -90,6 +91,12 @@ namespace chameleon {
             while (_accessing_delta_ts.test_and_set(std::memory_order_acquire)) {
             }
             _delta_ts.assign(begin, end);
+            _histogram.clear();
+            for (auto delta_t : _delta_ts) {
+                if (calibrated(delta_t)) {
+                    _histogram.add(delta_t);
+                }
+            }
             _accessing_delta_ts.clear(std::memory_order_release);
         }
 
@@ -300,29 +307,24 @@ namespace chameleon {
                 while (_accessing_delta_ts.test_and_set(std::memory_order_acquire)) {
                 }
                 std::copy(_delta_ts.begin(), _delta_ts.end(), buffer);
+                _calibration_histogram = _histogram;
                 _accessing_delta_ts.clear(std::memory_order_release);
                 while (_accessing_discards.test_and_set(std::memory_order_acquire)) {
                 }
                 if (_automatic_calibration) {
                     auto previous_discards = _discards;
-                    std::vector<uint32_t> sorted_delta_ts(_delta_ts.size());
-                    const auto end =
-                        std::copy_if(buffer, buffer + _delta_ts.size(), sorted_delta_ts.begin(), [](uint32_t delta_t) {
-                            return delta_t < std::numeric_limits<uint32_t>::max();
-                        });
-                    const auto size = static_cast<std::size_t>(std::distance(sorted_delta_ts.begin(), end));
+                    const auto size = _calibration_histogram.size();
                     if (size > 0) {
-                        std::sort(sorted_delta_ts.begin(), end);
                         auto black_discard_candidate =
-                            sorted_delta_ts[static_cast<std::size_t>(size * (1.0f - _discard_ratio))];
+                            _calibration_histogram.at(static_cast<uint64_t>(size * (1.0f - _discard_ratio)));
                         auto white_discard_candidate =
-                            sorted_delta_ts[static_cast<std::size_t>(size * _discard_ratio + 0.5f)];
+                            _calibration_histogram.at(static_cast<uint64_t>(size * _discard_ratio + 0.5f));
                         if (black_discard_candidate > white_discard_candidate) {
                             _discards.setX(black_discard_candidate);
                             _discards.setY(white_discard_candidate);
                         } else {
-                            black_discard_candidate = *std::prev(end);
-                            white_discard_candidate = sorted_delta_ts.front();
+                            black_discard_candidate = _calibration_histogram.back();
+                            white_discard_candidate = _calibration_histogram.front();
                             if (black_discard_candidate > white_discard_candidate) {
                                 _discards.setX(black_discard_candidate);
                                 _discards.setY(white_discard_candidate);
@@ -354,6 +356,23 @@ namespace chameleon {
         }
 
         protected:
+        /// calibrated returns true if the time difference is used to compute the discards.
+        static bool calibrated(uint32_t delta_t) {
+            return delta_t < std::numeric_limits<uint32_t>::max();
+        }
+
+        /// set_delta_t updates a pixel and the calibration histogram.
+        /// The caller must hold _accessing_delta_ts.
+        void set_delta_t(std::size_t index, uint32_t delta_t) {
+            if (calibrated(_delta_ts[index])) {
+                _histogram.remove(_delta_ts[index]);
+            }
+            if (calibrated(delta_t)) {
+                _histogram.add(delta_t);
+            }
+            _delta_ts[index] = delta_t;
+        }
+
         /// check_opengl_error throws if openGL generated an error.
         virtual void check_opengl_error() {
             switch (glGetError()) {
@@ -400,6 +419,8 @@ namespace chameleon {
         float _discard_ratio;
         std::size_t _colormap;
         std::vector<uint32_t> _delta_ts;
+        percentile_histogram _histogram;
+        percentile_histogram _calibration_histogram;
         std::atomic_flag _accessing_delta_ts;
         QRectF _clear_area;
         QRectF _paint_area;
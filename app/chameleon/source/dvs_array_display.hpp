@@ -0,0 +1,806 @@
+#pragma once
+
+#include "dvs_texels.hpp"
+#include <QQmlParserStatus>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions_3_3_Core>
+#include <QtQuick/QQuickItem>
+#include <QtQuick/QQuickWindow>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// dvs_array_display_renderer handles openGL calls for a display with several cameras.
+    /// The cameras share one shader program per style and one texture array (one layer per camera), and are drawn
+    /// with a single instanced draw call. Each camera has its own lock, so that acquisition threads never wait for
+    /// one another.
+    class dvs_array_display_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
+        Q_OBJECT
+        public:
+        /// maximum_cameras is the size of the shader's timestamps array.
+        static constexpr std::size_t maximum_cameras = 16;
+
+        dvs_array_display_renderer(
+            QSize canvas_size,
+            std::size_t cameras,
+            std::size_t columns,
+            float parameter,
+            std::size_t style,
+            const QVector<QColor>& on_colormap,
+            const QVector<QColor>& off_colormap) :
+            _canvas_size(canvas_size),
+            _columns(columns),
+            _rows((cameras + columns - 1) / columns),
+            _parameter(parameter),
+            _style(style),
+            _current_ts(cameras, 0),
+            _pending_rows(cameras, {0, 0}),
+            _program_setup(false) {
+            if (cameras == 0 || cameras > maximum_cameras) {
+                throw std::logic_error("cameras must be in the range [1, 16]");
+            }
+            if (style >= _style_to_program_id.size()) {
+                throw std::logic_error("style out of range");
+            }
+            _layers.reserve(cameras);
+            for (std::size_t camera = 0; camera < cameras; ++camera) {
+                _layers.emplace_back(new layer(
+                    static_cast<std::size_t>(canvas_size.width()), static_cast<std::size_t>(canvas_size.height())));
+            }
+            for (std::size_t style = 0; style < _style_to_fragment_shader.size(); ++style) {
+                std::stringstream fragment_shader_stream;
+                fragment_shader_stream << "#version 330 core\n"
+                                       << "in vec2 uv;\n"
+                                       << "flat in int layer;\n"
+                                       << "out vec4 color;\n"
+                                       << "uniform float parameter;\n"
+                                       << "uniform uint current_ts[" << cameras << "];\n"
+                                       << "uniform usampler2DArray sampler;\n"
+                                       << "const float on_color_table_scale = " << on_colormap.size() - 1 << ";\n"
+                                       << "const float off_color_table_scale = " << off_colormap.size() - 1 << ";\n";
+                const auto table_size = std::max(on_colormap.size(), off_colormap.size()) + 1;
+                auto add_color_table_to_stream = [&](const char* name, const QVector<QColor>& colormap) {
+                    fragment_shader_stream << "const vec4 " << name << "[" << table_size << "] = vec4[](\n";
+                    for (int index = 0; index < table_size; ++index) {
+                        const auto color = colormap[std::min(index, colormap.size() - 1)];
+                        fragment_shader_stream << "    vec4(" << color.redF() << ", " << color.greenF() << ", "
+                                               << color.blueF() << ", " << color.alphaF() << ")"
+                                               << (index < table_size - 1 ? ",\n" : ");\n");
+                    }
+                };
+                add_color_table_to_stream("on_color_table", on_colormap);
+                add_color_table_to_stream("off_color_table", off_colormap);
+                fragment_shader_stream << "void main() {\n"
+                                       << "    uint t_and_on = texelFetch(sampler, ivec3(ivec2(uv), layer), 0).x;\n"
+                                       << "    float age = float((current_ts[layer] - t_and_on) & 0x7fffffffu);\n"
+                                       << "    bool on = t_and_on >= 0x80000000u;\n";
+                switch (style) {
+                    case 0:
+                        fragment_shader_stream << "    float lambda = 1.0f - exp(-age / parameter);\n";
+                        break;
+                    case 1:
+                        fragment_shader_stream << "    float lambda = age < parameter ? age / parameter : 1.0f;\n";
+                        break;
+                    case 2:
+                        fragment_shader_stream << "    float lambda = age < parameter ? 0.0f : 1.0f;\n";
+                        break;
+                    default:
+                        throw std::logic_error("unknown style");
+                }
+                fragment_shader_stream
+                    << "    float scaled_lambda = lambda * (on ? on_color_table_scale : off_color_table_scale);\n"
+                    << "    color = (t_and_on & 0x7fffffffu) == 0u ? on_color_table[int(on_color_table_scale)] : mix(\n"
+                    << "        (on ? on_color_table : off_color_table)[int(scaled_lambda)],\n"
+                    << "        (on ? on_color_table : off_color_table)[int(scaled_lambda) + 1],\n"
+                    << "        scaled_lambda - float(int(scaled_lambda)));\n"
+                    << "}\n";
+                _style_to_fragment_shader[style] = fragment_shader_stream.str();
+            }
+            _accessing_style.clear(std::memory_order_release);
+        }
+        dvs_array_display_renderer(const dvs_array_display_renderer&) = delete;
+        dvs_array_display_renderer(dvs_array_display_renderer&&) = delete;
+        dvs_array_display_renderer& operator=(const dvs_array_display_renderer&) = delete;
+        dvs_array_display_renderer& operator=(dvs_array_display_renderer&&) = delete;
+        virtual ~dvs_array_display_renderer() {
+            if (_program_setup) {
+                glDeleteBuffers(1, &_pbo_id);
+                glDeleteTextures(1, &_texture_id);
+                glDeleteBuffers(1, &_vertex_buffer_id);
+                glDeleteVertexArrays(1, &_vertex_array_id);
+                for (std::size_t style = 0; style < _style_to_program_id.size(); ++style) {
+                    glDeleteProgram(_style_to_program_id[style]);
+                }
+            }
+        }
+
+        /// set_rendering_area defines the rendering area.
+        virtual void set_rendering_area(QRectF paint_area, int window_height) {
+            _paint_area = paint_area;
+            _paint_area.moveTop(window_height - _paint_area.top() - _paint_area.height());
+        }
+
+        /// set_parameter changes the exponential decay constant.
+        virtual void set_parameter(float parameter) {
+            _parameter.store(parameter, std::memory_order_relaxed);
+        }
+
+        /// set_style changes the decay style.
+        void set_style(std::size_t style) {
+            if (style >= _style_to_program_id.size()) {
+                throw std::logic_error("style out of range");
+            }
+            while (_accessing_style.test_and_set(std::memory_order_acquire)) {
+            }
+            _style = style;
+            _accessing_style.clear(std::memory_order_release);
+        }
+
+        /// lock acquires the spin-lock mutex protecting the given camera's time context.
+        void lock(std::size_t camera) {
+            while (_layers[camera]->accessing.test_and_set(std::memory_order_acquire)) {
+            }
+        }
+
+        /// unlock releases the spin-lock mutex protecting the given camera's time context.
+        /// This function must only be called after acquiring the lock.
+        void unlock(std::size_t camera) {
+            _layers[camera]->accessing.clear(std::memory_order_release);
+        }
+
+        /// push_unsafe adds an event to the given camera.
+        /// This function must only be called after acquiring the camera's lock.
+        template <typename Event>
+        void push_unsafe(std::size_t camera, Event event) {
+            auto& target = *_layers[camera];
+            target.current_t = event.t;
+
+            // the sweep runs before the write, since a clamp_all sweep clamps every pixel
+            sweep(target);
+            target.ts_and_ons[static_cast<std::size_t>(event.x)
+                              + static_cast<std::size_t>(event.y) * _canvas_size.width()] =
+                dvs_texels::pack(event.t, event.on);
+            target.first_dirty_row = std::min(target.first_dirty_row, static_cast<std::size_t>(event.y));
+            target.last_dirty_row = std::max(target.last_dirty_row, static_cast<std::size_t>(event.y) + 1);
+        }
+
+        /// push adds an event to the given camera.
+        template <typename Event>
+        void push(std::size_t camera, Event event) {
+            lock(camera);
+            push_unsafe<Event>(camera, event);
+            unlock(camera);
+        }
+
+        public slots:
+
+        /// paint sends commands to the GPU.
+        void paint() {
+            if (!initializeOpenGLFunctions()) {
+                throw std::runtime_error("initializing the OpenGL context failed");
+            }
+            const auto cameras = _layers.size();
+            const auto layer_size = _layers.front()->ts_and_ons.size();
+            if (!_program_setup) {
+                _program_setup = true;
+
+                // compile one program per style, shared by all the cameras
+                const std::string vertex_shader(R""(
+                    #version 330 core
+                    in vec2 coordinates;
+                    out vec2 uv;
+                    flat out int layer;
+                    uniform float width;
+                    uniform float height;
+                    uniform int columns;
+                    uniform int rows;
+                    void main() {
+                        layer = gl_InstanceID;
+                        vec2 cell = vec2(float(gl_InstanceID % columns), float(rows - 1 - gl_InstanceID / columns));
+                        vec2 position = (cell + coordinates) / vec2(float(columns), float(rows));
+                        gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+                        uv = coordinates * vec2(width, height);
+                    }
+                )"");
+                for (std::size_t style = 0; style < _style_to_program_id.size(); ++style) {
+                    _style_to_program_id[style] = compile_program(vertex_shader, _style_to_fragment_shader[style]);
+                    glUseProgram(_style_to_program_id[style]);
+                    glUniform1f(
+                        glGetUniformLocation(_style_to_program_id[style], "width"),
+                        static_cast<GLfloat>(_canvas_size.width()));
+                    glUniform1f(
+                        glGetUniformLocation(_style_to_program_id[style], "height"),
+                        static_cast<GLfloat>(_canvas_size.height()));
+                    glUniform1i(
+                        glGetUniformLocation(_style_to_program_id[style], "columns"), static_cast<GLint>(_columns));
+                    glUniform1i(glGetUniformLocation(_style_to_program_id[style], "rows"), static_cast<GLint>(_rows));
+                    _style_to_current_ts_location[style] =
+                        glGetUniformLocation(_style_to_program_id[style], "current_ts");
+                    _style_to_parameter_location[style] =
+                        glGetUniformLocation(_style_to_program_id[style], "parameter");
+                }
+
+                // create the vertex array object (one quad, instanced per camera)
+                glGenVertexArrays(1, &_vertex_array_id);
+                glBindVertexArray(_vertex_array_id);
+                glGenBuffers(1, &_vertex_buffer_id);
+                glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffer_id);
+                std::array<float, 8> coordinates{0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f};
+                glBufferData(
+                    GL_ARRAY_BUFFER,
+                    coordinates.size() * sizeof(decltype(coordinates)::value_type),
+                    coordinates.data(),
+                    GL_STATIC_DRAW);
+                const auto coordinates_location = glGetAttribLocation(_style_to_program_id[0], "coordinates");
+                glEnableVertexAttribArray(coordinates_location);
+                glVertexAttribPointer(coordinates_location, 2, GL_FLOAT, GL_FALSE, 0, 0);
+                glBindVertexArray(0);
+
+                // create the texture array
+                glGenTextures(1, &_texture_id);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, _texture_id);
+                glTexImage3D(
+                    GL_TEXTURE_2D_ARRAY,
+                    0,
+                    GL_R32UI,
+                    _canvas_size.width(),
+                    _canvas_size.height(),
+                    static_cast<GLsizei>(cameras),
+                    0,
+                    GL_RED_INTEGER,
+                    GL_UNSIGNED_INT,
+                    nullptr);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+                // create the pbo
+                glGenBuffers(1, &_pbo_id);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, cameras * layer_size * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+
+            // copy the dirty rows of each camera to the pbo, holding one camera lock at a time
+            while (_accessing_style.test_and_set(std::memory_order_acquire)) {
+            }
+            const auto style = _style;
+            _accessing_style.clear(std::memory_order_release);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, _texture_id);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
+            {
+                // the buffer is not invalidated, clean rows keep the values copied during previous frames
+                auto buffer = reinterpret_cast<uint32_t*>(glMapBufferRange(
+                    GL_PIXEL_UNPACK_BUFFER, 0, cameras * layer_size * sizeof(uint32_t), GL_MAP_WRITE_BIT));
+                if (!buffer) {
+                    throw std::logic_error("glMapBufferRange returned an null pointer");
+                }
+                const auto width = static_cast<std::size_t>(_canvas_size.width());
+                for (std::size_t camera = 0; camera < cameras; ++camera) {
+                    auto& source = *_layers[camera];
+                    lock(camera);
+                    _current_ts[camera] = static_cast<uint32_t>(source.current_t);
+                    _pending_rows[camera] = {source.first_dirty_row, source.last_dirty_row};
+                    if (source.first_dirty_row < source.last_dirty_row) {
+                        std::copy(
+                            std::next(source.ts_and_ons.begin(), source.first_dirty_row * width),
+                            std::next(source.ts_and_ons.begin(), source.last_dirty_row * width),
+                            buffer + camera * layer_size + source.first_dirty_row * width);
+                    }
+                    source.first_dirty_row = static_cast<std::size_t>(_canvas_size.height());
+                    source.last_dirty_row = 0;
+                    unlock(camera);
+                }
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+            for (std::size_t camera = 0; camera < cameras; ++camera) {
+                const auto rows = _pending_rows[camera];
+                if (rows.first < rows.second) {
+                    glTexSubImage3D(
+                        GL_TEXTURE_2D_ARRAY,
+                        0,
+                        0,
+                        static_cast<GLint>(rows.first),
+                        static_cast<GLint>(camera),
+                        _canvas_size.width(),
+                        static_cast<GLsizei>(rows.second - rows.first),
+                        1,
+                        GL_RED_INTEGER,
+                        GL_UNSIGNED_INT,
+                        reinterpret_cast<const void*>(
+                            (camera * layer_size + rows.first * _canvas_size.width()) * sizeof(uint32_t)));
+                }
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+            // draw all the cameras
+            glUseProgram(_style_to_program_id[style]);
+            glUniform1f(
+                _style_to_parameter_location[style],
+                static_cast<GLfloat>(_parameter.load(std::memory_order_relaxed) * (style == 1 ? 2.0f : 1.0f)));
+            glUniform1uiv(
+                _style_to_current_ts_location[style], static_cast<GLsizei>(cameras), _current_ts.data());
+            glViewport(
+                static_cast<GLint>(_paint_area.left()),
+                static_cast<GLint>(_paint_area.top()),
+                static_cast<GLsizei>(_paint_area.width()),
+                static_cast<GLsizei>(_paint_area.height()));
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glBindVertexArray(_vertex_array_id);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(cameras));
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            glBindVertexArray(0);
+            glUseProgram(0);
+            check_opengl_error();
+        }
+
+        protected:
+        /// layer holds the time context of one camera.
+        struct layer {
+            layer(std::size_t width, std::size_t height) :
+                ts_and_ons(width * height, 0),
+                current_t(0),
+                first_dirty_row(0),
+                last_dirty_row(height),
+                age_sweep(height) {
+                accessing.clear(std::memory_order_release);
+            }
+
+            std::vector<uint32_t> ts_and_ons;
+            uint64_t current_t;
+            std::size_t first_dirty_row;
+            std::size_t last_dirty_row;
+            dvs_texels::age_sweep age_sweep;
+            std::atomic_flag accessing;
+        };
+
+        /// sweep clamps the age of the pixels in the rows due at the camera's current timestamp (see dvs_texels).
+        /// It is called on push rather than on paint, so that ages do not wrap around while the window does not
+        /// render. This function must only be called after acquiring the camera's lock.
+        void sweep(layer& target) {
+            const auto range = target.age_sweep.advance(target.current_t);
+            const auto height = static_cast<std::size_t>(_canvas_size.height());
+            const auto width = static_cast<std::size_t>(_canvas_size.width());
+            const auto current_t = static_cast<uint32_t>(target.current_t);
+            for (std::size_t index = 0; index < range.rows; ++index) {
+                const auto row = (range.first_row + index) % height;
+                if (dvs_texels::clamp_row(
+                        target.ts_and_ons.data() + row * width,
+                        target.ts_and_ons.data() + (row + 1) * width,
+                        current_t,
+                        range.clamp_all)) {
+                    target.first_dirty_row = std::min(target.first_dirty_row, row);
+                    target.last_dirty_row = std::max(target.last_dirty_row, row + 1);
+                }
+            }
+        }
+
+        /// compile_program creates a shaders pipeline.
+        GLuint compile_program(const std::string& vertex_shader, const std::string& fragment_shader) {
+            const auto vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+            {
+                auto vertex_shader_content = vertex_shader.c_str();
+                auto vertex_shader_size = vertex_shader.size();
+                glShaderSource(
+                    vertex_shader_id,
+                    1,
+                    static_cast<const GLchar**>(&vertex_shader_content),
+                    reinterpret_cast<const GLint*>(&vertex_shader_size));
+            }
+            glCompileShader(vertex_shader_id);
+            check_shader_error(vertex_shader_id);
+            const auto fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+            {
+                auto fragment_shader_content = fragment_shader.c_str();
+                auto fragment_shader_size = fragment_shader.size();
+                glShaderSource(
+                    fragment_shader_id,
+                    1,
+                    static_cast<const GLchar**>(&fragment_shader_content),
+                    reinterpret_cast<const GLint*>(&fragment_shader_size));
+            }
+            glCompileShader(fragment_shader_id);
+            check_shader_error(fragment_shader_id);
+            const auto program_id = glCreateProgram();
+            glAttachShader(program_id, vertex_shader_id);
+            glAttachShader(program_id, fragment_shader_id);
+            glLinkProgram(program_id);
+            glDeleteShader(vertex_shader_id);
+            glDeleteShader(fragment_shader_id);
+            check_program_error(program_id);
+            return program_id;
+        }
+
+        /// check_opengl_error throws if openGL generated an error.
+        virtual void check_opengl_error() {
+            switch (glGetError()) {
+                case GL_NO_ERROR:
+                    break;
+                case GL_INVALID_ENUM:
+                    throw std::logic_error("OpenGL error: GL_INVALID_ENUM");
+                case GL_INVALID_VALUE:
+                    throw std::logic_error("OpenGL error: GL_INVALID_VALUE");
+                case GL_INVALID_OPERATION:
+                    throw std::logic_error("OpenGL error: GL_INVALID_OPERATION");
+                case GL_OUT_OF_MEMORY:
+                    throw std::logic_error("OpenGL error: GL_OUT_OF_MEMORY");
+            }
+        }
+
+        /// check_shader_error checks for shader compilation errors.
+        virtual void check_shader_error(GLuint shader_id) {
+            GLint status = 0;
+            glGetShaderiv(shader_id, GL_COMPILE_STATUS, &status);
+            if (status != GL_TRUE) {
+                GLint message_length = 0;
+                glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &message_length);
+                auto error_message = std::vector<char>(message_length);
+                glGetShaderInfoLog(shader_id, message_length, nullptr, error_message.data());
+                throw std::logic_error("Shader error: " + std::string(error_message.data()));
+            }
+        }
+
+        /// check_program_error checks for program errors.
+        virtual void check_program_error(GLuint program_id) {
+            GLint status = 0;
+            glGetProgramiv(program_id, GL_LINK_STATUS, &status);
+            if (status != GL_TRUE) {
+                GLint message_length = 0;
+                glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &message_length);
+                std::vector<char> error_message(message_length);
+                glGetProgramInfoLog(program_id, message_length, nullptr, error_message.data());
+                throw std::logic_error("program error: " + std::string(error_message.data()));
+            }
+        }
+
+        QSize _canvas_size;
+        std::size_t _columns;
+        std::size_t _rows;
+        std::atomic<float> _parameter;
+        std::size_t _style;
+        std::atomic_flag _accessing_style;
+        std::vector<std::unique_ptr<layer>> _layers;
+        std::vector<uint32_t> _current_ts;
+        std::vector<std::pair<std::size_t, std::size_t>> _pending_rows;
+        std::array<std::string, 3> _style_to_fragment_shader;
+        QRectF _paint_area;
+        bool _program_setup;
+        std::array<GLuint, 3> _style_to_program_id;
+        std::array<GLint, 3> _style_to_current_ts_location;
+        std::array<GLint, 3> _style_to_parameter_location;
+        GLuint _vertex_array_id;
+        GLuint _vertex_buffer_id;
+        GLuint _texture_id;
+        GLuint _pbo_id;
+    };
+
+    /// dvs_array_display displays the DVS streams of several cameras with the same resolution in a grid.
+    /// Cameras are laid out row by row, from the top left corner.
+    class dvs_array_display : public QQuickItem {
+        Q_OBJECT
+        Q_INTERFACES(QQmlParserStatus)
+        Q_PROPERTY(QSize canvas_size READ canvas_size WRITE set_canvas_size)
+        Q_PROPERTY(int cameras READ cameras WRITE set_cameras)
+        Q_PROPERTY(int columns READ columns WRITE set_columns)
+        Q_PROPERTY(float parameter READ parameter WRITE set_parameter)
+        Q_PROPERTY(Style style READ style WRITE set_style)
+        Q_PROPERTY(QVector<QString> on_colormap READ on_colormap WRITE set_on_colormap)
+        Q_PROPERTY(QVector<QString> off_colormap READ off_colormap WRITE set_off_colormap)
+        Q_PROPERTY(QRectF paint_area READ paint_area)
+        Q_ENUMS(Style)
+        public:
+        /// Styles lists available decay functions.
+        enum Style { Exponential, Linear, Window };
+
+        dvs_array_display() :
+            _ready(false),
+            _renderer_ready(false),
+            _cameras(1),
+            _columns(0),
+            _rows(1),
+            _parameter(1e5),
+            _style(Style::Exponential),
+            _on_colormap({Qt::white, Qt::darkGray}),
+            _off_colormap({Qt::black, Qt::darkGray}) {
+            connect(this, &QQuickItem::windowChanged, this, &dvs_array_display::handle_window_changed);
+            _accessing_renderer.clear(std::memory_order_release);
+        }
+        dvs_array_display(const dvs_array_display&) = delete;
+        dvs_array_display(dvs_array_display&&) = delete;
+        dvs_array_display& operator=(const dvs_array_display&) = delete;
+        dvs_array_display& operator=(dvs_array_display&&) = delete;
+        virtual ~dvs_array_display() {}
+
+        /// set_canvas_size defines the coordinates of each camera.
+        /// It can only be set during qml initialization.
+        virtual void set_canvas_size(QSize canvas_size) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("canvas_size can only be set during qml construction");
+            }
+            _canvas_size = canvas_size;
+        }
+
+        /// canvas_size returns the currently used canvas_size.
+        virtual QSize canvas_size() const {
+            return _canvas_size;
+        }
+
+        /// set_cameras defines the number of cameras.
+        /// It can only be set during qml initialization.
+        virtual void set_cameras(int cameras) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("cameras can only be set during qml construction");
+            }
+            _cameras = cameras;
+        }
+
+        /// cameras returns the number of cameras.
+        virtual int cameras() const {
+            return _cameras;
+        }
+
+        /// set_columns defines the number of cameras per row.
+        /// Zero (default) picks the smallest square grid that fits all the cameras.
+        /// It can only be set during qml initialization.
+        virtual void set_columns(int columns) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("columns can only be set during qml construction");
+            }
+            _columns = columns;
+        }
+
+        /// columns returns the number of cameras per row.
+        virtual int columns() const {
+            return _columns;
+        }
+
+        /// set_parameter defines the chosen style's time parameter.
+        virtual void set_parameter(float parameter) {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            if (_renderer_ready.load(std::memory_order_acquire)) {
+                _dvs_array_display_renderer->set_parameter(parameter);
+            }
+            _parameter = parameter;
+            _accessing_renderer.clear(std::memory_order_release);
+        }
+
+        /// parameter returns the currently used parameter.
+        virtual float parameter() const {
+            return _parameter;
+        }
+
+        /// set_style defines the style.
+        virtual void set_style(Style style) {
+            while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+            }
+            if (_renderer_ready.load(std::memory_order_acquire)) {
+                _dvs_array_display_renderer->set_style(static_cast<std::size_t>(style));
+            }
+            _style = style;
+            _accessing_renderer.clear(std::memory_order_release);
+        }
+
+        /// style returns the currently used style.
+        virtual Style style() const {
+            return _style;
+        }
+
+        /// set_on_colormap defines the colormap used to convert time deltas to colors for ON events.
+        /// It can only be set during qml initialization.
+        virtual void set_on_colormap(const QVector<QString>& on_colormap) {
+            if (on_colormap.size() < 2) {
+                throw std::logic_error("on_colormap must contain at least two elements");
+            }
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("on_colormap can only be set during qml construction");
+            }
+            _on_colormap.clear();
+            _on_colormap.reserve(on_colormap.size());
+            for (const auto& color : on_colormap) {
+                _on_colormap.push_back(color);
+            }
+        }
+
+        /// on_colormap returns the currently used ON colormap.
+        virtual QVector<QString> on_colormap() const {
+            QVector<QString> result;
+            result.reserve(_on_colormap.size());
+            for (const auto& color : _on_colormap) {
+                result.push_back(color.name());
+            }
+            return result;
+        }
+
+        /// set_off_colormap defines the colormap used to convert time deltas to colors for OFF events.
+        /// It can only be set during qml initialization.
+        virtual void set_off_colormap(const QVector<QString>& off_colormap) {
+            if (off_colormap.size() < 2) {
+                throw std::logic_error("off_colormap must contain at least two elements");
+            }
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("off_colormap can only be set during qml construction");
+            }
+            _off_colormap.clear();
+            _off_colormap.reserve(off_colormap.size());
+            for (const auto& color : off_colormap) {
+                _off_colormap.push_back(color);
+            }
+        }
+
+        /// off_colormap returns the currently used OFF colormap.
+        virtual QVector<QString> off_colormap() const {
+            QVector<QString> result;
+            result.reserve(_off_colormap.size());
+            for (const auto& color : _off_colormap) {
+                result.push_back(color.name());
+            }
+            return result;
+        }
+
+        /// paint_area returns the paint area in window coordinates.
+        virtual QRectF paint_area() const {
+            return _paint_area;
+        }
+
+        /// lock acquires the spin-lock mutex protecting the given camera's time context.
+        void lock(std::size_t camera) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _dvs_array_display_renderer->lock(camera);
+        }
+
+        /// unlock releases the spin-lock mutex protecting the given camera's time context.
+        /// This function must only be called after acquiring the lock.
+        void unlock(std::size_t camera) {
+            _dvs_array_display_renderer->unlock(camera);
+        }
+
+        /// push_unsafe adds an event to the given camera.
+        /// This function must only be called after acquiring the camera's lock.
+        template <typename Event>
+        void push_unsafe(std::size_t camera, Event event) {
+            _dvs_array_display_renderer->push_unsafe<Event>(camera, event);
+        }
+
+        /// push adds an event to the given camera.
+        template <typename Event>
+        void push(std::size_t camera, Event event) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _dvs_array_display_renderer->push<Event>(camera, event);
+        }
+
+        /// componentComplete is called when all the qml values are bound.
+        virtual void componentComplete() override {
+            if (_canvas_size.width() <= 0 || _canvas_size.height() <= 0) {
+                throw std::logic_error("canvas_size cannot have a null component, make sure that it is set in qml");
+            }
+            if (_cameras <= 0 || _cameras > static_cast<int>(dvs_array_display_renderer::maximum_cameras)) {
+                throw std::logic_error("cameras must be in the range [1, 16]");
+            }
+            if (_columns <= 0) {
+                _columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(_cameras))));
+            }
+            _rows = (_cameras + _columns - 1) / _columns;
+            setImplicitWidth(_canvas_size.width() * _columns);
+            setImplicitHeight(_canvas_size.height() * _rows);
+            _ready.store(true, std::memory_order_release);
+        }
+
+        signals:
+
+        /// paintAreaChanged notifies a paint area change.
+        void paintAreaChanged(QRectF paint_area);
+
+        public slots:
+
+        /// sync adapts the renderer to external changes.
+        void sync() {
+            if (_ready.load(std::memory_order_acquire)) {
+                if (!_dvs_array_display_renderer) {
+                    while (_accessing_renderer.test_and_set(std::memory_order_acquire)) {
+                    }
+                    _dvs_array_display_renderer =
+                        std::unique_ptr<dvs_array_display_renderer>(new dvs_array_display_renderer(
+                            _canvas_size,
+                            static_cast<std::size_t>(_cameras),
+                            static_cast<std::size_t>(_columns),
+                            _parameter,
+                            static_cast<std::size_t>(_style),
+                            _on_colormap,
+                            _off_colormap));
+                    connect(
+                        window(),
+                        &QQuickWindow::beforeRendering,
+                        _dvs_array_display_renderer.get(),
+                        &dvs_array_display_renderer::paint,
+                        Qt::DirectConnection);
+                    _renderer_ready.store(true, std::memory_order_release);
+                    _accessing_renderer.clear(std::memory_order_release);
+                }
+                auto clear_area =
+                    QRectF(0, 0, width() * window()->devicePixelRatio(), height() * window()->devicePixelRatio());
+                for (auto item = static_cast<QQuickItem*>(this); item; item = item->parentItem()) {
+                    clear_area.moveLeft(clear_area.left() + item->x() * window()->devicePixelRatio());
+                    clear_area.moveTop(clear_area.top() + item->y() * window()->devicePixelRatio());
+                }
+                if (clear_area != _clear_area) {
+                    _clear_area = std::move(clear_area);
+                    const auto grid_width = static_cast<qreal>(_canvas_size.width() * _columns);
+                    const auto grid_height = static_cast<qreal>(_canvas_size.height() * _rows);
+                    if (_clear_area.width() * grid_height > _clear_area.height() * grid_width) {
+                        _paint_area.setWidth(_clear_area.height() * grid_width / grid_height);
+                        _paint_area.setHeight(_clear_area.height());
+                        _paint_area.moveLeft(_clear_area.left() + (_clear_area.width() - _paint_area.width()) / 2);
+                        _paint_area.moveTop(_clear_area.top());
+                    } else {
+                        _paint_area.setWidth(_clear_area.width());
+                        _paint_area.setHeight(_clear_area.width() * grid_height / grid_width);
+                        _paint_area.moveLeft(_clear_area.left());
+                        _paint_area.moveTop(_clear_area.top() + (_clear_area.height() - _paint_area.height()) / 2);
+                    }
+                    _dvs_array_display_renderer->set_rendering_area(
+                        _paint_area, window()->height() * window()->devicePixelRatio());
+                    paintAreaChanged(_paint_area);
+                }
+            }
+        }
+
+        /// cleanup frees the owned renderer.
+        void cleanup() {
+            _dvs_array_display_renderer.reset();
+        }
+
+        /// trigger_draw requests a window refresh.
+        void trigger_draw() {
+            if (window()) {
+                window()->update();
+            }
+        }
+
+        private slots:
+
+        /// handle_window_changed must be triggered after a window change.
+        void handle_window_changed(QQuickWindow* window) {
+            if (window) {
+                connect(
+                    window, &QQuickWindow::beforeSynchronizing, this, &dvs_array_display::sync, Qt::DirectConnection);
+                connect(
+                    window,
+                    &QQuickWindow::sceneGraphInvalidated,
+                    this,
+                    &dvs_array_display::cleanup,
+                    Qt::DirectConnection);
+                window->setClearBeforeRendering(false);
+            }
+        }
+
+        protected:
+        std::atomic_bool _ready;
+        std::atomic_bool _renderer_ready;
+        std::atomic_flag _accessing_renderer;
+        QSize _canvas_size;
+        int _cameras;
+        int _columns;
+        int _rows;
+        float _parameter;
+        Style _style;
+        QVector<QColor> _on_colormap;
+        QVector<QColor> _off_colormap;
+        std::unique_ptr<dvs_array_display_renderer> _dvs_array_display_renderer;
+        QRectF _clear_area;
+        QRectF _paint_area;
+    };
+}
@@ -1,10 +1,12 @@
 #pragma once
 
+#include "dvs_texels.hpp"
 #include <QQmlParserStatus>
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLFunctions_3_3_Core>
 #include <QtQuick/QQuickItem>
 #include <QtQuick/QQuickWindow>
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <limits>
@@ -23,21 +25,42 @@ namespace chameleon {
     class dvs_display_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
         Q_OBJECT
         public:
+        /// tile_size is the side of the square pixel tiles tracked for partial uploads.
+        static constexpr int tile_size = 32;
+
+        /// full_upload_ratio is the fraction of dirty tiles above which the whole texture is uploaded.
+        static constexpr float full_upload_ratio = 0.5f;
+
         dvs_display_renderer(
             QSize canvas_size,
             float parameter,
             std::size_t style,
             const QVector<QColor>& on_colormap,
             const QVector<QColor>& off_colormap,
-            QColor background_color) :
+            QColor background_color,
+            bool gpu_scatter) :
             _canvas_size(canvas_size),
             _parameter(parameter),
             _style(style),
             _background_color(background_color),
-            _ts_and_ons(_canvas_size.width() * _canvas_size.height() * 2),
+            _ts_and_ons(_canvas_size.width() * _canvas_size.height()),
             _current_t(0),
-            _program_setup(false),
-            offset_t(0) {
+            _tiles_width((_canvas_size.width() + tile_size - 1) / tile_size),
+            _tiles_height((_canvas_size.height() + tile_size - 1) / tile_size),
+            _dirty_tiles((_tiles_width * _tiles_height + 63) / 64, 0),
+            _full_upload_required(true),
+            _pending_tiles(_dirty_tiles.size(), 0),
+            _pending_full_upload(false),
+            _age_sweep(static_cast<std::size_t>(_canvas_size.height())),
+            _gpu_scatter(gpu_scatter),
+            _generation(0),
+            _scatter_t(0),
+            _program_setup(false) {
+            if (_gpu_scatter) {
+                _events.reserve(_ts_and_ons.size() * 2);
+                _scatter_events.reserve(_ts_and_ons.size() * 2);
+                _generations.resize(_ts_and_ons.size(), 0);
+            }
             if (style >= _style_to_program_id.size()) {
                 throw std::logic_error("style out of range");
             }
@@ -83,29 +106,29 @@ namespace chameleon {
                 }
                 fragment_shader_stream << ");\n";
                 fragment_shader_stream << "void main() {\n"
-                                       << "    uvec2 t_and_on = texture(sampler, uv).xy;\n";
+                                       << "    uint t_and_on = texture(sampler, uv).x;\n"
+                                       << "    float age = float((current_t - t_and_on) & 0x7fffffffu);\n"
+                                       << "    bool on = t_and_on >= 0x80000000u;\n";
                 switch (style) {
                     case 0:
                         fragment_shader_stream
-                            << "    float lambda = 1.0f - exp(-float(current_t - t_and_on.x) / parameter);\n";
+                            << "    float lambda = 1.0f - exp(-age / parameter);\n";
                         break;
                     case 1:
-                        fragment_shader_stream << "    float lambda = (current_t - t_and_on.x) < parameter ? "
-                                                  "(current_t - t_and_on.x) / parameter : 1.0f;\n";
+                        fragment_shader_stream << "    float lambda = age < parameter ? age / parameter : 1.0f;\n";
                         break;
                     case 2:
                         fragment_shader_stream
-                            << "    float lambda = (current_t - t_and_on.x) < parameter ? 0.0f : 1.0f;\n";
+                            << "    float lambda = age < parameter ? 0.0f : 1.0f;\n";
                         break;
                     default:
                         throw std::logic_error("unknown style");
                 }
                 fragment_shader_stream
-                    << "    float scaled_lambda = lambda * (t_and_on.y == 1u ? on_color_table_scale : "
-                       "off_color_table_scale);\n"
-                    << "    color = t_and_on.x == 0u ? on_color_table[int(on_color_table_scale)] : mix(\n"
-                    << "        (t_and_on.y == 1u ? on_color_table : off_color_table)[int(scaled_lambda)],\n"
-                    << "        (t_and_on.y == 1u ? on_color_table : off_color_table)[int(scaled_lambda) + 1],\n"
+                    << "    float scaled_lambda = lambda * (on ? on_color_table_scale : off_color_table_scale);\n"
+                    << "    color = (t_and_on & 0x7fffffffu) == 0u ? on_color_table[int(on_color_table_scale)] : mix(\n"
+                    << "        (on ? on_color_table : off_color_table)[int(scaled_lambda)],\n"
+                    << "        (on ? on_color_table : off_color_table)[int(scaled_lambda) + 1],\n"
                     << "        scaled_lambda - float(int(scaled_lambda)));\n"
                     << "}\n";
                 _style_to_fragment_shader[style] = fragment_shader_stream.str();
@@ -118,6 +141,15 @@ namespace chameleon {
         dvs_display_renderer& operator=(const dvs_display_renderer&) = delete;
         dvs_display_renderer& operator=(dvs_display_renderer&&) = delete;
         virtual ~dvs_display_renderer() {
+            if (_gpu_scatter) {
+                glDeleteFramebuffers(1, &_framebuffer_id);
+                glDeleteTextures(1, &_scratch_texture_id);
+                glDeleteBuffers(1, &_scatter_buffer_id);
+                glDeleteVertexArrays(1, &_scatter_vertex_array_id);
+                glDeleteVertexArrays(1, &_clamp_vertex_array_id);
+                glDeleteProgram(_scatter_program_id);
+                glDeleteProgram(_clamp_program_id);
+            }
             glDeleteBuffers(1, &_pbo_id);
             glDeleteTextures(1, &_texture_id);
             glDeleteBuffers(static_cast<GLsizei>(_vertex_buffers_ids.size()), _vertex_buffers_ids.data());
@@ -155,20 +187,25 @@ namespace chameleon {
         template <typename Event>
         void push_unsafe(Event event) {
             const auto index =
-                (static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * _canvas_size.width()) * 2;
-            while (event.t - offset_t > static_cast<uint64_t>(std::numeric_limits<uint32_t>::max())) {
-                offset_t += std::numeric_limits<uint32_t>::max() / 2;
-                for (std::size_t index = 0; index < _ts_and_ons.size(); index += 2) {
-                    if (_ts_and_ons[index] > std::numeric_limits<uint32_t>::max() / 2) {
-                        _ts_and_ons[index] -= std::numeric_limits<uint32_t>::max() / 2;
-                    } else {
-                        _ts_and_ons[index] = 0;
-                    }
+                static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * _canvas_size.width();
+            _current_t = event.t;
+            if (_gpu_scatter) {
+                if (_events.size() == _events.capacity()) {
+                    compact_events();
                 }
+                _events.push_back({
+                    static_cast<uint16_t>(event.x),
+                    static_cast<uint16_t>(event.y),
+                    dvs_texels::pack(event.t, event.on),
+                });
+            } else {
+                // the sweep runs before the write, since a clamp_all sweep clamps every pixel
+                sweep();
+                const auto tile = static_cast<std::size_t>(event.x / tile_size)
+                                  + static_cast<std::size_t>(event.y / tile_size) * _tiles_width;
+                _dirty_tiles[tile / 64] |= (static_cast<uint64_t>(1) << (tile % 64));
+                _ts_and_ons[index] = dvs_texels::pack(event.t, event.on);
             }
-            _ts_and_ons[index] = static_cast<uint32_t>(event.t - offset_t);
-            _ts_and_ons[index + 1] = event.on ? 1 : 0;
-            _current_t = static_cast<uint32_t>(event.t - offset_t);
         }
 
         /// push adds an event to the display.
@@ -179,6 +216,19 @@ namespace chameleon {
             unlock();
         }
 
+        /// advance moves the display time forward without events, so that pixels keep decaying during quiet periods.
+        /// Timestamps earlier than the current one are ignored.
+        void advance(uint64_t t) {
+            lock();
+            if (t > _current_t) {
+                _current_t = t;
+                if (!_gpu_scatter) {
+                    sweep();
+                }
+            }
+            unlock();
+        }
+
         /// assign sets all the pixels at once.
         template <typename Iterator>
         void assign(Iterator begin, Iterator end) {
@@ -186,14 +236,15 @@ namespace chameleon {
             while (_accessing_ts_and_ons.test_and_set(std::memory_order_acquire)) {
             }
             for (; begin != end; ++begin) {
-                _ts_and_ons[index] = static_cast<uint32_t>(begin->t);
+                _ts_and_ons[index] = begin->t == 0 ? 0 : dvs_texels::pack(static_cast<uint64_t>(begin->t), begin->on);
                 ++index;
-                _ts_and_ons[index] = begin->on ? 1 : 0;
-                ++index;
-                if (static_cast<uint32_t>(begin->t) > _current_t) {
-                    _current_t = static_cast<uint32_t>(begin->t);
+                if (static_cast<uint64_t>(begin->t) > _current_t) {
+                    _current_t = static_cast<uint64_t>(begin->t);
                 }
             }
+            _age_sweep.reset(_current_t);
+            _full_upload_required = true;
+            _events.clear();
             _accessing_ts_and_ons.clear(std::memory_order_release);
         }
 
@@ -311,11 +362,11 @@ namespace chameleon {
                     glTexImage2D(
                         GL_TEXTURE_RECTANGLE,
                         0,
-                        GL_RG32UI,
+                        GL_R32UI,
                         _canvas_size.width(),
                         _canvas_size.height(),
                         0,
-                        GL_RG_INTEGER,
+                        GL_RED_INTEGER,
                         GL_UNSIGNED_INT,
                         nullptr);
                     glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -332,6 +383,9 @@ namespace chameleon {
                         GL_DYNAMIC_DRAW);
                     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
                 }
+                if (_gpu_scatter) {
+                    setup_scatter();
+                }
             }
 
             // send data to the GPU
@@ -339,6 +393,9 @@ namespace chameleon {
             }
             const auto style = _style;
             _accessing_style.clear(std::memory_order_release);
+            if (_gpu_scatter) {
+                scatter();
+            }
             glUseProgram(_style_to_program_id[style]);
             glViewport(
                 static_cast<GLint>(_paint_area.left()),
@@ -348,31 +405,60 @@ namespace chameleon {
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
-            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
-            glTexSubImage2D(
-                GL_TEXTURE_RECTANGLE,
-                0,
-                0,
-                0,
-                _canvas_size.width(),
-                _canvas_size.height(),
-                GL_RG_INTEGER,
-                GL_UNSIGNED_INT,
-                0);
-            {
-                auto buffer = reinterpret_cast<uint32_t*>(glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY));
-                if (!buffer) {
-                    throw std::logic_error("glMapBuffer returned an null pointer");
-                }
+            if (_gpu_scatter) {
                 glUniform1f(
                     _parameter_location,
                     static_cast<GLfloat>(_parameter.load(std::memory_order_relaxed) * (style == 1 ? 2.0f : 1.0f)));
-                while (_accessing_ts_and_ons.test_and_set(std::memory_order_acquire)) {
+                glUniform1ui(_current_t_location, _scatter_t);
+            } else {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
+                upload_pending_tiles();
+                {
+                    // the buffer is not invalidated, clean tiles keep the values copied during previous frames
+                    auto buffer = reinterpret_cast<uint32_t*>(glMapBufferRange(
+                        GL_PIXEL_UNPACK_BUFFER,
+                        0,
+                        _ts_and_ons.size() * sizeof(decltype(_ts_and_ons)::value_type),
+                        GL_MAP_WRITE_BIT));
+                    if (!buffer) {
+                        throw std::logic_error("glMapBufferRange returned an null pointer");
+                    }
+                    glUniform1f(
+                        _parameter_location,
+                        static_cast<GLfloat>(_parameter.load(std::memory_order_relaxed) * (style == 1 ? 2.0f : 1.0f)));
+                    while (_accessing_ts_and_ons.test_and_set(std::memory_order_acquire)) {
+                    }
+                    glUniform1ui(_current_t_location, static_cast<uint32_t>(_current_t));
+                    std::size_t dirty_tiles_count = 0;
+                    for (auto word : _dirty_tiles) {
+                        for (; word != 0; word &= word - 1) {
+                            ++dirty_tiles_count;
+                        }
+                    }
+                    _pending_full_upload =
+                        _full_upload_required
+                        || static_cast<float>(dirty_tiles_count)
+                               > full_upload_ratio * static_cast<float>(_tiles_width * _tiles_height);
+                    if (_pending_full_upload) {
+                        std::copy(_ts_and_ons.begin(), _ts_and_ons.end(), buffer);
+                    } else {
+                        for_each_dirty_row(_dirty_tiles, [&](int x, int y, int width, int height) {
+                            for (auto row = y; row < y + height; ++row) {
+                                const auto offset =
+                                    static_cast<std::size_t>(row) * _canvas_size.width() + static_cast<std::size_t>(x);
+                                std::copy(
+                                    std::next(_ts_and_ons.begin(), offset),
+                                    std::next(_ts_and_ons.begin(), offset + static_cast<std::size_t>(width)),
+                                    buffer + offset);
+                            }
+                        });
+                    }
+                    _pending_tiles.swap(_dirty_tiles);
+                    std::fill(_dirty_tiles.begin(), _dirty_tiles.end(), 0);
+                    _full_upload_required = false;
+                    _accessing_ts_and_ons.clear(std::memory_order_release);
+                    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
                 }
-                glUniform1ui(_current_t_location, _current_t);
-                std::copy(_ts_and_ons.begin(), _ts_and_ons.end(), buffer);
-                _accessing_ts_and_ons.clear(std::memory_order_release);
-                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
             }
             glBindVertexArray(_vertex_array_id);
             glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, 0);
@@ -384,6 +470,373 @@ namespace chameleon {
         }
 
         protected:
+        /// scatter_event is the GPU representation of an event.
+        struct scatter_event {
+            uint16_t x;
+            uint16_t y;
+            uint32_t t_and_on;
+        };
+
+        /// for_each_dirty_row calls handle_rectangle for each horizontal run of dirty tiles.
+        /// Rectangles are clipped to the canvas, and given in pixels.
+        template <typename HandleRectangle>
+        void for_each_dirty_row(const std::vector<uint64_t>& tiles, HandleRectangle handle_rectangle) {
+            for (std::size_t tile_y = 0; tile_y < _tiles_height; ++tile_y) {
+                std::size_t tile_x = 0;
+                while (tile_x < _tiles_width) {
+                    const auto tile = tile_x + tile_y * _tiles_width;
+                    if ((tiles[tile / 64] & (static_cast<uint64_t>(1) << (tile % 64))) == 0) {
+                        ++tile_x;
+                        continue;
+                    }
+                    const auto first_tile_x = tile_x;
+                    for (++tile_x; tile_x < _tiles_width; ++tile_x) {
+                        const auto next_tile = tile_x + tile_y * _tiles_width;
+                        if ((tiles[next_tile / 64] & (static_cast<uint64_t>(1) << (next_tile % 64))) == 0) {
+                            break;
+                        }
+                    }
+                    const auto x = static_cast<int>(first_tile_x) * tile_size;
+                    const auto y = static_cast<int>(tile_y) * tile_size;
+                    handle_rectangle(
+                        x,
+                        y,
+                        std::min(static_cast<int>(tile_x) * tile_size, _canvas_size.width()) - x,
+                        std::min(y + tile_size, _canvas_size.height()) - y);
+                }
+            }
+        }
+
+        /// sweep clamps the age of the pixels in the rows due at the current timestamp (see dvs_texels).
+        /// It is called on push rather than on paint, so that ages do not wrap around while the window does not
+        /// render (for instance, when it is minimised). This function must only be called after acquiring the lock.
+        void sweep() {
+            const auto range = _age_sweep.advance(_current_t);
+            const auto height = static_cast<std::size_t>(_canvas_size.height());
+            const auto width = static_cast<std::size_t>(_canvas_size.width());
+            const auto current_t = static_cast<uint32_t>(_current_t);
+            for (std::size_t index = 0; index < range.rows; ++index) {
+                const auto row = (range.first_row + index) % height;
+                if (dvs_texels::clamp_row(
+                        _ts_and_ons.data() + row * width,
+                        _ts_and_ons.data() + (row + 1) * width,
+                        current_t,
+                        range.clamp_all)) {
+                    const auto tile_y = row / tile_size;
+                    for (std::size_t tile = tile_y * _tiles_width; tile < (tile_y + 1) * _tiles_width; ++tile) {
+                        _dirty_tiles[tile / 64] |= (static_cast<uint64_t>(1) << (tile % 64));
+                    }
+                }
+            }
+        }
+
+        /// compact_events keeps only the most recent event of each pixel in the pending batch.
+        /// It is called when the batch is full (the render thread has not consumed it for a while), and bounds its
+        /// size to twice the number of pixels. This function must only be called after acquiring the lock.
+        void compact_events() {
+            ++_generation;
+            if (_generation == 0) {
+                std::fill(_generations.begin(), _generations.end(), 0);
+                _generation = 1;
+            }
+            auto write_index = _events.size();
+            for (auto index = _events.size(); index > 0; --index) {
+                const auto event = _events[index - 1];
+                auto& generation =
+                    _generations[static_cast<std::size_t>(event.x)
+                                 + static_cast<std::size_t>(event.y) * static_cast<std::size_t>(_canvas_size.width())];
+                if (generation != _generation) {
+                    generation = _generation;
+                    --write_index;
+                    _events[write_index] = event;
+                }
+            }
+            _events.erase(_events.begin(), std::next(_events.begin(), write_index));
+        }
+
+        /// compile_program creates a shaders pipeline.
+        GLuint compile_program(const std::string& vertex_shader, const std::string& fragment_shader) {
+            const auto vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+            {
+                auto vertex_shader_content = vertex_shader.c_str();
+                auto vertex_shader_size = vertex_shader.size();
+                glShaderSource(
+                    vertex_shader_id,
+                    1,
+                    static_cast<const GLchar**>(&vertex_shader_content),
+                    reinterpret_cast<const GLint*>(&vertex_shader_size));
+            }
+            glCompileShader(vertex_shader_id);
+            check_shader_error(vertex_shader_id);
+            const auto fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+            {
+                auto fragment_shader_content = fragment_shader.c_str();
+                auto fragment_shader_size = fragment_shader.size();
+                glShaderSource(
+                    fragment_shader_id,
+                    1,
+                    static_cast<const GLchar**>(&fragment_shader_content),
+                    reinterpret_cast<const GLint*>(&fragment_shader_size));
+            }
+            glCompileShader(fragment_shader_id);
+            check_shader_error(fragment_shader_id);
+            const auto program_id = glCreateProgram();
+            glAttachShader(program_id, vertex_shader_id);
+            glAttachShader(program_id, fragment_shader_id);
+            glLinkProgram(program_id);
+            glDeleteShader(vertex_shader_id);
+            glDeleteShader(fragment_shader_id);
+            check_program_error(program_id);
+            return program_id;
+        }
+
+        /// setup_scatter creates the resources used to scatter events on the GPU.
+        /// It must be called after creating the texture and the display vertex buffers.
+        void setup_scatter() {
+            // scatter pass: one point per event, written to the state texture
+            _scatter_program_id = compile_program(
+                R""(
+                    #version 330 core
+                    in uvec2 position;
+                    in uint t_and_on;
+                    flat out uint value;
+                    uniform float width;
+                    uniform float height;
+                    void main() {
+                        gl_Position = vec4(
+                            (float(position.x) + 0.5) / width * 2.0 - 1.0,
+                            (float(position.y) + 0.5) / height * 2.0 - 1.0,
+                            0.0,
+                            1.0);
+                        value = t_and_on;
+                    }
+                )"",
+                R""(
+                    #version 330 core
+                    flat in uint value;
+                    out uint state;
+                    void main() {
+                        state = value;
+                    }
+                )"");
+            glUseProgram(_scatter_program_id);
+            glUniform1f(glGetUniformLocation(_scatter_program_id, "width"), static_cast<GLfloat>(_canvas_size.width()));
+            glUniform1f(
+                glGetUniformLocation(_scatter_program_id, "height"), static_cast<GLfloat>(_canvas_size.height()));
+            glGenVertexArrays(1, &_scatter_vertex_array_id);
+            glBindVertexArray(_scatter_vertex_array_id);
+            glGenBuffers(1, &_scatter_buffer_id);
+            glBindBuffer(GL_ARRAY_BUFFER, _scatter_buffer_id);
+            const auto position_location = glGetAttribLocation(_scatter_program_id, "position");
+            glEnableVertexAttribArray(position_location);
+            glVertexAttribIPointer(position_location, 2, GL_UNSIGNED_SHORT, sizeof(scatter_event), 0);
+            const auto t_and_on_location = glGetAttribLocation(_scatter_program_id, "t_and_on");
+            glEnableVertexAttribArray(t_and_on_location);
+            glVertexAttribIPointer(
+                t_and_on_location,
+                1,
+                GL_UNSIGNED_INT,
+                sizeof(scatter_event),
+                reinterpret_cast<const void*>(2 * sizeof(uint16_t)));
+            glBindVertexArray(0);
+
+            // clamp pass: copies the swept rows with clamped ages
+            // the state texture cannot be sampled while it is the render target, hence the scratch copy
+            std::stringstream clamp_shader;
+            clamp_shader << "#version 330 core\n"
+                         << "out uint state;\n"
+                         << "uniform usampler2DRect sampler;\n"
+                         << "uniform uint current_t;\n"
+                         << "uniform bool clamp_all;\n"
+                         << "void main() {\n"
+                         << "    uint t_and_on = texelFetch(sampler, ivec2(gl_FragCoord.xy)).x;\n"
+                         << "    if ((t_and_on & 0x7fffffffu) != 0u\n"
+                         << "        && (clamp_all || ((current_t - t_and_on) & 0x7fffffffu) > "
+                         << dvs_texels::maximum_age << "u)) {\n"
+                         << "        uint t = (current_t - " << dvs_texels::maximum_age << "u) & 0x7fffffffu;\n"
+                         << "        t_and_on = (t == 0u ? 1u : t) | (t_and_on & 0x80000000u);\n"
+                         << "    }\n"
+                         << "    state = t_and_on;\n"
+                         << "}\n";
+            _clamp_program_id = compile_program(
+                R""(
+                    #version 330 core
+                    in vec2 coordinates;
+                    void main() {
+                        gl_Position = vec4(coordinates, 0.0, 1.0);
+                    }
+                )"",
+                clamp_shader.str());
+            glUseProgram(_clamp_program_id);
+            _clamp_current_t_location = glGetUniformLocation(_clamp_program_id, "current_t");
+            _clamp_all_location = glGetUniformLocation(_clamp_program_id, "clamp_all");
+            glGenVertexArrays(1, &_clamp_vertex_array_id);
+            glBindVertexArray(_clamp_vertex_array_id);
+            glBindBuffer(GL_ARRAY_BUFFER, std::get<0>(_vertex_buffers_ids));
+            glEnableVertexAttribArray(glGetAttribLocation(_clamp_program_id, "coordinates"));
+            glVertexAttribPointer(glGetAttribLocation(_clamp_program_id, "coordinates"), 2, GL_FLOAT, GL_FALSE, 0, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, std::get<1>(_vertex_buffers_ids));
+            glBindVertexArray(0);
+            glUseProgram(0);
+            glGenTextures(1, &_scratch_texture_id);
+            glBindTexture(GL_TEXTURE_RECTANGLE, _scratch_texture_id);
+            glTexImage2D(
+                GL_TEXTURE_RECTANGLE,
+                0,
+                GL_R32UI,
+                _canvas_size.width(),
+                _canvas_size.height(),
+                0,
+                GL_RED_INTEGER,
+                GL_UNSIGNED_INT,
+                nullptr);
+            glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+
+            // framebuffer wrapping the state texture
+            GLint previous_framebuffer_id = 0;
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer_id);
+            glGenFramebuffers(1, &_framebuffer_id);
+            glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer_id);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_RECTANGLE, _texture_id, 0);
+            const auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+            glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer_id));
+            if (status != GL_FRAMEBUFFER_COMPLETE) {
+                throw std::logic_error("the GPU scatter framebuffer is incomplete");
+            }
+        }
+
+        /// scatter clamps the age of a slice of rows on the GPU, and writes the pending events to the state texture.
+        /// The CPU cost is proportional to the number of events instead of the number of pixels.
+        /// The pixels live on the GPU, hence the sweep advances on paint. If the window did not render for a sweep
+        /// period of camera time, every pixel is clamped before the pending events are written.
+        void scatter() {
+            auto full_upload = false;
+            dvs_texels::sweep_range range{0, 0, false};
+            while (_accessing_ts_and_ons.test_and_set(std::memory_order_acquire)) {
+            }
+            _scatter_t = static_cast<uint32_t>(_current_t);
+            if (_full_upload_required) {
+                _full_upload_required = false;
+                full_upload = true;
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo_id);
+                auto buffer = reinterpret_cast<uint32_t*>(glMapBufferRange(
+                    GL_PIXEL_UNPACK_BUFFER,
+                    0,
+                    _ts_and_ons.size() * sizeof(decltype(_ts_and_ons)::value_type),
+                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+                if (!buffer) {
+                    _accessing_ts_and_ons.clear(std::memory_order_release);
+                    throw std::logic_error("glMapBufferRange returned an null pointer");
+                }
+                std::copy(_ts_and_ons.begin(), _ts_and_ons.end(), buffer);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+            _scatter_events.clear();
+            _scatter_events.swap(_events);
+            range = _age_sweep.advance(_current_t);
+            _accessing_ts_and_ons.clear(std::memory_order_release);
+            if (full_upload) {
+                glBindTexture(GL_TEXTURE_RECTANGLE, _texture_id);
+                glTexSubImage2D(
+                    GL_TEXTURE_RECTANGLE,
+                    0,
+                    0,
+                    0,
+                    _canvas_size.width(),
+                    _canvas_size.height(),
+                    GL_RED_INTEGER,
+                    GL_UNSIGNED_INT,
+                    0);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+            }
+            GLint previous_framebuffer_id = 0;
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer_id);
+            glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer_id);
+            glDisable(GL_BLEND);
+            glDisable(GL_DEPTH_TEST);
+            glDisable(GL_SCISSOR_TEST);
+            glDisable(GL_STENCIL_TEST);
+            if (range.rows > 0) {
+                glUseProgram(_clamp_program_id);
+                glUniform1ui(_clamp_current_t_location, _scatter_t);
+                glUniform1i(_clamp_all_location, range.clamp_all ? 1 : 0);
+                glBindVertexArray(_clamp_vertex_array_id);
+                glBindTexture(GL_TEXTURE_RECTANGLE, _scratch_texture_id);
+                const auto height = static_cast<std::size_t>(_canvas_size.height());
+                auto rows = range.rows;
+                for (std::size_t row = range.first_row; rows > 0;) {
+                    const auto count = std::min(rows, height - row);
+                    glCopyTexSubImage2D(
+                        GL_TEXTURE_RECTANGLE,
+                        0,
+                        0,
+                        static_cast<GLint>(row),
+                        0,
+                        static_cast<GLint>(row),
+                        _canvas_size.width(),
+                        static_cast<GLsizei>(count));
+                    glViewport(0, static_cast<GLint>(row), _canvas_size.width(), static_cast<GLsizei>(count));
+                    glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, 0);
+                    rows -= count;
+                    row = 0;
+                }
+                glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+            }
+            if (!_scatter_events.empty()) {
+                glViewport(0, 0, _canvas_size.width(), _canvas_size.height());
+                glUseProgram(_scatter_program_id);
+                glBindVertexArray(_scatter_vertex_array_id);
+                glBindBuffer(GL_ARRAY_BUFFER, _scatter_buffer_id);
+                glBufferData(
+                    GL_ARRAY_BUFFER,
+                    _scatter_events.size() * sizeof(scatter_event),
+                    _scatter_events.data(),
+                    GL_STREAM_DRAW);
+                glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(_scatter_events.size()));
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+            glBindVertexArray(0);
+            glUseProgram(0);
+            glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer_id));
+        }
+
+        /// upload_pending_tiles copies the tiles written to the pbo during the previous frame to the texture.
+        /// The pbo and the texture must be bound.
+        void upload_pending_tiles() {
+            if (_pending_full_upload) {
+                glTexSubImage2D(
+                    GL_TEXTURE_RECTANGLE,
+                    0,
+                    0,
+                    0,
+                    _canvas_size.width(),
+                    _canvas_size.height(),
+                    GL_RED_INTEGER,
+                    GL_UNSIGNED_INT,
+                    0);
+            } else {
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, _canvas_size.width());
+                for_each_dirty_row(_pending_tiles, [&](int x, int y, int width, int height) {
+                    glTexSubImage2D(
+                        GL_TEXTURE_RECTANGLE,
+                        0,
+                        x,
+                        y,
+                        width,
+                        height,
+                        GL_RED_INTEGER,
+                        GL_UNSIGNED_INT,
+                        reinterpret_cast<const void*>(
+                            (static_cast<std::size_t>(y) * _canvas_size.width() + static_cast<std::size_t>(x))
+                            * sizeof(decltype(_ts_and_ons)::value_type)));
+                });
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            }
+        }
+
         /// check_opengl_error throws if openGL generated an error.
         virtual void check_opengl_error() {
             switch (glGetError()) {
@@ -433,7 +886,20 @@ namespace chameleon {
         std::atomic_flag _accessing_style;
         QColor _background_color;
         std::vector<uint32_t> _ts_and_ons;
-        uint32_t _current_t;
+        uint64_t _current_t;
+        std::size_t _tiles_width;
+        std::size_t _tiles_height;
+        std::vector<uint64_t> _dirty_tiles;
+        bool _full_upload_required;
+        std::vector<uint64_t> _pending_tiles;
+        bool _pending_full_upload;
+        dvs_texels::age_sweep _age_sweep;
+        bool _gpu_scatter;
+        std::vector<scatter_event> _events;
+        std::vector<scatter_event> _scatter_events;
+        std::vector<uint32_t> _generations;
+        uint32_t _generation;
+        uint32_t _scatter_t;
         std::array<std::string, 3> _style_to_fragment_shader;
         std::atomic_flag _accessing_ts_and_ons;
         QRectF _paint_area;
@@ -445,7 +911,15 @@ namespace chameleon {
         std::array<GLuint, 2> _vertex_buffers_ids;
         GLuint _current_t_location;
         GLuint _parameter_location;
-        uint64_t offset_t;
+        GLuint _framebuffer_id = 0;
+        GLuint _scatter_program_id = 0;
+        GLuint _scatter_vertex_array_id = 0;
+        GLuint _scatter_buffer_id = 0;
+        GLuint _clamp_program_id = 0;
+        GLuint _clamp_vertex_array_id = 0;
+        GLint _clamp_current_t_location = 0;
+        GLint _clamp_all_location = 0;
+        GLuint _scratch_texture_id = 0;
     };
 
     /// dvs_display displays a stream of DVS events.
@@ -459,6 +933,7 @@ namespace chameleon {
         Q_PROPERTY(QVector<QString> off_colormap READ off_colormap WRITE set_off_colormap)
         Q_PROPERTY(QColor background_color READ background_color WRITE set_background_color)
         Q_PROPERTY(QRectF paint_area READ paint_area)
+        Q_PROPERTY(bool gpu_scatter READ gpu_scatter WRITE set_gpu_scatter)
         Q_ENUMS(Style)
         public:
         /// Styles lists available decay functions.
@@ -471,7 +946,8 @@ namespace chameleon {
             _on_colormap({Qt::white, Qt::darkGray}),
             _off_colormap({Qt::black, Qt::darkGray}),
             _background_color(Qt::black),
-            _style(Style::Exponential) {
+            _style(Style::Exponential),
+            _gpu_scatter(false) {
             connect(this, &QQuickItem::windowChanged, this, &dvs_display::handle_window_changed);
             _accessing_renderer.clear(std::memory_order_release);
         }
@@ -601,6 +1077,21 @@ namespace chameleon {
             return _background_color;
         }
 
+        /// set_gpu_scatter chooses between CPU state uploads (false) and GPU event scattering (true).
+        /// GPU scattering sends events instead of pixels, which is cheaper when the event rate is low compared to the
+        /// number of pixels per frame. It can only be set during qml initialization.
+        virtual void set_gpu_scatter(bool gpu_scatter) {
+            if (_ready.load(std::memory_order_acquire)) {
+                throw std::logic_error("gpu_scatter can only be set during qml construction");
+            }
+            _gpu_scatter = gpu_scatter;
+        }
+
+        /// gpu_scatter returns the current ingestion mode.
+        virtual bool gpu_scatter() const {
+            return _gpu_scatter;
+        }
+
         /// paint_area returns the paint area in window coordinates.
         virtual QRectF paint_area() const {
             return _paint_area;
@@ -634,6 +1125,13 @@ namespace chameleon {
             _dvs_display_renderer->push<Event>(event);
         }
 
+        /// advance moves the display time forward without events.
+        void advance(uint64_t t) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            _dvs_display_renderer->advance(t);
+        }
+
         /// assign sets all the pixels at once.
         template <typename Iterator>
         void assign(Iterator begin, Iterator end) {
@@ -669,7 +1167,8 @@ namespace chameleon {
                         static_cast<std::size_t>(_style),
                         _on_colormap,
                         _off_colormap,
-                        _background_color));
+                        _background_color,
+                        _gpu_scatter));
                     connect(
                         window(),
                         &QQuickWindow::beforeRendering,
@@ -739,6 +1238,7 @@ namespace chameleon {
         QVector<QColor> _on_colormap;
         QVector<QColor> _off_colormap;
         QColor _background_color;
+        bool _gpu_scatter;
         std::unique_ptr<dvs_display_renderer> _dvs_display_renderer;
         QRectF _clear_area;
         QRectF _paint_area;
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// dvs_texels encodes the most recent event of each pixel in a 32-bit texel, for dvs_display and
+    /// dvs_array_display. The 31 low bits store the timestamp modulo 2^31 (0 is reserved for pixels without events),
+    /// and the high bit stores the polarity. Shaders subtract texels from the current timestamp with unsigned
+    /// arithmetic, hence timestamps never need to be rebased. An age sweep only prevents the age of old pixels from
+    /// wrapping around.
+    namespace dvs_texels {
+        /// time_mask selects the timestamp bits of a texel.
+        constexpr uint32_t time_mask = 0x7fffffffu;
+
+        /// polarity_mask selects the polarity bit of a texel.
+        constexpr uint32_t polarity_mask = 0x80000000u;
+
+        /// maximum_age is the age above which pixels are clamped by the sweep, in µs.
+        constexpr uint32_t maximum_age = static_cast<uint32_t>(1) << 30;
+
+        /// sweep_period is the camera time needed to sweep all the rows once, in µs.
+        /// Pixels are clamped before their age reaches maximum_age + sweep_period < 2^31.
+        constexpr uint64_t sweep_period = static_cast<uint64_t>(1) << 29;
+
+        /// pack encodes a timestamp and a polarity in a texel.
+        inline uint32_t pack(uint64_t t, bool on) {
+            auto packed_t = static_cast<uint32_t>(t) & time_mask;
+            packed_t += packed_t == 0 ? 1 : 0;
+            return packed_t | (on ? polarity_mask : 0);
+        }
+
+        /// clamp_row clamps the age of the texels in [begin, end) to maximum_age.
+        /// If clamp_all is true, every texel with an event is clamped regardless of its apparent age.
+        /// It returns true if at least one texel changed.
+        inline bool clamp_row(uint32_t* begin, uint32_t* end, uint32_t current_t, bool clamp_all) {
+            auto changed = false;
+            for (; begin != end; ++begin) {
+                if ((*begin & time_mask) != 0 && (clamp_all || ((current_t - *begin) & time_mask) > maximum_age)) {
+                    *begin = pack(current_t - maximum_age, (*begin & polarity_mask) != 0);
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+
+        /// sweep_range is a slice of rows, which wraps around after the last row.
+        struct sweep_range {
+            std::size_t first_row;
+            std::size_t rows;
+
+            /// clamp_all is true if the camera time jumped by a sweep period or more since the previous sweep.
+            /// Ages may have wrapped around, hence every pixel must be clamped regardless of its apparent age.
+            bool clamp_all;
+        };
+
+        /// age_sweep cycles through the rows of a display, at a pace proportional to the camera time.
+        /// Every row is swept at least once per sweep_period of camera time, provided that advance is called whenever
+        /// the current timestamp changes (displays call it on push, not on paint, since the window may not render).
+        class age_sweep {
+            public:
+            age_sweep(std::size_t height) : _height(height), _row_period(sweep_period / height), _t(0), _row(0) {}
+
+            /// advance returns the rows to sweep at current_t, and moves past them.
+            /// Most calls return an empty range after a single comparison.
+            sweep_range advance(uint64_t current_t) {
+                if (current_t < _t + _row_period) {
+                    _t = std::min(_t, current_t);
+                    return {_row, 0, false};
+                }
+                if (current_t - _t >= sweep_period) {
+                    _t = current_t;
+                    return {_row, _height, true};
+                }
+                const auto rows = static_cast<std::size_t>((current_t - _t) / _row_period);
+                sweep_range result{_row, rows, false};
+                _t += rows * _row_period;
+                _row = (_row + rows) % _height;
+                return result;
+            }
+
+            /// reset restarts the sweep at t without clamping, after all the pixels were replaced.
+            void reset(uint64_t t) {
+                _t = t;
+            }
+
+            protected:
+            const std::size_t _height;
+            const uint64_t _row_period;
+            uint64_t _t;
+            std::size_t _row;
+        };
+    }
+}
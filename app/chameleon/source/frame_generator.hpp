@@ -7,26 +7,240 @@
 #include <QtGui/QOpenGLFunctions_3_3_Core>
 #include <QtQuick/QQuickItem>
 #include <QtQuick/QQuickWindow>
+#include <array>
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 /// chameleon provides Qt components for event stream display.
 namespace chameleon {
 
+    /// frame_format lists the video formats supported by frame_writer.
+    enum class frame_format {
+        /// rgba stores raw 8-bit RGBA frames, top row first, without header.
+        rgba,
+
+        /// y4m stores a YUV4MPEG2 stream with 4:4:4 BT.601 (limited range) samples.
+        y4m,
+    };
+
+    /// frame_writer streams frames to a file from a dedicated thread.
+    /// Frames are copied into a bounded pool of buffers, push blocks when the writer thread falls behind.
+    class frame_writer {
+        public:
+        frame_writer(
+            const std::string& filename,
+            frame_format format,
+            uint32_t frame_rate_numerator,
+            uint32_t frame_rate_denominator,
+            std::size_t capacity) :
+            _stream(filename, std::ios::binary),
+            _format(format),
+            _frame_rate_numerator(frame_rate_numerator),
+            _frame_rate_denominator(frame_rate_denominator),
+            _capacity(capacity),
+            _width(0),
+            _height(0),
+            _header_written(false),
+            _running(true),
+            _failed(false),
+            _size_changed(false) {
+            if (!_stream.good()) {
+                throw std::runtime_error(std::string("'") + filename + "' could not be open for writing");
+            }
+            if (_frame_rate_numerator == 0 || _frame_rate_denominator == 0 || _capacity == 0) {
+                throw std::logic_error("frame_writer requires a non-zero frame rate and capacity");
+            }
+            _writer = std::thread([this]() {
+                std::vector<unsigned char> line;
+                std::unique_lock<std::mutex> lock(_mutex);
+                for (;;) {
+                    _queue_changed.wait(lock, [this]() { return !_queue.empty() || !_running; });
+                    if (_queue.empty()) {
+                        break;
+                    }
+                    auto frame = std::move(_queue.front());
+                    _queue.pop_front();
+                    lock.unlock();
+                    write(frame, line);
+                    lock.lock();
+                    _available_frames.push_back(std::move(frame));
+                    _frame_available.notify_one();
+                }
+            });
+        }
+        frame_writer(const frame_writer&) = delete;
+        frame_writer(frame_writer&&) = delete;
+        frame_writer& operator=(const frame_writer&) = delete;
+        frame_writer& operator=(frame_writer&&) = delete;
+        virtual ~frame_writer() {
+            stop();
+        }
+
+        /// push copies a frame read from OpenGL (bottom row first, RGBA) and schedules its writing.
+        /// The first frame sets the video size, frames with a different size are dropped and reported by close.
+        virtual void push(const unsigned char* pixels, std::size_t width, std::size_t height) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_width == 0 && _height == 0) {
+                _width = width;
+                _height = height;
+            } else if (width != _width || height != _height) {
+                _size_changed = true;
+                return;
+            }
+            _frame_available.wait(lock, [this]() { return !_available_frames.empty() || _queue.size() < _capacity; });
+            std::vector<unsigned char> frame;
+            if (!_available_frames.empty()) {
+                frame = std::move(_available_frames.back());
+                _available_frames.pop_back();
+            }
+            lock.unlock();
+            frame.assign(pixels, pixels + width * height * 4);
+            lock.lock();
+            _queue.push_back(std::move(frame));
+            _queue_changed.notify_one();
+        }
+
+        /// close writes the pending frames and throws if an error occured.
+        virtual void close() {
+            stop();
+            if (_failed) {
+                throw std::runtime_error("writing a frame failed");
+            }
+            if (_size_changed) {
+                throw std::runtime_error("the capture area changed during the export");
+            }
+        }
+
+        protected:
+        /// stop waits for the writer thread.
+        void stop() {
+            if (_writer.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _running = false;
+                }
+                _queue_changed.notify_one();
+                _writer.join();
+                _stream.close();
+            }
+        }
+
+        /// write converts and writes a frame, from the writer thread.
+        void write(const std::vector<unsigned char>& frame, std::vector<unsigned char>& line) {
+            if (_failed) {
+                return;
+            }
+            if (_format == frame_format::rgba) {
+                for (std::size_t y = _height; y > 0; --y) {
+                    _stream.write(
+                        reinterpret_cast<const char*>(frame.data() + (y - 1) * _width * 4),
+                        static_cast<std::streamsize>(_width * 4));
+                }
+            } else {
+                if (!_header_written) {
+                    _stream << "YUV4MPEG2 W" << _width << " H" << _height << " F" << _frame_rate_numerator << ":"
+                            << _frame_rate_denominator << " Ip A1:1 C444\n";
+                    _header_written = true;
+                }
+                _stream << "FRAME\n";
+                line.resize(_width);
+                for (std::size_t plane = 0; plane < 3; ++plane) {
+                    for (std::size_t y = _height; y > 0; --y) {
+                        const auto row = frame.data() + (y - 1) * _width * 4;
+                        for (std::size_t x = 0; x < _width; ++x) {
+                            const auto r = static_cast<int32_t>(row[x * 4]);
+                            const auto g = static_cast<int32_t>(row[x * 4 + 1]);
+                            const auto b = static_cast<int32_t>(row[x * 4 + 2]);
+                            switch (plane) {
+                                case 0:
+                                    line[x] = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                                    break;
+                                case 1:
+                                    line[x] =
+                                        static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                                    break;
+                                default:
+                                    line[x] =
+                                        static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+                                    break;
+                            }
+                        }
+                        _stream.write(reinterpret_cast<const char*>(line.data()), static_cast<std::streamsize>(_width));
+                    }
+                }
+            }
+            if (!_stream.good()) {
+                _failed = true;
+            }
+        }
+
+        std::ofstream _stream;
+        const frame_format _format;
+        const uint32_t _frame_rate_numerator;
+        const uint32_t _frame_rate_denominator;
+        const std::size_t _capacity;
+        std::size_t _width;
+        std::size_t _height;
+        bool _header_written;
+        bool _running;
+        bool _failed;
+        bool _size_changed;
+        std::deque<std::vector<unsigned char>> _queue;
+        std::vector<std::vector<unsigned char>> _available_frames;
+        std::mutex _mutex;
+        std::condition_variable _queue_changed;
+        std::condition_variable _frame_available;
+        std::thread _writer;
+    };
+
     /// frame_generator_renderer handles openGL calls for a frame_generator.
+    /// Frames are read into a ring of pixel pack buffers. The readback of frame N is consumed while frame N + 2 is
+    /// rendered, so that glReadPixels returns immediately instead of waiting for the GPU.
+    /// Screenshots are consumed as soon as possible since the caller is blocked anyway.
     class frame_generator_renderer : public QObject, public QOpenGLFunctions_3_3_Core {
         Q_OBJECT
         public:
-        frame_generator_renderer() : _before_rendering_done(false), _closing(false) {
-            _rendering_not_required.clear(std::memory_order_release);
+        /// latency is the number of frames between a readback and its consumption.
+        static constexpr uint64_t latency = 2;
+
+        frame_generator_renderer() :
+            _before_rendering_done(false),
+            _screenshot_ready(false),
+            _closing(false),
+            _export_frame_latched(false),
+            _export_closing(false),
+            _export_issued(false),
+            _flush_required(false),
+            _export_flushed(false),
+            _slots_setup(false),
+            _slot_index(0),
+            _frame_index(0) {
+            _rendering_not_required.test_and_set(std::memory_order_release);
+            _export_not_required.test_and_set(std::memory_order_release);
         }
         frame_generator_renderer(const frame_generator_renderer&) = delete;
         frame_generator_renderer(frame_generator_renderer&&) = delete;
         frame_generator_renderer& operator=(const frame_generator_renderer&) = delete;
         frame_generator_renderer& operator=(frame_generator_renderer&&) = delete;
-        virtual ~frame_generator_renderer() {}
+        virtual ~frame_generator_renderer() {
+            if (_slots_setup) {
+                for (auto& slot : _slots) {
+                    if (slot.fence) {
+                        glDeleteSync(slot.fence);
+                    }
+                    glDeleteBuffers(1, &slot.pbo_id);
+                }
+            }
+        }
 
         /// set_rendering_area defines the rendering area.
         virtual void set_rendering_area(QRectF capture_area, int window_height) {
@@ -36,15 +250,13 @@ namespace chameleon {
 
         /// save_frame_to waits for a complete render, takes a screenshots and writes it to a file.
         virtual bool save_frame_to(const QString& filename) {
-            _rendering_not_required.clear(std::memory_order_release);
-            _pixels_mutex.lock();
+            std::unique_lock<std::mutex> lock(_pixels_mutex);
             if (_closing) {
-                _pixels_mutex.unlock();
                 return true;
             }
-            _pixels_mutex.unlock();
-            std::unique_lock<std::mutex> lock(_pixels_mutex);
-            _pixels_updated.wait(lock);
+            _screenshot_ready = false;
+            _rendering_not_required.clear(std::memory_order_release);
+            _pixels_updated.wait(lock, [this]() { return _screenshot_ready || _closing; });
             auto success = true;
             if (!_closing) {
                 success = QImage(
@@ -60,13 +272,60 @@ namespace chameleon {
             return success;
         }
 
+        /// start_export creates a video file, filled with export_frame.
+        virtual void
+        start_export(const std::string& filename, frame_format format, uint32_t numerator, uint32_t denominator) {
+            auto writer = std::unique_ptr<frame_writer>(new frame_writer(filename, format, numerator, denominator, 8));
+            const std::lock_guard<std::mutex> lock(_export_mutex);
+            if (_writer) {
+                throw std::logic_error("an export is already running");
+            }
+            _writer = std::move(writer);
+        }
+
+        /// export_frame requests a render and waits until its readback is issued.
+        /// The readback and the file write happen asynchronously, so the caller can prepare the next frame
+        /// immediately. request_render must schedule a window update (it is called from the caller's thread).
+        template <typename RequestRender>
+        void export_frame(RequestRender request_render) {
+            std::unique_lock<std::mutex> lock(_export_mutex);
+            if (_export_closing || !_writer) {
+                return;
+            }
+            _export_issued = false;
+            _export_not_required.clear(std::memory_order_release);
+            request_render();
+            _export_updated.wait(lock, [this]() { return _export_issued || _export_closing; });
+        }
+
+        /// stop_export writes the pending frames and closes the video file.
+        template <typename RequestRender>
+        void stop_export(RequestRender request_render) {
+            std::unique_ptr<frame_writer> writer;
+            {
+                std::unique_lock<std::mutex> lock(_export_mutex);
+                if (!_writer) {
+                    return;
+                }
+                _export_flushed = false;
+                _flush_required.store(true, std::memory_order_release);
+                request_render();
+                _export_updated.wait(lock, [this]() { return _export_flushed || _export_closing; });
+                writer = std::move(_writer);
+            }
+            writer->close();
+        }
+
         public slots:
 
         /// before_rendering_callback must be called when the window is about to be rendered.
         void before_rendering_callback() {
-            if (!_rendering_not_required.test_and_set(std::memory_order_relaxed)) {
+            if (!_rendering_not_required.test_and_set(std::memory_order_acquire)) {
                 _before_rendering_done = true;
             }
+            if (!_export_not_required.test_and_set(std::memory_order_acquire)) {
+                _export_frame_latched = true;
+            }
         }
 
         /// after_rendering_callback must be called when the window completes a rendering.
@@ -74,23 +333,67 @@ namespace chameleon {
             if (!initializeOpenGLFunctions()) {
                 throw std::runtime_error("initializing the OpenGL context failed");
             }
-            glEnable(GL_SCISSOR_TEST);
-            {
-                const std::lock_guard<std::mutex> lock(_pixels_mutex);
-                _pixels.resize(_capture_area.width() * _capture_area.height() * 4);
+            if (!_slots_setup) {
+                _slots_setup = true;
+                for (auto& slot : _slots) {
+                    glGenBuffers(1, &slot.pbo_id);
+                }
+            }
+            ++_frame_index;
+            const auto screenshot = _before_rendering_done;
+            const auto exported = _export_frame_latched;
+            _before_rendering_done = false;
+            _export_frame_latched = false;
+            if (screenshot || exported) {
+                auto& slot = _slots[_slot_index];
+                if (slot.fence) {
+                    consume(slot);
+                }
+                slot.width = static_cast<std::size_t>(_capture_area.width());
+                slot.height = static_cast<std::size_t>(_capture_area.height());
+                slot.screenshot = screenshot;
+                slot.exported = exported;
+                slot.frame_index = _frame_index;
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo_id);
+                if (slot.capacity != slot.width * slot.height * 4) {
+                    slot.capacity = slot.width * slot.height * 4;
+                    glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(slot.capacity), nullptr, GL_STREAM_READ);
+                }
+                glEnable(GL_SCISSOR_TEST);
                 glReadPixels(
                     static_cast<GLint>(_capture_area.left()),
                     static_cast<GLint>(_capture_area.top()),
-                    static_cast<GLsizei>(_capture_area.width()),
-                    static_cast<GLsizei>(_capture_area.height()),
+                    static_cast<GLsizei>(slot.width),
+                    static_cast<GLsizei>(slot.height),
                     GL_RGBA,
                     GL_UNSIGNED_BYTE,
-                    _pixels.data());
-                _image_width = _capture_area.width();
-                _image_height = _capture_area.height();
+                    0);
+                glDisable(GL_SCISSOR_TEST);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                _slot_index = (_slot_index + 1) % _slots.size();
+                if (exported) {
+                    {
+                        const std::lock_guard<std::mutex> lock(_export_mutex);
+                        _export_issued = true;
+                    }
+                    _export_updated.notify_one();
+                }
+            }
+            const auto flush = _flush_required.exchange(false, std::memory_order_acq_rel);
+            for (std::size_t index = 0; index < _slots.size(); ++index) {
+                auto& slot = _slots[(_slot_index + index) % _slots.size()];
+                if (slot.fence && (screenshot || flush || _frame_index - slot.frame_index >= latency)) {
+                    consume(slot);
+                }
+            }
+            if (flush) {
+                {
+                    const std::lock_guard<std::mutex> lock(_export_mutex);
+                    _export_flushed = true;
+                }
+                _export_updated.notify_one();
             }
-            _pixels_updated.notify_one();
-            glDisable(GL_SCISSOR_TEST);
             check_opengl_error();
         }
 
@@ -101,9 +404,62 @@ namespace chameleon {
                 _closing = true;
             }
             _pixels_updated.notify_one();
+            {
+                const std::lock_guard<std::mutex> lock(_export_mutex);
+                _export_closing = true;
+            }
+            _export_updated.notify_one();
         }
 
         protected:
+        /// pack_slot is a pixel pack buffer and the state of its readback.
+        struct pack_slot {
+            GLuint pbo_id = 0;
+            GLsync fence = nullptr;
+            std::size_t capacity = 0;
+            std::size_t width = 0;
+            std::size_t height = 0;
+            uint64_t frame_index = 0;
+            bool screenshot = false;
+            bool exported = false;
+        };
+
+        /// consume waits for a readback and dispatches its pixels.
+        void consume(pack_slot& slot) {
+            while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+            }
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo_id);
+            const auto pixels = reinterpret_cast<const unsigned char*>(
+                glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(slot.capacity), GL_MAP_READ_BIT));
+            if (!pixels) {
+                throw std::logic_error("glMapBufferRange returned an null pointer");
+            }
+            if (slot.screenshot) {
+                {
+                    const std::lock_guard<std::mutex> lock(_pixels_mutex);
+                    _pixels.assign(pixels, pixels + slot.capacity);
+                    _image_width = slot.width;
+                    _image_height = slot.height;
+                    _screenshot_ready = true;
+                }
+                _pixels_updated.notify_one();
+            }
+            if (slot.exported) {
+                frame_writer* writer = nullptr;
+                {
+                    const std::lock_guard<std::mutex> lock(_export_mutex);
+                    writer = _writer.get();
+                }
+                if (writer) {
+                    writer->push(pixels, slot.width, slot.height);
+                }
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
         /// check_opengl_error throws if openGL generated an error.
         virtual void check_opengl_error() {
             switch (glGetError()) {
@@ -121,7 +477,6 @@ namespace chameleon {
         }
 
         QRectF _capture_area;
-        // bool _program_setup;
         std::atomic_flag _rendering_not_required;
         bool _before_rendering_done;
         std::vector<unsigned char> _pixels;
@@ -129,10 +484,28 @@ namespace chameleon {
         std::condition_variable _pixels_updated;
         std::size_t _image_width;
         std::size_t _image_height;
+        bool _screenshot_ready;
         bool _closing;
+        std::atomic_flag _export_not_required;
+        bool _export_frame_latched;
+        bool _export_closing;
+        std::unique_ptr<frame_writer> _writer;
+        std::mutex _export_mutex;
+        std::condition_variable _export_updated;
+        bool _export_issued;
+        std::atomic_bool _flush_required;
+        bool _export_flushed;
+        bool _slots_setup;
+        std::array<pack_slot, latency + 1> _slots;
+        std::size_t _slot_index;
+        uint64_t _frame_index;
     };
 
-    /// frame_generator takes screenshots of the window.
+    /// frame_generator takes screenshots of the window and exports videos.
+    /// save_frame_to, export_frame and stop_export wait for the render thread to read the window back, and the render
+    /// is scheduled on the GUI thread. They must therefore be called from a worker thread, never from the GUI thread
+    /// (for instance a QML handler) or the render thread, where they would deadlock. They return immediately once the
+    /// window is closing.
     class frame_generator : public QQuickItem {
         Q_OBJECT
         public:
@@ -156,6 +529,43 @@ namespace chameleon {
             }
         }
 
+        /// start_export creates a video file at the given frame rate.
+        /// The caller prepares each frame (for instance by pushing the events of 1 / frame_rate seconds of recording)
+        /// and calls export_frame, which renders without waiting for the display refresh rate. Exports of long
+        /// recordings are therefore limited by the rendering speed rather than by the recording duration.
+        virtual void start_export(
+            const std::string& filename,
+            frame_format format,
+            uint32_t frame_rate_numerator,
+            uint32_t frame_rate_denominator = 1) {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            if (!_closing.load(std::memory_order_relaxed)) {
+                _frame_generator_renderer->start_export(filename, format, frame_rate_numerator, frame_rate_denominator);
+            }
+        }
+
+        /// export_frame renders the window and appends it to the video file.
+        /// It returns once the readback is scheduled, the conversion and the write happen on other threads.
+        /// It must be called from a worker thread (see the class description).
+        virtual void export_frame() {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            if (!_closing.load(std::memory_order_relaxed)) {
+                _frame_generator_renderer->export_frame([this]() { request_draw(); });
+            }
+        }
+
+        /// stop_export writes the pending frames and closes the video file.
+        /// It must be called from a worker thread (see the class description).
+        virtual void stop_export() {
+            while (!_renderer_ready.load(std::memory_order_acquire)) {
+            }
+            if (!_closing.load(std::memory_order_relaxed)) {
+                _frame_generator_renderer->stop_export([this]() { request_draw(); });
+            }
+        }
+
         public slots:
 
         /// sync addapts the renderer to external changes.
@@ -231,6 +641,11 @@ namespace chameleon {
         }
 
         protected:
+        /// request_draw schedules trigger_draw on the item's thread, it can be called from any thread.
+        void request_draw() {
+            QMetaObject::invokeMethod(this, "trigger_draw", Qt::QueuedConnection);
+        }
+
         std::atomic_bool _closing;
         std::atomic_bool _renderer_ready;
         std::unique_ptr<frame_generator_renderer> _frame_generator_renderer;
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/// chameleon provides Qt components for event stream display.
+namespace chameleon {
+
+    /// percentile_histogram counts 32-bit values in logarithmic buckets to estimate percentiles in constant time.
+    /// Values smaller than 2 * sub_buckets are counted exactly, larger values are split into sub_buckets buckets per
+    /// power of two (the relative error is smaller than 1 / sub_buckets). Samples can be added and removed one at a
+    /// time, so that displays keep the histogram in sync with their pixels instead of sorting them every frame.
+    class percentile_histogram {
+        public:
+        /// sub_buckets is the number of buckets per power of two.
+        static constexpr uint32_t sub_buckets = 16;
+
+        /// sub_buckets_bits is log2(sub_buckets).
+        static constexpr uint32_t sub_buckets_bits = 4;
+
+        /// exact_values is the number of values counted in their own bucket.
+        static constexpr uint32_t exact_values = 2 * sub_buckets;
+
+        /// buckets is the total number of buckets.
+        static constexpr uint32_t buckets = exact_values + (31 - sub_buckets_bits) * sub_buckets;
+
+        percentile_histogram() : _size(0) {
+            _counts.fill(0);
+        }
+        percentile_histogram(const percentile_histogram&) = default;
+        percentile_histogram(percentile_histogram&&) = default;
+        percentile_histogram& operator=(const percentile_histogram&) = default;
+        percentile_histogram& operator=(percentile_histogram&&) = default;
+        virtual ~percentile_histogram() {}
+
+        /// clear removes all the samples.
+        void clear() {
+            _counts.fill(0);
+            _size = 0;
+        }
+
+        /// add inserts one or several samples with the same value.
+        void add(uint32_t value, uint64_t count = 1) {
+            _counts[bucket(value)] += count;
+            _size += count;
+        }
+
+        /// remove erases one sample previously inserted with add.
+        void remove(uint32_t value) {
+            --_counts[bucket(value)];
+            --_size;
+        }
+
+        /// size returns the number of samples.
+        uint64_t size() const {
+            return _size;
+        }
+
+        /// at returns the value of the sample with the given rank in ascending order, rounded down to its bucket.
+        /// The rank is clamped to the last sample. The histogram must not be empty.
+        uint32_t at(uint64_t rank) const {
+            if (rank >= _size) {
+                rank = _size - 1;
+            }
+            uint64_t cumulative_count = 0;
+            for (uint32_t index = 0; index < buckets; ++index) {
+                cumulative_count += _counts[index];
+                if (cumulative_count > rank) {
+                    return lower_bound(index);
+                }
+            }
+            return lower_bound(buckets - 1);
+        }
+
+        /// front returns the smallest sample, rounded down to its bucket.
+        uint32_t front() const {
+            return at(0);
+        }
+
+        /// back returns the largest sample, rounded down to its bucket.
+        uint32_t back() const {
+            return at(_size - 1);
+        }
+
+        protected:
+        /// bucket returns the index of the bucket that contains the value.
+        static uint32_t bucket(uint32_t value) {
+            if (value < exact_values) {
+                return value;
+            }
+            uint32_t exponent = 0;
+            for (uint32_t shift = 16; shift > 0; shift >>= 1) {
+                if ((value >> (exponent + shift)) > 0) {
+                    exponent += shift;
+                }
+            }
+            return exact_values + (exponent - sub_buckets_bits - 1) * sub_buckets
+                   + ((value >> (exponent - sub_buckets_bits)) & (sub_buckets - 1));
+        }
+
+        /// lower_bound returns the smallest value in the bucket.
+        static uint32_t lower_bound(uint32_t index) {
+            if (index < exact_values) {
+                return index;
+            }
+            const auto exponent = (index - exact_values) / sub_buckets + sub_buckets_bits + 1;
+            return (sub_buckets + (index - exact_values) % sub_buckets) << (exponent - sub_buckets_bits);
+        }
+
+        std::array<uint64_t, buckets> _counts;
+        uint64_t _size;
+    };
+}
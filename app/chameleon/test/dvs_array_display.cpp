@@ -0,0 +1,108 @@
+#include "../source/dvs_array_display.hpp"
+#include "../source/background_cleaner.hpp"
+#include <QtGui/QGuiApplication>
+#include <QtQml/QQmlApplicationEngine>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+struct event {
+    uint64_t t;
+    uint16_t x;
+    uint16_t y;
+    bool on;
+};
+
+int main(int argc, char* argv[]) {
+    QGuiApplication app(argc, argv);
+    qmlRegisterType<chameleon::background_cleaner>("Chameleon", 1, 0, "BackgroundCleaner");
+    qmlRegisterType<chameleon::dvs_array_display>("Chameleon", 1, 0, "DvsArrayDisplay");
+    QQmlApplicationEngine application_engine;
+    application_engine.loadData(R""(
+        import QtQuick 2.7
+        import QtQuick.Layouts 1.1
+        import QtQuick.Window 2.2
+        import Chameleon 1.0
+        Window {
+            id: window
+            visible: true
+            width: 320 * 2
+            height: 240 * 2
+            Timer {
+                interval: 20
+                running: true
+                repeat: true
+                onTriggered: {
+                    dvs_array_display.trigger_draw();
+                }
+            }
+            BackgroundCleaner {
+                width: window.width
+                height: window.height
+                color: "#888888"
+            }
+            DvsArrayDisplay {
+                id: dvs_array_display
+                objectName: "dvs_array_display"
+                width: window.width
+                height: window.height
+                canvas_size: "320x240"
+                cameras: 4
+                parameter: 1e6
+                style: DvsArrayDisplay.Exponential
+            }
+        }
+    )"");
+    auto window = qobject_cast<QQuickWindow*>(application_engine.rootObjects().first());
+    {
+        QSurfaceFormat format;
+        format.setDepthBufferSize(24);
+        format.setStencilBufferSize(8);
+        format.setVersion(3, 3);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        window->setFormat(format);
+    }
+    auto dvs_array_display = window->findChild<chameleon::dvs_array_display*>("dvs_array_display");
+    std::atomic_bool running(true);
+
+    // each camera has its own thread, clock, and trajectory
+    std::vector<std::thread> loops;
+    for (std::size_t camera = 0; camera < 4; ++camera) {
+        loops.emplace_back([&, camera]() {
+            std::random_device random_device;
+            std::mt19937 engine(random_device());
+            std::normal_distribution<double> distribution{200, 30};
+            std::uint64_t t = camera * 1000000;
+            const auto time_reference = std::chrono::high_resolution_clock::now();
+            const auto period = 5000000 * (camera + 1);
+            while (running.load(std::memory_order_relaxed)) {
+                dvs_array_display->lock(camera);
+                for (std::size_t index = 0; index < 1000; ++index) {
+                    const event random_event{
+                        t,
+                        static_cast<uint16_t>(
+                            static_cast<uint64_t>(
+                                320.0 * (static_cast<double>(t % period) / period) + distribution(engine) + 1)
+                            % 320),
+                        static_cast<uint16_t>(
+                            static_cast<uint64_t>(
+                                240.0 * (static_cast<double>(t % period) / period) + distribution(engine) + 1)
+                            % 240),
+                        engine() < std::numeric_limits<uint_fast32_t>::max() / 2,
+                    };
+                    dvs_array_display->push_unsafe(camera, random_event);
+                    t += 20;
+                }
+                dvs_array_display->unlock(camera);
+                std::this_thread::sleep_until(time_reference + std::chrono::microseconds(t - camera * 1000000));
+            }
+        });
+    }
+    const auto error = app.exec();
+    running.store(false, std::memory_order_relaxed);
+    for (auto& loop : loops) {
+        loop.join();
+    }
+    return error;
+}
@@ -2,16 +2,27 @@
 
 #include "../common/evk4.hpp"
 #include "../common/psee413.hpp"
+#include "display_policy.hpp"
+#include "trigger_gate.hpp"
 #include "json.hpp"
+#include <cmath>
 #include <filesystem>
 #include <optional>
+#include <vector>
 
 namespace gen4 {
     struct configuration {
         std::string recordings;
         std::optional<std::string> serial;
+        std::vector<std::string> serials;
         std::size_t fifo_size;
         std::size_t drop_threshold;
+        decimation display_decimation;
+        bool display_gpu_scatter;
+        uint64_t pre_trigger_duration;
+        std::size_t pre_trigger_bytes;
+        trigger_configuration trigger;
+        uint16_t metrics_port;
         sepia::evk4::parameters evk4_parameters;
         sepia::psee413::parameters psee413_parameters;
 
@@ -23,8 +34,46 @@ namespace gen4 {
             if (!data["serial"].is_null()) {
                 result.serial = data["serial"];
             }
+            if (data.contains("serials") && !data["serials"].is_null()) {
+                for (const auto& serial : data["serials"]) {
+                    result.serials.push_back(serial.get<std::string>());
+                }
+            }
             result.fifo_size = data["fifo_size"];
             result.drop_threshold = data["drop_threshold"];
+            result.display_decimation = decimation::buffers;
+            if (data.contains("display_decimation")) {
+                result.display_decimation = string_to_decimation(data["display_decimation"]);
+            }
+            result.display_gpu_scatter = false;
+            if (data.contains("display_gpu_scatter")) {
+                result.display_gpu_scatter = data["display_gpu_scatter"];
+            }
+            if (result.display_gpu_scatter && result.serials.size() > 1) {
+                throw std::runtime_error("display_gpu_scatter is not supported with several serials");
+            }
+            result.pre_trigger_duration = 0;
+            result.pre_trigger_bytes = 0;
+            if (data.contains("pre_trigger")) {
+                result.pre_trigger_duration =
+                    static_cast<uint64_t>(std::round(data["pre_trigger"]["duration"].get<double>() * 1e6));
+                result.pre_trigger_bytes = data["pre_trigger"]["bytes"];
+            }
+            result.trigger = {false, 0, trigger_edge::rising, false, 0, 0, 0};
+            if (data.contains("trigger") && !data["trigger"].is_null()) {
+                result.trigger.enabled = true;
+                result.trigger.id = data["trigger"]["id"];
+                result.trigger.edge = string_to_trigger_edge(data["trigger"]["edge"]);
+                result.trigger.gate = data["trigger"]["gate"];
+                result.trigger.before =
+                    static_cast<uint64_t>(std::round(data["trigger"]["before"].get<double>() * 1e6));
+                result.trigger.after = static_cast<uint64_t>(std::round(data["trigger"]["after"].get<double>() * 1e6));
+                result.trigger.history = data["trigger"]["history"];
+            }
+            result.metrics_port = 0;
+            if (data.contains("metrics") && !data["metrics"].is_null()) {
+                result.metrics_port = data["metrics"]["port"];
+            }
             result.evk4_parameters.biases.pr = data["evk4"]["biases"]["pr"];
             result.evk4_parameters.biases.fo = data["evk4"]["biases"]["fo"];
             result.evk4_parameters.biases.hpf = data["evk4"]["biases"]["hpf"];
@@ -45,6 +94,12 @@ namespace gen4 {
                 result.evk4_parameters.y_mask[index] = data["evk4"]["y_mask"][index];
             }
             result.evk4_parameters.mask_intersection_only = data["evk4"]["mask_intersection_only"];
+            result.evk4_parameters.erc = sepia::evk4::default_parameters.erc;
+            if (data["evk4"].contains("erc")) {
+                result.evk4_parameters.erc.enable = data["evk4"]["erc"]["enable"];
+                result.evk4_parameters.erc.target_event_rate = data["evk4"]["erc"]["target_event_rate"];
+                result.evk4_parameters.erc.reference_period = data["evk4"]["erc"]["reference_period"];
+            }
             result.psee413_parameters.biases.pr = data["psee413"]["biases"]["pr"];
             result.psee413_parameters.biases.fo_p = data["psee413"]["biases"]["fo_p"];
             result.psee413_parameters.biases.fo_n = data["psee413"]["biases"]["fo_n"];
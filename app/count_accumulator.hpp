@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace gen4 {
+    /// pixel_count represents the number of events of a pixel during a window.
+    struct pixel_count {
+        uint16_t x;
+        uint16_t y;
+        uint32_t count;
+    };
+
+    /// count_accumulator counts events per pixel over consecutive windows.
+    /// Pixels are stamped with the epoch of their last update and reset lazily on their first update in a new
+    /// window, hence closing a window costs O(1) instead of a full-frame fill.
+    class count_accumulator {
+        public:
+        count_accumulator(uint16_t width, uint16_t height, uint32_t initial_count) :
+            _width(width), _initial_count(initial_count), _epoch(1) {
+            for (auto& window : _windows) {
+                window.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(height), {0, 0});
+            }
+            for (auto& touched : _touched) {
+                touched.reserve(static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+            }
+            _snapshot.reserve(static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+        }
+        count_accumulator(const count_accumulator&) = delete;
+        count_accumulator(count_accumulator&&) = default;
+        count_accumulator& operator=(const count_accumulator&) = delete;
+        count_accumulator& operator=(count_accumulator&&) = default;
+        virtual ~count_accumulator() {}
+
+        /// push increments the count of a pixel in the active window.
+        void push(uint16_t x, uint16_t y) {
+            const auto index = static_cast<std::size_t>(x) + static_cast<std::size_t>(y) * _width;
+            auto& pixel = _windows[_epoch & 1][index];
+            if (pixel.epoch != _epoch) {
+                pixel.epoch = _epoch;
+                pixel.count = _initial_count;
+                _touched[_epoch & 1].push_back(index);
+            }
+            ++pixel.count;
+        }
+
+        /// swap closes the active window and opens a new one.
+        /// The closed window remains readable with snapshot until the next swap.
+        void swap() {
+            if (_epoch == std::numeric_limits<uint32_t>::max()) {
+                restamp();
+            }
+            ++_epoch;
+            _touched[_epoch & 1].clear();
+        }
+
+        /// reset discards both windows and forgets the last snapshot.
+        /// The consumer is expected to reset its own state to the initial count.
+        void reset() {
+            swap();
+            swap();
+            _snapshot.clear();
+        }
+
+        /// snapshot writes the changes between the previous snapshot and the closed window.
+        /// Pixels set by the previous snapshot are first reset to the initial count, then the pixels updated during the
+        /// closed window are written with their count. The cost is proportional to the number of touched pixels.
+        void snapshot(std::vector<pixel_count>& updates) {
+            updates.clear();
+            for (const auto index : _snapshot) {
+                updates.push_back({
+                    static_cast<uint16_t>(index % _width),
+                    static_cast<uint16_t>(index / _width),
+                    _initial_count,
+                });
+            }
+            const auto& window = _windows[(_epoch - 1) & 1];
+            const auto& touched = _touched[(_epoch - 1) & 1];
+            _snapshot.assign(touched.begin(), touched.end());
+            for (const auto index : touched) {
+                updates.push_back({
+                    static_cast<uint16_t>(index % _width),
+                    static_cast<uint16_t>(index / _width),
+                    window[index].count,
+                });
+            }
+        }
+
+        protected:
+        /// stamped_count associates a count with the epoch of its last update.
+        struct stamped_count {
+            uint32_t epoch;
+            uint32_t count;
+        };
+
+        /// restamp rewinds the epochs before they overflow.
+        /// This full pass happens once every 2^32 windows.
+        void restamp() {
+            for (uint32_t parity = 0; parity < 2; ++parity) {
+                const auto epoch = parity == (_epoch & 1) ? 3u : 2u;
+                for (auto& pixel : _windows[parity]) {
+                    pixel.epoch = pixel.epoch == _epoch || pixel.epoch == _epoch - 1 ? epoch : 0;
+                }
+            }
+            _epoch = 3;
+        }
+
+        uint16_t _width;
+        uint32_t _initial_count;
+        uint32_t _epoch;
+        std::array<std::vector<stamped_count>, 2> _windows;
+        std::array<std::vector<std::size_t>, 2> _touched;
+        std::vector<std::size_t> _snapshot;
+    };
+}
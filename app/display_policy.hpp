@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace gen4 {
+    /// decimation lists the strategies used to reduce the display input.
+    enum class decimation {
+        buffers,
+        rows,
+    };
+
+    /// string_to_decimation converts a configuration value.
+    inline decimation string_to_decimation(const std::string& value) {
+        if (value == "buffers") {
+            return decimation::buffers;
+        }
+        if (value == "rows") {
+            return decimation::rows;
+        }
+        throw std::runtime_error("unknown display decimation \"" + value + "\" (expected \"buffers\" or \"rows\")");
+    }
+
+    /// display_policy decides which part of the input reaches the display as the backlog grows.
+    /// The level increases by one every time the backlog doubles past the threshold, and each level halves the
+    /// display input, either by skipping buffers or by skipping rows. The policy never applies to the recording sink:
+    /// the caller must decode every buffer while recording, regardless of the display decision.
+    class display_policy {
+        public:
+        /// maximum_level bounds the decimation to one buffer or row out of 2^maximum_level.
+        static constexpr uint32_t maximum_level = 8;
+
+        display_policy(std::size_t threshold, decimation mode) :
+            _threshold(threshold), _mode(mode), _level(0), _buffer_index(0), _display_buffer(true), _rows_mask(0) {}
+        display_policy(const display_policy&) = default;
+        display_policy(display_policy&&) = default;
+        display_policy& operator=(const display_policy&) = default;
+        display_policy& operator=(display_policy&&) = default;
+        virtual ~display_policy() {}
+
+        /// update must be called before each buffer with the current backlog.
+        /// It returns true if the display needs the buffer's events.
+        bool update(std::size_t fifo_used) {
+            _level = 0;
+            if (_threshold > 0) {
+                for (auto backlog = fifo_used / _threshold; backlog > 0 && _level < maximum_level; backlog >>= 1) {
+                    ++_level;
+                }
+            }
+            const auto mask = (static_cast<uint64_t>(1) << _level) - 1;
+            if (_mode == decimation::buffers) {
+                _display_buffer = (_buffer_index & mask) == 0;
+                _rows_mask = 0;
+            } else {
+                _display_buffer = true;
+                _rows_mask = static_cast<uint16_t>(mask);
+            }
+            ++_buffer_index;
+            return _display_buffer;
+        }
+
+        /// display returns true if the event must be sent to the display.
+        template <typename Event>
+        bool display(const Event& event) const {
+            return _display_buffer && (event.y & _rows_mask) == 0;
+        }
+
+        /// level returns the current degradation level (0 means that the display gets every event).
+        uint32_t level() const {
+            return _level;
+        }
+
+        /// mode returns the decimation strategy.
+        decimation mode() const {
+            return _mode;
+        }
+
+        protected:
+        std::size_t _threshold;
+        decimation _mode;
+        uint32_t _level;
+        uint64_t _buffer_index;
+        bool _display_buffer;
+        uint16_t _rows_mask;
+    };
+}
@@ -0,0 +1,188 @@
+#include "../common/es_reader.hpp"
+#include "chameleon/source/dvs_display.hpp"
+#include "chameleon/source/frame_generator.hpp"
+#include "pontella.hpp"
+#include <QtGui/QGuiApplication>
+#include <QtQml/QQmlApplicationEngine>
+#include <QtQml/QQmlContext>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+int main(int argc, char* argv[]) {
+    return pontella::main(
+        {"es_to_video renders the DVS events of an Event Stream file to a video",
+         "Syntax: es_to_video [options] /path/to/input.es /path/to/output.y4m",
+         "The output is a YUV4MPEG2 stream if its extension is .y4m, and raw RGBA frames otherwise.",
+         "Frames are rendered as fast as the GPU allows, independently of the display refresh rate.",
+         "Run with QT_QPA_PLATFORM=offscreen to render without showing the window.",
+         "Available options:",
+         "    -t [rate], --frame-rate [rate]       sets the video frame rate in frames per second",
+         "                                             defaults to 30",
+         "    -p [decay], --parameter [decay]      sets the display decay in µs",
+         "                                             defaults to 100000",
+         "    -b [t], --begin [t]                  ignores events before t (in µs)",
+         "                                             defaults to 0",
+         "    -e [t], --end [t]                    ignores events after t (in µs)",
+         "                                             defaults to the end of the file",
+         "    -h, --help                           shows this help message"},
+        argc,
+        argv,
+        2,
+        {
+            {"frame-rate", {"t"}},
+            {"parameter", {"p"}},
+            {"begin", {"b"}},
+            {"end", {"e"}},
+        },
+        {},
+        [&](pontella::command command) {
+            uint32_t frame_rate = 30;
+            {
+                auto frame_rate_candidate = command.options.find("frame-rate");
+                if (frame_rate_candidate != command.options.end()) {
+                    frame_rate = static_cast<uint32_t>(std::stoul(frame_rate_candidate->second));
+                }
+            }
+            float parameter = 1e5f;
+            {
+                auto parameter_candidate = command.options.find("parameter");
+                if (parameter_candidate != command.options.end()) {
+                    parameter = std::stof(parameter_candidate->second);
+                }
+            }
+            uint64_t begin_t = 0;
+            {
+                auto begin_candidate = command.options.find("begin");
+                if (begin_candidate != command.options.end()) {
+                    begin_t = std::stoull(begin_candidate->second);
+                }
+            }
+            auto end_t = std::numeric_limits<uint64_t>::max();
+            {
+                auto end_candidate = command.options.find("end");
+                if (end_candidate != command.options.end()) {
+                    end_t = std::stoull(end_candidate->second);
+                }
+            }
+            if (frame_rate == 0 || parameter <= 0.0f || end_t <= begin_t) {
+                throw std::runtime_error("the export parameters are out of range");
+            }
+            const auto& input = command.arguments[0];
+            const auto& output = command.arguments[1];
+            const auto format = output.size() >= 4 && output.compare(output.size() - 4, 4, ".y4m") == 0 ?
+                                    chameleon::frame_format::y4m :
+                                    chameleon::frame_format::rgba;
+            const auto frame_duration = std::max(static_cast<uint64_t>(1), static_cast<uint64_t>(1000000 / frame_rate));
+            auto reader = sepia::es::make_reader<std::vector<sepia::dvs_event>>(
+                input,
+                []() { return std::vector<sepia::dvs_event>(); },
+                [](std::vector<sepia::dvs_event>& chunk, sepia::dvs_event event) { chunk.push_back(event); },
+                0,
+                frame_duration,
+                begin_t,
+                end_t);
+            const auto header = reader->header();
+
+            int qt_argc = 1;
+            char* qt_argv[] = {argv[0], nullptr};
+            QGuiApplication app(qt_argc, qt_argv);
+            qmlRegisterType<chameleon::dvs_display>("Chameleon", 1, 0, "DvsDisplay");
+            qmlRegisterType<chameleon::frame_generator>("Chameleon", 1, 0, "FrameGenerator");
+            QQmlApplicationEngine application_engine;
+            application_engine.rootContext()->setContextProperty("header_width", QVariant(header.width));
+            application_engine.rootContext()->setContextProperty("header_height", QVariant(header.height));
+            application_engine.rootContext()->setContextProperty("decay", QVariant(parameter));
+            application_engine.loadData(R""(
+                import QtQuick 2.7
+                import QtQuick.Window 2.2
+                import Chameleon 1.0
+                Window {
+                    id: window
+                    visible: true
+                    width: header_width
+                    height: header_height
+                    maximumWidth: header_width
+                    maximumHeight: header_height
+                    minimumWidth: header_width
+                    minimumHeight: header_height
+                    FrameGenerator {
+                        objectName: "frame_generator"
+                        width: window.width
+                        height: window.height
+                    }
+                    DvsDisplay {
+                        objectName: "dvs_display"
+                        width: window.width
+                        height: window.height
+                        canvas_size: Qt.size(header_width, header_height)
+                        parameter: decay
+                        style: DvsDisplay.Linear
+                        on_colormap: ['#F4C20D', '#191919']
+                        off_colormap: ['#1E88E5', '#191919']
+                    }
+                }
+            )"");
+            auto window = qobject_cast<QQuickWindow*>(application_engine.rootObjects().first());
+            {
+                QSurfaceFormat format;
+                format.setDepthBufferSize(24);
+                format.setStencilBufferSize(8);
+                format.setVersion(3, 3);
+                format.setProfile(QSurfaceFormat::CoreProfile);
+                window->setFormat(format);
+            }
+            auto dvs_display = window->findChild<chameleon::dvs_display*>("dvs_display");
+            auto frame_generator = window->findChild<chameleon::frame_generator*>("frame_generator");
+
+            // export_frame waits for renders scheduled on the GUI thread, hence frames are driven by a worker thread
+            std::atomic_bool running(true);
+            std::exception_ptr exception;
+            uint64_t frames = 0;
+            std::thread worker([&]() {
+                try {
+                    // the video frame rate matches the rounded frame duration, so that the video does not drift
+                    frame_generator->start_export(output, format, 1000000, static_cast<uint32_t>(frame_duration));
+                    // the display time follows the frames rather than the events, so that quiet periods decay
+                    const auto export_frame = [&]() {
+                        dvs_display->advance(begin_t + (frames + 1) * frame_duration);
+                        frame_generator->export_frame();
+                        ++frames;
+                    };
+                    std::vector<sepia::dvs_event> chunk;
+                    while (running.load(std::memory_order_acquire) && reader->next(chunk)) {
+                        // chunks are aligned on begin_t and empty windows are skipped
+                        const auto chunk_frame = (chunk.front().t - begin_t) / frame_duration;
+                        while (frames < chunk_frame && running.load(std::memory_order_acquire)) {
+                            export_frame();
+                        }
+                        for (const auto event : chunk) {
+                            dvs_display->push(event);
+                        }
+                        export_frame();
+                    }
+                    // trailing frames let the last events fade out, unless the end option cuts them
+                    if (frames > 0) {
+                        const auto last_frame =
+                            frames + static_cast<uint64_t>(std::ceil(parameter / static_cast<float>(frame_duration)));
+                        while (frames < last_frame && begin_t + frames * frame_duration < end_t
+                               && running.load(std::memory_order_acquire)) {
+                            export_frame();
+                        }
+                    }
+                    frame_generator->stop_export();
+                } catch (...) {
+                    exception = std::current_exception();
+                }
+                QMetaObject::invokeMethod(&app, "quit", Qt::QueuedConnection);
+            });
+            app.exec();
+            running.store(false, std::memory_order_release);
+            worker.join();
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+            std::cout << "{\"frames\":" << frames << ",\"output\":\"" << output << "\"}" << std::endl;
+        });
+}
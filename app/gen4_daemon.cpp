@@ -0,0 +1,479 @@
+#include "async_filebuf.hpp"
+#include "configuration.hpp"
+#include "metrics.hpp"
+#include "pontella.hpp"
+#include "pre_trigger.hpp"
+#include "trigger_gate.hpp"
+#include "utilities.hpp"
+#include <atomic>
+#include <cmath>
+#include <csignal>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <thread>
+
+constexpr std::size_t chunk_size = 1 << 20;
+constexpr std::size_t chunks_count = 64;
+
+volatile std::sig_atomic_t quit_required = 0;
+volatile std::sig_atomic_t signal_start_required = 0;
+volatile std::sig_atomic_t signal_stop_required = 0;
+
+extern "C" void handle_signal(int signal) {
+    switch (signal) {
+#if defined(SIGUSR1) && defined(SIGUSR2)
+        case SIGUSR1:
+            signal_start_required = 1;
+            break;
+        case SIGUSR2:
+            signal_stop_required = 1;
+            break;
+#endif
+        default:
+            quit_required = 1;
+            break;
+    }
+}
+
+/// statistics are written by the acquisition threads and read by the main thread.
+struct statistics {
+    std::atomic<uint64_t> on_events;
+    std::atomic<uint64_t> off_events;
+    std::atomic<uint64_t> buffers;
+    std::atomic<uint64_t> dropped_buffers;
+    std::atomic<uint64_t> fifo_used;
+    std::atomic<uint64_t> recorded_duration;
+    std::atomic<bool> recording;
+    std::atomic<std::size_t> clips;
+};
+
+/// commands are written by the standard input thread and read by the main thread.
+/// The standard input thread is detached and may outlive main's scope, hence it shares ownership of the commands.
+struct commands {
+    std::atomic_bool start_required;
+    std::atomic_bool stop_required;
+    std::atomic_bool quit;
+};
+
+int main(int argc, char* argv[]) {
+    return pontella::main(
+        {"gen4_daemon records events from a Gen4 camera without a graphical interface",
+         "Syntax: gen4_daemon [options]",
+         "Recordings are started and stopped with the lines \"start\" and \"stop\" on the standard input,",
+         "or with the signals SIGUSR1 and SIGUSR2. \"quit\", SIGINT, and SIGTERM close the program.",
+         "Available options:",
+         "    -c [path], --configuration [path]    sets the JSON configuration path",
+         "                                             defaults to \"configuration.json\"",
+         "    -d [cpu], --decode-cpu [cpu]         pins the decode thread to the given CPU",
+         "    -w [cpu], --writer-cpu [cpu]         pins the file writer thread to the given CPU",
+         "    -s [seconds], --stats [seconds]      sets the statistics period",
+         "                                             defaults to 1",
+         "    -r, --record                         starts recording immediately",
+         "    -h, --help                           shows this help message"},
+        argc,
+        argv,
+        0,
+        {
+            {"configuration", {"c"}},
+            {"decode-cpu", {"d"}},
+            {"writer-cpu", {"w"}},
+            {"stats", {"s"}},
+        },
+        {
+            {"record", {"r"}},
+        },
+        [&](pontella::command command) {
+            gen4::configuration configuration;
+            {
+                auto configuration_candidate = command.options.find("configuration");
+                if (configuration_candidate == command.options.end()) {
+                    const auto default_path = std::filesystem::current_path() / "configuration.json";
+                    configuration = gen4::configuration::from_path(default_path);
+                } else {
+                    configuration = gen4::configuration::from_path(configuration_candidate->second);
+                }
+            }
+            std::filesystem::create_directories(configuration.recordings);
+            std::optional<std::size_t> decode_cpu;
+            {
+                auto decode_cpu_candidate = command.options.find("decode-cpu");
+                if (decode_cpu_candidate != command.options.end()) {
+                    decode_cpu = std::stoull(decode_cpu_candidate->second);
+                }
+            }
+            std::chrono::milliseconds stats_period(1000);
+            {
+                auto stats_candidate = command.options.find("stats");
+                if (stats_candidate != command.options.end()) {
+                    stats_period = std::chrono::milliseconds(
+                        static_cast<int64_t>(std::round(std::stod(stats_candidate->second) * 1000.0)));
+                    if (stats_period.count() <= 0) {
+                        throw std::runtime_error("the statistics period must be larger than zero");
+                    }
+                }
+            }
+
+            // serial
+            sepia::usb::device_properties device{
+                0,
+                "",
+                sepia::usb::device_speed::unknown,
+            };
+            if (configuration.serial.has_value()) {
+                device.serial = configuration.serial.value();
+            }
+            {
+                auto found = false;
+                for (const auto& available_device : sepia::psee::available_devices()) {
+                    if (device.serial.empty() || available_device.serial == device.serial) {
+                        if (available_device.type == sepia::psee::EVK3_HD
+                            || available_device.type == sepia::psee::EVK4) {
+                            device = available_device;
+                            found = true;
+                            break;
+                        }
+                    }
+                }
+                if (!found) {
+                    if (!device.serial.empty()) {
+                        throw sepia::usb::serial_not_available(sepia::evk4::name, device.serial);
+                    }
+                    throw sepia::no_device_connected(std::string(sepia::evk4::name) + " or " + sepia::psee413::name);
+                }
+            }
+            std::ofstream control_events(
+                sepia::join({configuration.recordings, device.serial + "_control_events.jsonl"}), std::ostream::app);
+            {
+                const auto initialisation_timestamp = gen4::utc_timestamp();
+                const auto biases_names = device.type == sepia::psee::EVK4 ? sepia::evk4::bias_currents::names() :
+                                                                             sepia::psee413::bias_currents::names();
+                for (const auto& name : biases_names) {
+                    const auto value = device.type == sepia::psee::EVK4 ?
+                                           configuration.evk4_parameters.biases.by_name(name) :
+                                           configuration.psee413_parameters.biases.by_name(name);
+                    gen4::control_log(
+                        control_events, initialisation_timestamp, name, std::to_string(static_cast<int32_t>(value)));
+                }
+            }
+
+            // recording sink
+            gen4::async_filebuf filebuf(chunk_size, chunks_count);
+            std::ostream file_stream(&filebuf);
+            std::unique_ptr<gen4::trigger_gate> trigger_gate;
+            if (configuration.trigger.enabled) {
+                trigger_gate = sepia::make_unique<gen4::trigger_gate>(
+                    configuration.trigger, sepia::evk4::width, sepia::evk4::height, control_events);
+            }
+            {
+                auto writer_cpu_candidate = command.options.find("writer-cpu");
+                if (writer_cpu_candidate != command.options.end()) {
+                    const auto writer_cpu = std::stoull(writer_cpu_candidate->second);
+                    if (!gen4::pin_thread(filebuf.writer().native_handle(), writer_cpu)
+                        || (trigger_gate && !gen4::pin_thread(trigger_gate->writer().native_handle(), writer_cpu))) {
+                        std::cerr << "Warning: thread pinning is not supported on this platform\n";
+                    }
+                }
+            }
+
+            // commands
+            auto shared_commands = std::make_shared<commands>();
+            shared_commands->start_required.store(
+                command.flags.find("record") != command.flags.end(), std::memory_order_release);
+            shared_commands->stop_required.store(false, std::memory_order_release);
+            shared_commands->quit.store(false, std::memory_order_release);
+            std::signal(SIGINT, handle_signal);
+            std::signal(SIGTERM, handle_signal);
+#if defined(SIGUSR1) && defined(SIGUSR2)
+            std::signal(SIGUSR1, handle_signal);
+            std::signal(SIGUSR2, handle_signal);
+#endif
+            std::thread([shared_commands]() {
+                std::string line;
+                while (std::getline(std::cin, line)) {
+                    if (line == "start") {
+                        shared_commands->start_required.store(true, std::memory_order_release);
+                    } else if (line == "stop") {
+                        shared_commands->stop_required.store(true, std::memory_order_release);
+                    } else if (line == "quit") {
+                        shared_commands->quit.store(true, std::memory_order_release);
+                        break;
+                    } else if (!line.empty()) {
+                        std::cerr << (std::string("unknown command \"") + line + "\"\n");
+                        std::cerr.flush();
+                    }
+                }
+            }).detach();
+
+            // acquisition
+            statistics shared_statistics{};
+            std::string filename;
+            std::string filename_timestamp;
+            std::unique_ptr<sepia::write_to_reference<sepia::type::dvs>> write;
+            uint64_t initial_t = 0;
+            uint64_t previous_t = 0;
+            auto initial_t_set = false;
+            uint64_t on_events = 0;
+            uint64_t off_events = 0;
+            auto pinned = false;
+            std::exception_ptr camera_exception;
+            gen4::pre_trigger_ring pre_trigger(
+                configuration.pre_trigger_duration > 0 ? configuration.pre_trigger_bytes : 0,
+                configuration.pre_trigger_duration);
+            std::function<void()> replay_pre_trigger;
+            auto record = [&](sepia::dvs_event event) {
+                if (!initial_t_set) {
+                    initial_t_set = true;
+                    initial_t = event.t;
+                    std::stringstream message;
+                    message << "{\"filename\":\"" << filename << "\",\"initial_t\":" << initial_t
+                            << ",\"filename_timestamp\":\"" << filename_timestamp << "\"}";
+                    gen4::control_log(control_events, gen4::utc_timestamp(), "start_recording", message.str());
+                }
+                event.t -= initial_t;
+                write->operator()(event);
+            };
+            gen4::pipeline_metrics metrics;
+            gen4::camera_metrics camera_metrics;
+            uint64_t decoded_events = 0;
+            std::chrono::steady_clock::time_point buffer_begin;
+            auto handle_event = [&](sepia::dvs_event event) {
+                ++decoded_events;
+                if (event.on) {
+                    ++on_events;
+                } else {
+                    ++off_events;
+                }
+                previous_t = event.t;
+                if (write) {
+                    record(event);
+                } else if (trigger_gate) {
+                    trigger_gate->push(event);
+                }
+            };
+            auto handle_trigger_event = [&](sepia::evk4::trigger_event event) {
+                std::stringstream message;
+                message << "{\"t\":" << event.t << ",\"system_timestamp\":" << event.system_timestamp
+                        << ",\"id\":" << static_cast<int32_t>(event.id)
+                        << ",\"rising\":" << (event.rising ? "true" : "false") << "}";
+                gen4::control_log(control_events, gen4::utc_timestamp(), "trigger_event", message.str());
+                if (trigger_gate) {
+                    trigger_gate->trigger(event.t, event.id, event.rising);
+                }
+            };
+            auto before_buffer = [&](std::size_t fifo_used, std::size_t) {
+                if (!pinned) {
+                    pinned = true;
+                    if (decode_cpu && !gen4::pin_current_thread(decode_cpu.value())) {
+                        std::cerr << "Warning: thread pinning is not supported on this platform\n";
+                    }
+                }
+                shared_statistics.fifo_used.store(fifo_used, std::memory_order_relaxed);
+                buffer_begin = std::chrono::steady_clock::now();
+                return true;
+            };
+            auto after_buffer = [&]() {
+                const auto buffer_end = std::chrono::steady_clock::now();
+                camera_metrics.decode_duration.add(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(buffer_end - buffer_begin).count()));
+                camera_metrics.decoded_buffers.add(1);
+                camera_metrics.events.add(decoded_events);
+                decoded_events = 0;
+                shared_statistics.on_events.store(on_events, std::memory_order_relaxed);
+                shared_statistics.off_events.store(off_events, std::memory_order_relaxed);
+                shared_statistics.buffers.fetch_add(1, std::memory_order_relaxed);
+                if (trigger_gate && trigger_gate->armed()) {
+                    shared_statistics.clips.store(trigger_gate->clips(), std::memory_order_relaxed);
+                    if (shared_commands->stop_required.exchange(false, std::memory_order_acq_rel)) {
+                        trigger_gate->disarm();
+                        shared_statistics.recording.store(false, std::memory_order_release);
+                    }
+                } else if (write) {
+                    shared_statistics.recorded_duration.store(previous_t - initial_t, std::memory_order_relaxed);
+                    if (shared_commands->stop_required.exchange(false, std::memory_order_acq_rel)) {
+                        write.reset();
+                        filebuf.close();
+                        shared_statistics.recording.store(false, std::memory_order_release);
+                        gen4::control_log(
+                            control_events,
+                            gen4::utc_timestamp(),
+                            "stop_recording",
+                            std::string("\"") + filename + "\"");
+                        filename.clear();
+                    }
+                } else if (trigger_gate && shared_commands->start_required.exchange(false, std::memory_order_acq_rel)) {
+                    shared_commands->stop_required.store(false, std::memory_order_release);
+                    trigger_gate->arm(configuration.recordings, gen4::utc_timestamp_and_filename().second);
+                    shared_statistics.clips.store(0, std::memory_order_relaxed);
+                    shared_statistics.recording.store(true, std::memory_order_release);
+                } else if (shared_commands->start_required.exchange(false, std::memory_order_acq_rel)) {
+                    shared_commands->stop_required.store(false, std::memory_order_release);
+                    const auto [timestamp, stem] = gen4::utc_timestamp_and_filename();
+                    filename = sepia::join({configuration.recordings, stem + ".es"});
+                    filename_timestamp = timestamp;
+                    initial_t_set = false;
+                    initial_t = previous_t;
+                    filebuf.open(filename);
+                    write = std::make_unique<sepia::write_to_reference<sepia::type::dvs>>(
+                        file_stream, sepia::evk4::width, sepia::evk4::height);
+                    replay_pre_trigger();
+                    shared_statistics.recorded_duration.store(0, std::memory_order_relaxed);
+                    shared_statistics.recording.store(true, std::memory_order_release);
+                }
+            };
+            auto handle_exception = [&](std::exception_ptr exception) {
+                camera_exception = exception;
+                shared_commands->quit.store(true, std::memory_order_release);
+            };
+            auto handle_drop = [&]() { shared_statistics.dropped_buffers.fetch_add(1, std::memory_order_relaxed); };
+            auto handle_pre_trigger_event = [&](sepia::dvs_event event) { record(event); };
+            auto handle_pre_trigger_trigger_event = [](sepia::evk4::trigger_event) {};
+            auto before_pre_trigger_buffer = [](std::size_t, std::size_t) { return true; };
+            auto after_pre_trigger_buffer = []() {};
+            std::unique_ptr<sepia::camera> camera;
+            if (device.type == sepia::psee::EVK4) {
+                using decode = sepia::evk4::decode<
+                    decltype(handle_event),
+                    decltype(handle_trigger_event),
+                    decltype(before_buffer)&,
+                    decltype(after_buffer)&>;
+                sepia::evk4::decode<
+                    decltype(handle_pre_trigger_event)&,
+                    decltype(handle_pre_trigger_trigger_event)&,
+                    decltype(before_pre_trigger_buffer)&,
+                    decltype(after_pre_trigger_buffer)&>
+                    pre_trigger_decode(
+                        handle_pre_trigger_event,
+                        handle_pre_trigger_trigger_event,
+                        before_pre_trigger_buffer,
+                        after_pre_trigger_buffer);
+                replay_pre_trigger = [&pre_trigger, pre_trigger_decode]() mutable {
+                    pre_trigger.replay(pre_trigger_decode);
+                };
+                camera = sepia::make_unique<
+                    sepia::evk4::buffered_camera<gen4::record_history<decode>, decltype(handle_exception)&>>(
+                    gen4::record_history<decode>(
+                        decode(std::move(handle_event), std::move(handle_trigger_event), before_buffer, after_buffer),
+                        pre_trigger),
+                    handle_exception,
+                    configuration.evk4_parameters,
+                    device.serial,
+                    std::chrono::milliseconds(100),
+                    64,
+                    configuration.fifo_size,
+                    handle_drop);
+            } else {
+                using decode = sepia::psee413::decode<
+                    decltype(handle_event),
+                    decltype(handle_trigger_event),
+                    decltype(before_buffer)&,
+                    decltype(after_buffer)&>;
+                sepia::psee413::decode<
+                    decltype(handle_pre_trigger_event)&,
+                    decltype(handle_pre_trigger_trigger_event)&,
+                    decltype(before_pre_trigger_buffer)&,
+                    decltype(after_pre_trigger_buffer)&>
+                    pre_trigger_decode(
+                        handle_pre_trigger_event,
+                        handle_pre_trigger_trigger_event,
+                        before_pre_trigger_buffer,
+                        after_pre_trigger_buffer);
+                replay_pre_trigger = [&pre_trigger, pre_trigger_decode]() mutable {
+                    pre_trigger.replay(pre_trigger_decode);
+                };
+                camera = sepia::make_unique<
+                    sepia::psee413::buffered_camera<gen4::record_history<decode>, decltype(handle_exception)&>>(
+                    gen4::record_history<decode>(
+                        decode(std::move(handle_event), std::move(handle_trigger_event), before_buffer, after_buffer),
+                        pre_trigger),
+                    handle_exception,
+                    configuration.psee413_parameters,
+                    device.serial,
+                    std::chrono::milliseconds(100),
+                    64,
+                    configuration.fifo_size,
+                    handle_drop);
+            }
+
+            // metrics
+            std::unique_ptr<gen4::metrics_server> metrics_server;
+            if (configuration.metrics_port > 0) {
+                metrics_server = sepia::make_unique<gen4::metrics_server>(configuration.metrics_port, [&]() {
+                    std::vector<gen4::writer_sample> writers;
+                    writers.push_back({"recording", device.serial, filebuf.get_cumulative_statistics()});
+                    if (trigger_gate) {
+                        writers.push_back({"trigger", device.serial, trigger_gate->writer_statistics()});
+                    }
+                    return metrics.scrape(
+                        {{device.serial, camera->get_transfer_statistics(), &camera_metrics}}, writers);
+                });
+            }
+
+            // statistics
+            uint64_t previous_events = 0;
+            uint64_t previous_buffers = 0;
+            auto previous_clock = std::clock();
+            auto previous_time = std::chrono::steady_clock::now();
+            auto next_time = previous_time + stats_period;
+            while (!shared_commands->quit.load(std::memory_order_acquire) && !quit_required) {
+                if (signal_start_required) {
+                    signal_start_required = 0;
+                    shared_commands->start_required.store(true, std::memory_order_release);
+                }
+                if (signal_stop_required) {
+                    signal_stop_required = 0;
+                    shared_commands->stop_required.store(true, std::memory_order_release);
+                }
+                const auto now = std::chrono::steady_clock::now();
+                if (now < next_time) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    continue;
+                }
+                next_time += stats_period;
+                const auto clock = std::clock();
+                const auto on_events = shared_statistics.on_events.load(std::memory_order_relaxed);
+                const auto off_events = shared_statistics.off_events.load(std::memory_order_relaxed);
+                const auto buffers = shared_statistics.buffers.load(std::memory_order_relaxed);
+                const auto duration = std::chrono::duration<double>(now - previous_time).count();
+                const auto events = on_events + off_events - previous_events;
+                const auto cpu_duration = static_cast<double>(clock - previous_clock) / CLOCKS_PER_SEC;
+                const auto sink_statistics = filebuf.get_statistics();
+                std::stringstream message;
+                message << "{\"t\":\"" << gen4::utc_timestamp() << "\",\"event_rate\":"
+                        << std::llround(static_cast<double>(events) / duration)
+                        << ",\"buffer_rate\":"
+                        << std::llround(static_cast<double>(buffers - previous_buffers) / duration)
+                        << ",\"cpu_per_event\":"
+                        << (events == 0 ? 0.0 : cpu_duration * 1e9 / static_cast<double>(events))
+                        << ",\"fifo_used\":" << shared_statistics.fifo_used.load(std::memory_order_relaxed)
+                        << ",\"dropped_buffers\":" << shared_statistics.dropped_buffers.load(std::memory_order_relaxed)
+                        << ",\"recording\":"
+                        << (shared_statistics.recording.load(std::memory_order_acquire) ? "true" : "false")
+                        << ",\"recorded_duration\":"
+                        << shared_statistics.recorded_duration.load(std::memory_order_relaxed)
+                        << ",\"clips\":" << shared_statistics.clips.load(std::memory_order_relaxed)
+                        << ",\"bytes_written\":" << sink_statistics.bytes_written
+                        << ",\"writer_queue_depth\":" << sink_statistics.queue_depth
+                        << ",\"maximum_write_duration\":" << sink_statistics.maximum_write_duration.count() << "}\n";
+                std::cout << message.str();
+                std::cout.flush();
+                previous_events = on_events + off_events;
+                previous_buffers = buffers;
+                previous_clock = clock;
+                previous_time = now;
+            }
+            metrics_server.reset();
+            camera.reset();
+            if (write) {
+                write.reset();
+                filebuf.close();
+                gen4::control_log(
+                    control_events, gen4::utc_timestamp(), "stop_recording", std::string("\"") + filename + "\"");
+            }
+            if (camera_exception) {
+                std::rethrow_exception(camera_exception);
+            }
+        });
+}
@@ -1,14 +1,22 @@
 #include "assets.hpp"
+#include "async_filebuf.hpp"
 #include "chameleon/source/background_cleaner.hpp"
 #include "chameleon/source/count_display.hpp"
+#include "chameleon/source/dvs_array_display.hpp"
 #include "chameleon/source/dvs_display.hpp"
 #include "configuration.hpp"
+#include "count_accumulator.hpp"
+#include "metrics.hpp"
 #include "pontella.hpp"
+#include "pre_trigger.hpp"
+#include "trigger_gate.hpp"
+#include "utilities.hpp"
 #include <QQmlPropertyMap>
 #include <QtGui/QFontDatabase>
 #include <QtGui/QGuiApplication>
 #include <QtQml/QQmlApplicationEngine>
 #include <QtQml/QQmlContext>
+#include <cmath>
 #include <ctime>
 #include <filesystem>
 #include <iomanip>
@@ -17,45 +25,15 @@
 
 constexpr uint64_t event_rate_resolution = 50000; // µs
 constexpr uint64_t event_rate_chunks = 20;
+constexpr std::size_t recording_chunk_size = 1 << 20;
+constexpr std::size_t recording_chunks_count = 64;
 
-std::pair<std::string, std::string> utc_timestamp_and_filename() {
-    std::timespec timespec;
-    std::timespec_get(&timespec, TIME_UTC);
-    std::stringstream timestamp;
-    std::stringstream filename;
-    timestamp << std::put_time(std::gmtime(&timespec.tv_sec), "%FT%T.") << std::setfill('0') << std::setw(6)
-              << (timespec.tv_nsec / 1000) << "Z";
-    filename << std::put_time(std::gmtime(&timespec.tv_sec), "%FT%H-%M-%SZ");
-    return {timestamp.str(), filename.str()};
-}
-
-std::string utc_timestamp() {
-    std::timespec timespec;
-    std::timespec_get(&timespec, TIME_UTC);
-    std::stringstream timestamp;
-    timestamp << std::put_time(std::gmtime(&timespec.tv_sec), "%FT%T.") << std::setfill('0') << std::setw(6)
-              << (timespec.tv_nsec / 1000) << "Z";
-    return timestamp.str();
-}
-
-QString duration_and_size_to_string(uint64_t duration, uint64_t size) {
-    const auto seconds = static_cast<uint64_t>(std::round(static_cast<double>(duration) / 1e6));
+QString size_to_string(uint64_t size) {
     QString output;
     QTextStream stream(&output);
-    if (seconds < 300) {
-        stream << seconds << " s";
-    } else if (seconds < 18000) {
-        stream << (seconds / 60) << " min";
-    } else if (seconds < 432000) {
-        stream << (seconds / 3600) << " h";
-    } else {
-        stream << (seconds / 86400) << " days";
-    }
-    stream << " (";
     if (size < 1000) {
         stream << size << " B";
     } else {
-        QTextStream stream(&output);
         stream.setRealNumberNotation(QTextStream::FixedNotation);
         stream.setRealNumberPrecision(2);
         const auto real_size = static_cast<double>(size);
@@ -69,21 +47,114 @@ QString duration_and_size_to_string(uint64_t duration, uint64_t size) {
             stream << (real_size / 1e12) << " TB";
         }
     }
-    stream << ")";
     return output;
 }
 
-void control_log(
-    std::ofstream& control_events,
-    const std::string& timestamp,
-    const std::string& type,
-    const std::string& payload) {
-    std::stringstream message;
-    message << "{\"t\":\"" << timestamp << "\",\"type\":\"" << type << "\",\"payload\":" << payload << "}\n";
-    control_events << message.rdbuf();
-    control_events.flush();
+QString duration_and_size_to_string(uint64_t duration, uint64_t size) {
+    const auto seconds = static_cast<uint64_t>(std::round(static_cast<double>(duration) / 1e6));
+    QString output;
+    QTextStream stream(&output);
+    if (seconds < 300) {
+        stream << seconds << " s";
+    } else if (seconds < 18000) {
+        stream << (seconds / 60) << " min";
+    } else if (seconds < 432000) {
+        stream << (seconds / 3600) << " h";
+    } else {
+        stream << (seconds / 86400) << " days";
+    }
+    stream << " (" << size_to_string(size) << ")";
+    return output;
 }
 
+/// camera_state holds the acquisition, display, and recording state of one camera.
+/// Unless stated otherwise, members are only used by the camera's decoding thread.
+struct camera_state {
+    camera_state(
+        std::size_t camera_index,
+        const sepia::usb::device_properties& camera_device,
+        const gen4::configuration& configuration) :
+        index(camera_index),
+        device(camera_device),
+        control_events(
+            sepia::join({configuration.recordings, camera_device.serial + "_control_events.jsonl"}),
+            std::ostream::app),
+        filebuf(recording_chunk_size, recording_chunks_count),
+        file_stream(&filebuf),
+        initial_t(0),
+        previous_t(0),
+        initial_t_set(false),
+        flip_left_right(false),
+        flip_bottom_top(false),
+        chunk_to_counts(event_rate_chunks + 1, {0ull, 0ull}),
+        previous_active_chunk_index(0),
+        active_chunk_index(0),
+        active_chunk_threshold_t(0),
+        display_policy(configuration.drop_threshold, configuration.display_decimation),
+        pre_trigger(
+            configuration.pre_trigger_duration > 0 ? configuration.pre_trigger_bytes : 0,
+            configuration.pre_trigger_duration),
+        decoded_events(0),
+        bias_update_required(false),
+        recording_start_required(false),
+        recording_stop_required(false),
+        event_count_on(0),
+        event_count_off(0),
+        recording_duration(0),
+        recording_size(0),
+        recording_clips(0),
+        display_degradation_level(0) {
+        if (configuration.trigger.enabled) {
+            trigger_gate = sepia::make_unique<gen4::trigger_gate>(
+                configuration.trigger, sepia::evk4::width, sepia::evk4::height, control_events);
+        }
+    }
+    camera_state(const camera_state&) = delete;
+    camera_state(camera_state&&) = delete;
+    camera_state& operator=(const camera_state&) = delete;
+    camera_state& operator=(camera_state&&) = delete;
+    ~camera_state() {}
+
+    const std::size_t index;
+    const sepia::usb::device_properties device;
+    std::ofstream control_events;
+    std::string filename;
+    std::string filename_timestamp;
+    gen4::async_filebuf filebuf;
+    std::ostream file_stream;
+    std::unique_ptr<sepia::write_to_reference<sepia::type::dvs>> write;
+    uint64_t initial_t;
+    uint64_t previous_t;
+    bool initial_t_set;
+    bool flip_left_right;
+    bool flip_bottom_top;
+    std::vector<std::pair<uint64_t, uint64_t>> chunk_to_counts;
+    std::size_t previous_active_chunk_index;
+    std::size_t active_chunk_index;
+    uint64_t active_chunk_threshold_t;
+    gen4::display_policy display_policy;
+    gen4::pre_trigger_ring pre_trigger;
+    std::function<void()> replay_pre_trigger;
+    std::unique_ptr<gen4::trigger_gate> trigger_gate;
+    uint64_t decoded_events;
+    std::chrono::steady_clock::time_point buffer_begin;
+    gen4::camera_metrics metrics;
+    std::unique_ptr<sepia::camera> camera;
+
+    // requests from the user interface, protected by accessing_shared
+    bool bias_update_required;
+    bool recording_start_required;
+    bool recording_stop_required;
+
+    // status read by the first camera's thread to update the user interface
+    std::atomic<uint64_t> event_count_on;
+    std::atomic<uint64_t> event_count_off;
+    std::atomic<uint64_t> recording_duration;
+    std::atomic<uint64_t> recording_size;
+    std::atomic<uint64_t> recording_clips;
+    std::atomic<uint32_t> display_degradation_level;
+};
+
 #if defined(_WIN32)
 int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine, int nCmdShow) {
     int argc = 0;
@@ -92,7 +163,7 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLin
 int main(int argc, char* argv[]) {
 #endif
     return pontella::main(
-        {"gen4_recorder displays and records events from a Gen4 camera"
+        {"gen4_recorder displays and records events from one or several Gen4 cameras"
          "Syntax: gen4_recorder [options]",
          "Available options:",
          "    -c [path], --configuration [path]    sets the JSON configuration path",
@@ -120,36 +191,58 @@ int main(int argc, char* argv[]) {
 
             QQmlPropertyMap parameters;
 
-            // serial
-            sepia::usb::device_properties device{
-                0,
-                "",
-                sepia::usb::device_speed::unknown,
-            };
-            if (configuration.serial.has_value()) {
-                device.serial = configuration.serial.value();
-            }
+            // serials
+            std::vector<sepia::usb::device_properties> devices;
             {
-                auto found = false;
-                for (const auto& available_device : sepia::psee::available_devices()) {
-                    if (device.serial.empty() || available_device.serial == device.serial) {
-                        if (available_device.type == sepia::psee::EVK3_HD
-                            || available_device.type == sepia::psee::EVK4) {
-                            device = available_device;
-                            found = true;
-                            break;
+                const auto available_devices = sepia::psee::available_devices();
+                auto find_device = [&](const std::string& serial) {
+                    for (const auto& available_device : available_devices) {
+                        if (serial.empty() || available_device.serial == serial) {
+                            if (available_device.type == sepia::psee::EVK3_HD
+                                || available_device.type == sepia::psee::EVK4) {
+                                devices.push_back(available_device);
+                                return;
+                            }
                         }
                     }
-                }
-                if (!found) {
-                    if (device.serial.empty()) {
-                        throw sepia::usb::serial_not_available(sepia::evk4::name, device.serial);
+                    if (!serial.empty()) {
+                        throw sepia::usb::serial_not_available(sepia::evk4::name, serial);
                     }
                     throw sepia::no_device_connected(std::string(sepia::evk4::name) + " or " + sepia::psee413::name);
+                };
+                if (configuration.serials.empty()) {
+                    find_device(configuration.serial.has_value() ? configuration.serial.value() : std::string());
+                } else {
+                    if (configuration.serials.size() > chameleon::dvs_array_display_renderer::maximum_cameras) {
+                        throw std::runtime_error("too many serials (the display supports up to 16 cameras)");
+                    }
+                    for (const auto& serial : configuration.serials) {
+                        find_device(serial);
+                    }
+                }
+                for (const auto& device : devices) {
+                    if (device.type != devices.front().type) {
+                        throw std::runtime_error("all the cameras must have the same type");
+                    }
+                }
+            }
+            const auto device_type = devices.front().type;
+            {
+                QString serials;
+                auto speed = sepia::usb::device_speed_to_string(devices.front().speed);
+                for (const auto& device : devices) {
+                    if (!serials.isEmpty()) {
+                        serials += ", ";
+                    }
+                    serials += QString::fromStdString(device.serial);
+                    const auto device_speed = sepia::usb::device_speed_to_string(device.speed);
+                    if (device_speed.rfind("USB 3", 0) != 0) {
+                        speed = device_speed;
+                    }
                 }
+                parameters.insert("serial", serials);
+                parameters.insert("speed", QString::fromStdString(speed));
             }
-            parameters.insert("serial", QString::fromStdString(device.serial));
-            parameters.insert("speed", QString::fromStdString(sepia::usb::device_speed_to_string(device.speed)));
 
             // event rate, recording status, and file size
             parameters.insert("event_rate", QString("0 ev/s"));
@@ -160,17 +253,20 @@ int main(int argc, char* argv[]) {
             parameters.insert(
                 "recordings_directory",
                 configuration.recordings.empty() ? QString("./") : QString::fromStdString(configuration.recordings));
-            std::ofstream control_events(
-                sepia::join({configuration.recordings, device.serial + "_control_events.jsonl"}), std::ostream::app);
+            std::vector<std::unique_ptr<camera_state>> cameras;
+            for (std::size_t index = 0; index < devices.size(); ++index) {
+                cameras.push_back(sepia::make_unique<camera_state>(index, devices[index], configuration));
+            }
             parameters.insert("recording_name", QVariant());
             parameters.insert("recording_status", QVariant());
+            parameters.insert("display_degradation", QString());
 
             // camera parameters
-            const auto biases_names = device.type == sepia::psee::EVK4 ? sepia::evk4::bias_currents::names() :
+            const auto biases_names = device_type == sepia::psee::EVK4 ? sepia::evk4::bias_currents::names() :
                                                                          sepia::psee413::bias_currents::names();
             std::unordered_set<std::string> biases_names_set(biases_names.begin(), biases_names.end());
             {
-                const auto initialisation_timestamp = utc_timestamp();
+                const auto initialisation_timestamp = gen4::utc_timestamp();
                 QList<QString> qt_biases_names;
                 std::transform(
                     biases_names.begin(),
@@ -179,24 +275,29 @@ int main(int argc, char* argv[]) {
                     [](const std::string& name) { return QString::fromStdString(name); });
                 parameters.insert("biases_names", QVariant(qt_biases_names));
                 for (const auto& name : biases_names) {
-                    const auto value = device.type == sepia::psee::EVK4 ?
+                    const auto value = device_type == sepia::psee::EVK4 ?
                                            configuration.evk4_parameters.biases.by_name(name) :
                                            configuration.psee413_parameters.biases.by_name(name);
                     parameters.insert(QString::fromStdString(name), value);
-                    control_log(
-                        control_events, initialisation_timestamp, name, std::to_string(static_cast<int32_t>(value)));
+                    for (auto& state : cameras) {
+                        gen4::control_log(
+                            state->control_events,
+                            initialisation_timestamp,
+                            name,
+                            std::to_string(static_cast<int32_t>(value)));
+                    }
                 }
             }
 
             // user interface events
+            // recordings of all the cameras share the timestamp and stem generated when the user presses start
             std::atomic_flag accessing_shared;
-            auto bias_update_required = false;
-            auto recording_start_required = false;
-            auto recording_stop_required = false;
             auto shared_flip_left_right = false;
             auto shared_flip_bottom_top = false;
             auto shared_use_count_display = false;
             uint64_t shared_tau = 100000;
+            std::string shared_recording_timestamp;
+            std::string shared_recording_stem;
             parameters.insert("use_count_display", false);
             accessing_shared.clear(std::memory_order_release);
             QQmlPropertyMap::connect(
@@ -207,9 +308,15 @@ int main(int argc, char* argv[]) {
                     while (accessing_shared.test_and_set(std::memory_order_acquire)) {
                     }
                     if (name == "recording_start_required") {
-                        recording_start_required = true;
+                        std::tie(shared_recording_timestamp, shared_recording_stem) =
+                            gen4::utc_timestamp_and_filename();
+                        for (auto& state : cameras) {
+                            state->recording_start_required = true;
+                        }
                     } else if (name == "recording_stop_required") {
-                        recording_stop_required = true;
+                        for (auto& state : cameras) {
+                            state->recording_stop_required = true;
+                        }
                     } else if (name == "Flip left-right") {
                         shared_flip_left_right = value.toBool();
                     } else if (name == "Flip bottom-top") {
@@ -224,19 +331,22 @@ int main(int argc, char* argv[]) {
                             std::cerr << (std::string("unknown parameter \"") + name_string + "\"\n");
                             std::cerr.flush();
                         } else {
-                            if (device.type == sepia::psee::EVK4) {
+                            if (device_type == sepia::psee::EVK4) {
                                 configuration.evk4_parameters.biases.by_name(name_string) =
                                     static_cast<uint8_t>(value.toUInt());
                             } else {
                                 configuration.psee413_parameters.biases.by_name(name_string) =
                                     static_cast<uint8_t>(value.toUInt());
                             }
-                            bias_update_required = true;
-                            control_log(
-                                control_events,
-                                utc_timestamp(),
-                                name_string,
-                                std::to_string(static_cast<int32_t>(static_cast<uint8_t>(value.toUInt()))));
+                            const auto timestamp = gen4::utc_timestamp();
+                            for (auto& state : cameras) {
+                                state->bias_update_required = true;
+                                gen4::control_log(
+                                    state->control_events,
+                                    timestamp,
+                                    name_string,
+                                    std::to_string(static_cast<int32_t>(static_cast<uint8_t>(value.toUInt()))));
+                            }
                         }
                     }
                     accessing_shared.clear(std::memory_order_release);
@@ -246,6 +356,7 @@ int main(int argc, char* argv[]) {
             QGuiApplication app(argc, argv);
             qmlRegisterType<chameleon::background_cleaner>("Chameleon", 1, 0, "BackgroundCleaner");
             qmlRegisterType<chameleon::dvs_display>("Chameleon", 1, 0, "DvsDisplay");
+            qmlRegisterType<chameleon::dvs_array_display>("Chameleon", 1, 0, "DvsArrayDisplay");
             qmlRegisterType<chameleon::count_display>("Chameleon", 1, 0, "CountDisplay");
             QQmlApplicationEngine application_engine;
             QFontDatabase::addApplicationFontFromData(assets::opensans_regular);
@@ -257,13 +368,21 @@ int main(int argc, char* argv[]) {
             auto title_font = font_database.font("Open Sans", "SemiBold", 14);
             auto monospace_font = font_database.font("Roboto Mono", "Regular", 14);
             auto icons_font = font_database.font("Material Icons", "Regular", 16);
+            const auto camera_columns =
+                static_cast<int>(std::ceil(std::sqrt(static_cast<double>(cameras.size()))));
+            const auto camera_rows = (static_cast<int>(cameras.size()) + camera_columns - 1) / camera_columns;
             application_engine.rootContext()->setContextProperty("base_font", base_font);
             application_engine.rootContext()->setContextProperty("title_font", title_font);
             application_engine.rootContext()->setContextProperty("monospace_font", monospace_font);
             application_engine.rootContext()->setContextProperty("icons_font", icons_font);
             application_engine.rootContext()->setContextProperty("header_width", sepia::evk4::width);
             application_engine.rootContext()->setContextProperty("header_height", sepia::evk4::height);
+            application_engine.rootContext()->setContextProperty("camera_count", static_cast<int>(cameras.size()));
+            application_engine.rootContext()->setContextProperty("camera_columns", camera_columns);
+            application_engine.rootContext()->setContextProperty("camera_rows", camera_rows);
             application_engine.rootContext()->setContextProperty("parameters", &parameters);
+            application_engine.rootContext()->setContextProperty(
+                "display_gpu_scatter", configuration.display_gpu_scatter);
             application_engine.loadData(
 #include "gen4_recorder.qml.hpp"
             );
@@ -276,239 +395,449 @@ int main(int argc, char* argv[]) {
                 format.setProfile(QSurfaceFormat::CoreProfile);
                 window->setFormat(format);
             }
-            auto dvs_display = window->findChild<chameleon::dvs_display*>("dvs_display");
+            gen4::pipeline_metrics metrics;
+            std::chrono::steady_clock::time_point render_begin;
+            std::chrono::steady_clock::time_point previous_frame;
+            if (configuration.metrics_port > 0) {
+                QObject::connect(
+                    window,
+                    &QQuickWindow::beforeRendering,
+                    window,
+                    [&]() { render_begin = std::chrono::steady_clock::now(); },
+                    Qt::DirectConnection);
+                QObject::connect(
+                    window,
+                    &QQuickWindow::afterRendering,
+                    window,
+                    [&]() {
+                        metrics.render_duration.set(static_cast<uint64_t>(
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - render_begin)
+                                .count()));
+                    },
+                    Qt::DirectConnection);
+                QObject::connect(
+                    window,
+                    &QQuickWindow::frameSwapped,
+                    window,
+                    [&]() {
+                        const auto now = std::chrono::steady_clock::now();
+                        if (metrics.frames.load() > 0) {
+                            metrics.frame_duration.set(static_cast<uint64_t>(
+                                std::chrono::duration_cast<std::chrono::nanoseconds>(now - previous_frame).count()));
+                        }
+                        previous_frame = now;
+                        metrics.frames.add(1);
+                    },
+                    Qt::DirectConnection);
+            }
+
+            // a single camera uses dvs_display, several cameras share a dvs_array_display (one texture layer each)
+            auto dvs_display =
+                cameras.size() == 1 ? window->findChild<chameleon::dvs_display*>("dvs_display") : nullptr;
+            auto dvs_array_display =
+                cameras.size() == 1 ? nullptr : window->findChild<chameleon::dvs_array_display*>("dvs_array_display");
             auto count_display = window->findChild<chameleon::count_display*>("count_display");
 
             const auto event_rate_factor = 1e6 / static_cast<double>(event_rate_resolution * event_rate_chunks);
-
-            std::string filename;
-            std::string filename_timestamp;
-            std::unique_ptr<sepia::write<sepia::type::dvs>> write;
-            uint64_t initial_t = 0;
-            uint64_t previous_t = 0;
-            auto initial_t_set = false;
-            auto flip_left_right = false;
-            auto flip_bottom_top = false;
-            std::unique_ptr<sepia::camera> camera;
-            std::vector<std::pair<uint64_t, uint64_t>> chunk_to_counts(event_rate_chunks + 1, {0ull, 0ull});
-            std::size_t previous_active_chunk_index = 0;
-            std::size_t active_chunk_index = 0;
-            uint64_t active_chunk_threshold_t = 0;
             const auto locale = QLocale(QLocale::English, QLocale::Country::Australia);
-            std::size_t counts_circular_buffer_index = 0;
+
+            // the count display shows the first camera, its state is only used by the first camera's thread
             auto swapped_counts = false;
             uint64_t count_t = 0;
             auto use_count_display = false;
             uint64_t tau = 0;
-            std::array<std::vector<uint32_t>, 2> counts_circular_buffer;
-            for (auto& counts : counts_circular_buffer) {
-                counts.resize(sepia::evk4::width * sepia::evk4::height);
-                std::fill(counts.begin(), counts.end(), std::numeric_limits<uint32_t>::max());
-            }
-            auto handle_event = [&](sepia::dvs_event event) {
-                while (event.t > active_chunk_threshold_t) {
-                    active_chunk_index = (active_chunk_index + 1) % chunk_to_counts.size();
-                    chunk_to_counts[active_chunk_index].first = 0;
-                    chunk_to_counts[active_chunk_index].second = 0;
-                    active_chunk_threshold_t += event_rate_resolution;
-                }
-                if (event.on) {
-                    ++chunk_to_counts[active_chunk_index].first;
-                } else {
-                    ++chunk_to_counts[active_chunk_index].second;
-                }
-                auto display_event = event;
-                if (flip_left_right) {
-                    display_event.x = sepia::evk4::width - 1 - display_event.x;
-                }
-                if (flip_bottom_top) {
-                    display_event.y = sepia::evk4::height - 1 - display_event.y;
+            gen4::count_accumulator counts(sepia::evk4::width, sepia::evk4::height, 1);
+            std::vector<gen4::pixel_count> counts_updates;
+            counts_updates.reserve(2 * sepia::evk4::width * sepia::evk4::height);
+            const std::vector<uint32_t> initial_counts(sepia::evk4::width * sepia::evk4::height, 1);
+            uint32_t display_degradation_level = 0;
+
+            // update_user_interface publishes the status of all the cameras, it is called by the first camera
+            auto update_user_interface = [&]() {
+                uint64_t event_count_on = 0;
+                uint64_t event_count_off = 0;
+                uint64_t recording_size = 0;
+                uint32_t level = 0;
+                for (const auto& state : cameras) {
+                    event_count_on += state->event_count_on.load(std::memory_order_relaxed);
+                    event_count_off += state->event_count_off.load(std::memory_order_relaxed);
+                    recording_size += state->recording_size.load(std::memory_order_relaxed);
+                    level = std::max(level, state->display_degradation_level.load(std::memory_order_relaxed));
                 }
-                dvs_display->push_unsafe(display_event);
-                if (use_count_display) {
-                    if (display_event.t > count_t + tau) {
-                        counts_circular_buffer_index =
-                            (counts_circular_buffer_index + 1) % counts_circular_buffer.size();
-                        swapped_counts = true;
-                        count_t = display_event.t;
-                        std::fill(
-                            counts_circular_buffer[counts_circular_buffer_index].begin(),
-                            counts_circular_buffer[counts_circular_buffer_index].end(),
-                            1);
+                parameters.insert(
+                    "event_rate",
+                    locale.toString(static_cast<double>(event_count_on + event_count_off) * event_rate_factor, 'f', 0)
+                        + " ev/s");
+                parameters.insert(
+                    "event_rate_on",
+                    QString("ON  ") + locale.toString(static_cast<double>(event_count_on) * event_rate_factor, 'f', 0)
+                        + " ev/s");
+                parameters.insert(
+                    "event_rate_off",
+                    QString("OFF ")
+                        + locale.toString(static_cast<double>(event_count_off) * event_rate_factor, 'f', 0) + " ev/s");
+                const auto& first = *cameras.front();
+                if (first.trigger_gate && first.trigger_gate->armed()) {
+                    uint64_t clips = 0;
+                    for (const auto& state : cameras) {
+                        clips += state->recording_clips.load(std::memory_order_relaxed);
                     }
-                    ++counts_circular_buffer[counts_circular_buffer_index]
-                                            [display_event.x + display_event.y * sepia::evk4::width];
+                    parameters.insert(
+                        "recording_status",
+                        QString("%1 clip%2 (%3)")
+                            .arg(clips)
+                            .arg(clips == 1 ? "" : "s")
+                            .arg(size_to_string(recording_size)));
+                } else if (first.write) {
+                    parameters.insert(
+                        "recording_status",
+                        duration_and_size_to_string(
+                            first.recording_duration.load(std::memory_order_relaxed), recording_size));
                 }
-                previous_t = event.t;
-                if (write) {
-                    if (!initial_t_set) {
-                        initial_t_set = true;
-                        initial_t = event.t;
-                        std::stringstream message;
-                        message << "{\"t\":\"" << utc_timestamp()
-                                << "\",\"type\":\"start_recording\",\"payload\":{\"filename\":\"" << filename
-                                << "\",\"initial_t\":" << initial_t << ",\"filename_timestamp\":\""
-                                << filename_timestamp << "\"}}\n";
-                        control_events << message.rdbuf();
-                        control_events.flush();
+                if (level != display_degradation_level) {
+                    display_degradation_level = level;
+                    if (display_degradation_level == 0) {
+                        parameters.insert("display_degradation", QString());
+                    } else {
+                        parameters.insert(
+                            "display_degradation",
+                            QString("Display decimated, 1 %1 out of %2")
+                                .arg(first.display_policy.mode() == gen4::decimation::buffers ? "buffer" : "row")
+                                .arg(1u << display_degradation_level));
                     }
-                    event.t -= initial_t;
-                    write->operator()(event);
                 }
             };
-            auto drop_threshold = 0;
-            auto before_buffer = [&](std::size_t fifo_used, std::size_t fifo_size) {
-                dvs_display->lock();
-                return drop_threshold == 0 || fifo_used < drop_threshold;
-            };
-            auto after_buffer = [&]() {
-                dvs_display->unlock();
-                while (accessing_shared.test_and_set(std::memory_order_acquire)) {
+            auto handle_exception = [&](std::exception_ptr exception) {
+                try {
+                    std::rethrow_exception(exception);
+                } catch (const std::exception& exception) {
+                    std::cerr << exception.what() << std::endl;
                 }
-                if (bias_update_required) {
-                    bias_update_required = false;
-                    if (device.type == sepia::psee::EVK4) {
-                        dynamic_cast<sepia::evk4::base_camera*>(camera.get())
-                            ->update_parameters(configuration.evk4_parameters);
+                app.quit();
+            };
+            auto handle_drop = []() {
+                std::cerr << "Warning: packet dropped\n";
+                std::cerr.flush();
+            };
+            for (auto& camera_state_pointer : cameras) {
+                auto state = camera_state_pointer.get();
+                const auto suffix = cameras.size() == 1 ? std::string() : std::string("_") + state->device.serial;
+                auto record = [state](sepia::dvs_event event) {
+                    if (!state->initial_t_set) {
+                        state->initial_t_set = true;
+                        state->initial_t = event.t;
+                        std::stringstream message;
+                        message << "{\"t\":\"" << gen4::utc_timestamp()
+                                << "\",\"type\":\"start_recording\",\"payload\":{\"filename\":\"" << state->filename
+                                << "\",\"initial_t\":" << state->initial_t << ",\"filename_timestamp\":\""
+                                << state->filename_timestamp << "\"}}\n";
+                        state->control_events << message.rdbuf();
+                        state->control_events.flush();
+                    }
+                    event.t -= state->initial_t;
+                    state->write->operator()(event);
+                };
+                auto handle_event = [&, state, record](sepia::dvs_event event) {
+                    ++state->decoded_events;
+                    while (event.t > state->active_chunk_threshold_t) {
+                        state->active_chunk_index = (state->active_chunk_index + 1) % state->chunk_to_counts.size();
+                        state->chunk_to_counts[state->active_chunk_index].first = 0;
+                        state->chunk_to_counts[state->active_chunk_index].second = 0;
+                        state->active_chunk_threshold_t += event_rate_resolution;
+                    }
+                    if (event.on) {
+                        ++state->chunk_to_counts[state->active_chunk_index].first;
                     } else {
-                        dynamic_cast<sepia::psee413::base_camera*>(camera.get())
-                            ->update_parameters(configuration.psee413_parameters);
+                        ++state->chunk_to_counts[state->active_chunk_index].second;
                     }
-                }
-                flip_left_right = shared_flip_left_right;
-                flip_bottom_top = shared_flip_bottom_top;
-                if (previous_active_chunk_index != active_chunk_index) {
-                    previous_active_chunk_index = active_chunk_index;
-                    uint64_t event_count_on = 0;
-                    uint64_t event_count_off = 0;
-                    for (std::size_t index = active_chunk_index + 1;
-                         index < active_chunk_index + chunk_to_counts.size();
-                         ++index) {
-                        event_count_on += chunk_to_counts[index % chunk_to_counts.size()].first;
-                        event_count_off += chunk_to_counts[index % chunk_to_counts.size()].second;
+                    auto display_event = event;
+                    if (state->flip_left_right) {
+                        display_event.x = sepia::evk4::width - 1 - display_event.x;
                     }
-                    parameters.insert(
-                        "event_rate",
-                        locale.toString(
-                            static_cast<double>(event_count_on + event_count_off) * event_rate_factor, 'f', 0)
-                            + " ev/s");
-                    parameters.insert(
-                        "event_rate_on",
-                        QString("ON  ")
-                            + locale.toString(static_cast<double>(event_count_on) * event_rate_factor, 'f', 0)
-                            + " ev/s");
-                    parameters.insert(
-                        "event_rate_off",
-                        QString("OFF ")
-                            + locale.toString(static_cast<double>(event_count_off) * event_rate_factor, 'f', 0)
-                            + " ev/s");
-                    if (write) {
-                        if (recording_stop_required) {
-                            recording_stop_required = false;
-                            write.reset();
-                            drop_threshold = configuration.drop_threshold;
-                            parameters.insert("recording_name", QVariant());
-                            parameters.insert("recording_status", QVariant());
-                            control_log(
-                                control_events, utc_timestamp(), "stop_recording", std::string("\"") + filename + "\"");
-                            filename.clear();
+                    if (state->flip_bottom_top) {
+                        display_event.y = sepia::evk4::height - 1 - display_event.y;
+                    }
+                    if (state->display_policy.display(display_event)) {
+                        if (dvs_display) {
+                            dvs_display->push_unsafe(display_event);
                         } else {
-                            parameters.insert(
-                                "recording_status",
-                                duration_and_size_to_string(
-                                    previous_t - initial_t,
-                                    static_cast<uint64_t>(std::filesystem::file_size(filename))));
+                            dvs_array_display->push_unsafe(state->index, display_event);
+                        }
+                        if (state->index == 0 && use_count_display) {
+                            if (display_event.t > count_t + tau) {
+                                counts.swap();
+                                swapped_counts = true;
+                                count_t = display_event.t;
+                            }
+                            counts.push(display_event.x, display_event.y);
                         }
-                    } else if (recording_start_required) {
-                        recording_start_required = false;
-                        const auto [timestamp, stem] = utc_timestamp_and_filename();
-                        filename = sepia::join({configuration.recordings, stem + ".es"});
-                        filename_timestamp = timestamp;
-                        initial_t_set = false;
-                        initial_t = previous_t;
-                        write = std::make_unique<sepia::write<sepia::type::dvs>>(
-                            sepia::filename_to_ofstream(filename), sepia::evk4::width, sepia::evk4::height);
-                        drop_threshold = 0;
-                        parameters.insert("recording_status", "0 s (0 B)");
-                        parameters.insert("recording_name", QString::fromStdString(filename));
                     }
-                }
-                if (shared_use_count_display != use_count_display) {
-                    if (!use_count_display) {
-                        use_count_display = true;
-                        count_t = previous_t;
+                    state->previous_t = event.t;
+                    if (state->write) {
+                        record(event);
+                    } else if (state->trigger_gate) {
+                        state->trigger_gate->push(event);
+                    }
+                };
+                auto before_buffer = [&, state](std::size_t fifo_used, std::size_t) {
+                    if (dvs_display) {
+                        dvs_display->lock();
                     } else {
-                        use_count_display = false;
+                        dvs_array_display->lock(state->index);
                     }
-                }
-                tau = shared_tau;
-                if (swapped_counts) {
-                    const auto index = (counts_circular_buffer_index + counts_circular_buffer.size() - 1)
-                                       % counts_circular_buffer.size();
-                    count_display->assign(counts_circular_buffer[index].begin(), counts_circular_buffer[index].end());
-                    swapped_counts = false;
-                }
-                accessing_shared.clear(std::memory_order_release);
-            };
-            auto handle_trigger_event = [&](sepia::evk4::trigger_event event) {
-                std::stringstream message;
-                message << "{\"t\":\"" << utc_timestamp()
-                        << "\",\"type\":\"trigger_event\",\"payload\":{\"t\":" << event.t
-                        << ",\"system_timestamp\":" << event.system_timestamp
-                        << ",\"id\":" << static_cast<int32_t>(event.id)
-                        << ",\"rising\":" << (event.rising ? "true" : "false") << "}}\n";
-                control_events << message.rdbuf();
-                control_events.flush();
-            };
-            if (device.type == sepia::psee::EVK4) {
-                camera = sepia::evk4::make_camera(
-                    std::move(handle_event),
-                    std::move(handle_trigger_event),
-                    before_buffer,
-                    after_buffer,
-                    [&](std::exception_ptr exception) {
-                        try {
-                            std::rethrow_exception(exception);
-                        } catch (const std::exception& exception) {
-                            std::cerr << exception.what() << std::endl;
+                    state->buffer_begin = std::chrono::steady_clock::now();
+                    return state->display_policy.update(fifo_used) || static_cast<bool>(state->write)
+                           || (state->trigger_gate && state->trigger_gate->armed());
+                };
+                auto after_buffer = [&, state, suffix]() {
+                    const auto buffer_end = std::chrono::steady_clock::now();
+                    state->metrics.decode_duration.add(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(buffer_end - state->buffer_begin)
+                            .count()));
+                    state->metrics.decoded_buffers.add(1);
+                    state->metrics.events.add(state->decoded_events);
+                    state->decoded_events = 0;
+                    if (dvs_display) {
+                        dvs_display->unlock();
+                    } else {
+                        dvs_array_display->unlock(state->index);
+                    }
+                    while (accessing_shared.test_and_set(std::memory_order_acquire)) {
+                    }
+                    if (state->bias_update_required) {
+                        state->bias_update_required = false;
+                        if (device_type == sepia::psee::EVK4) {
+                            dynamic_cast<sepia::evk4::base_camera*>(state->camera.get())
+                                ->update_parameters(configuration.evk4_parameters);
+                        } else {
+                            dynamic_cast<sepia::psee413::base_camera*>(state->camera.get())
+                                ->update_parameters(configuration.psee413_parameters);
                         }
-                        app.quit();
-                    },
-                    configuration.evk4_parameters,
-                    device.serial,
-                    std::chrono::milliseconds(100),
-                    64,
-                    configuration.fifo_size,
-                    []() {
-                        std::cerr << "Warning: packet dropped\n";
-                        std::cerr.flush();
-                    });
-            } else {
-                camera = sepia::psee413::make_camera(
-                    std::move(handle_event),
-                    std::move(handle_trigger_event),
-                    before_buffer,
-                    after_buffer,
-                    [&](std::exception_ptr exception) {
-                        try {
-                            std::rethrow_exception(exception);
-                        } catch (const std::exception& exception) {
-                            std::cerr << exception.what() << std::endl;
+                    }
+                    state->flip_left_right = shared_flip_left_right;
+                    state->flip_bottom_top = shared_flip_bottom_top;
+                    if (state->previous_active_chunk_index != state->active_chunk_index) {
+                        state->previous_active_chunk_index = state->active_chunk_index;
+                        uint64_t event_count_on = 0;
+                        uint64_t event_count_off = 0;
+                        for (std::size_t index = state->active_chunk_index + 1;
+                             index < state->active_chunk_index + state->chunk_to_counts.size();
+                             ++index) {
+                            event_count_on += state->chunk_to_counts[index % state->chunk_to_counts.size()].first;
+                            event_count_off += state->chunk_to_counts[index % state->chunk_to_counts.size()].second;
                         }
-                        app.quit();
-                    },
-                    configuration.psee413_parameters,
-                    device.serial,
-                    std::chrono::milliseconds(100),
-                    64,
-                    configuration.fifo_size,
-                    []() {
-                        std::cerr << "Warning: packet dropped\n";
-                        std::cerr.flush();
-                    });
+                        state->event_count_on.store(event_count_on, std::memory_order_relaxed);
+                        state->event_count_off.store(event_count_off, std::memory_order_relaxed);
+                        if (state->trigger_gate && state->trigger_gate->armed()) {
+                            if (state->recording_stop_required) {
+                                state->recording_stop_required = false;
+                                state->trigger_gate->disarm();
+                                if (state->index == 0) {
+                                    parameters.insert("recording_name", QVariant());
+                                    parameters.insert("recording_status", QVariant());
+                                }
+                            } else {
+                                state->recording_size.store(state->trigger_gate->bytes(), std::memory_order_relaxed);
+                                state->recording_clips.store(state->trigger_gate->clips(), std::memory_order_relaxed);
+                            }
+                        } else if (state->write) {
+                            if (state->recording_stop_required) {
+                                state->recording_stop_required = false;
+                                state->write.reset();
+                                state->filebuf.close();
+                                if (state->index == 0) {
+                                    parameters.insert("recording_name", QVariant());
+                                    parameters.insert("recording_status", QVariant());
+                                }
+                                gen4::control_log(
+                                    state->control_events,
+                                    gen4::utc_timestamp(),
+                                    "stop_recording",
+                                    std::string("\"") + state->filename + "\"");
+                                state->filename.clear();
+                            } else {
+                                state->recording_duration.store(
+                                    state->previous_t - state->initial_t, std::memory_order_relaxed);
+                                state->recording_size.store(
+                                    static_cast<uint64_t>(std::filesystem::file_size(state->filename)),
+                                    std::memory_order_relaxed);
+                            }
+                        } else if (state->recording_start_required && state->trigger_gate) {
+                            state->recording_start_required = false;
+                            state->recording_size.store(0, std::memory_order_relaxed);
+                            state->recording_clips.store(0, std::memory_order_relaxed);
+                            state->trigger_gate->arm(configuration.recordings, shared_recording_stem + suffix);
+                            if (state->index == 0) {
+                                parameters.insert("recording_status", "armed");
+                                parameters.insert(
+                                    "recording_name",
+                                    QString::fromStdString(sepia::join(
+                                        {configuration.recordings,
+                                         shared_recording_stem + (suffix.empty() ? "" : "_*") + "_trigger_*.es"})));
+                            }
+                        } else if (state->recording_start_required) {
+                            state->recording_start_required = false;
+                            state->filename =
+                                sepia::join({configuration.recordings, shared_recording_stem + suffix + ".es"});
+                            state->filename_timestamp = shared_recording_timestamp;
+                            state->initial_t_set = false;
+                            state->initial_t = state->previous_t;
+                            state->recording_duration.store(0, std::memory_order_relaxed);
+                            state->recording_size.store(0, std::memory_order_relaxed);
+                            state->filebuf.open(state->filename);
+                            state->write = std::make_unique<sepia::write_to_reference<sepia::type::dvs>>(
+                                state->file_stream, sepia::evk4::width, sepia::evk4::height);
+                            state->replay_pre_trigger();
+                            if (state->index == 0) {
+                                parameters.insert("recording_status", "0 s (0 B)");
+                                parameters.insert(
+                                    "recording_name",
+                                    QString::fromStdString(
+                                        suffix.empty() ? state->filename :
+                                                         sepia::join(
+                                                             {configuration.recordings,
+                                                              shared_recording_stem + "_*.es"})));
+                            }
+                        }
+                        if (state->index == 0) {
+                            update_user_interface();
+                        }
+                    }
+                    if (state->index == 0) {
+                        if (shared_use_count_display != use_count_display) {
+                            if (!use_count_display) {
+                                use_count_display = true;
+                                count_t = state->previous_t;
+                                counts.reset();
+                                count_display->assign(initial_counts.begin(), initial_counts.end());
+                            } else {
+                                use_count_display = false;
+                            }
+                        }
+                        tau = shared_tau;
+                        if (swapped_counts) {
+                            counts.snapshot(counts_updates);
+                            count_display->push_range(counts_updates.begin(), counts_updates.end());
+                            swapped_counts = false;
+                        }
+                    }
+                    state->display_degradation_level.store(state->display_policy.level(), std::memory_order_relaxed);
+                    accessing_shared.clear(std::memory_order_release);
+                };
+                auto handle_trigger_event = [state](sepia::evk4::trigger_event event) {
+                    std::stringstream message;
+                    message << "{\"t\":\"" << gen4::utc_timestamp()
+                            << "\",\"type\":\"trigger_event\",\"payload\":{\"t\":" << event.t
+                            << ",\"system_timestamp\":" << event.system_timestamp
+                            << ",\"id\":" << static_cast<int32_t>(event.id)
+                            << ",\"rising\":" << (event.rising ? "true" : "false") << "}}\n";
+                    state->control_events << message.rdbuf();
+                    state->control_events.flush();
+                    if (state->trigger_gate) {
+                        state->trigger_gate->trigger(event.t, event.id, event.rising);
+                    }
+                };
+                auto handle_pre_trigger_event = [record](sepia::dvs_event event) { record(event); };
+                auto handle_pre_trigger_trigger_event = [](sepia::evk4::trigger_event) {};
+                auto before_pre_trigger_buffer = [](std::size_t, std::size_t) { return true; };
+                auto after_pre_trigger_buffer = []() {};
+                if (device_type == sepia::psee::EVK4) {
+                    using decode = sepia::evk4::decode<
+                        decltype(handle_event),
+                        decltype(handle_trigger_event),
+                        decltype(before_buffer),
+                        decltype(after_buffer)>;
+                    sepia::evk4::decode<
+                        decltype(handle_pre_trigger_event),
+                        decltype(handle_pre_trigger_trigger_event),
+                        decltype(before_pre_trigger_buffer),
+                        decltype(after_pre_trigger_buffer)>
+                        pre_trigger_decode(
+                            std::move(handle_pre_trigger_event),
+                            std::move(handle_pre_trigger_trigger_event),
+                            std::move(before_pre_trigger_buffer),
+                            std::move(after_pre_trigger_buffer));
+                    state->replay_pre_trigger = [state, pre_trigger_decode]() mutable {
+                        state->pre_trigger.replay(pre_trigger_decode);
+                    };
+                    state->camera = sepia::make_unique<
+                        sepia::evk4::buffered_camera<gen4::record_history<decode>, decltype(handle_exception)&>>(
+                        gen4::record_history<decode>(
+                            decode(
+                                std::move(handle_event),
+                                std::move(handle_trigger_event),
+                                std::move(before_buffer),
+                                std::move(after_buffer)),
+                            state->pre_trigger),
+                        handle_exception,
+                        configuration.evk4_parameters,
+                        state->device.serial,
+                        std::chrono::milliseconds(100),
+                        64,
+                        configuration.fifo_size,
+                        handle_drop);
+                } else {
+                    using decode = sepia::psee413::decode<
+                        decltype(handle_event),
+                        decltype(handle_trigger_event),
+                        decltype(before_buffer),
+                        decltype(after_buffer)>;
+                    sepia::psee413::decode<
+                        decltype(handle_pre_trigger_event),
+                        decltype(handle_pre_trigger_trigger_event),
+                        decltype(before_pre_trigger_buffer),
+                        decltype(after_pre_trigger_buffer)>
+                        pre_trigger_decode(
+                            std::move(handle_pre_trigger_event),
+                            std::move(handle_pre_trigger_trigger_event),
+                            std::move(before_pre_trigger_buffer),
+                            std::move(after_pre_trigger_buffer));
+                    state->replay_pre_trigger = [state, pre_trigger_decode]() mutable {
+                        state->pre_trigger.replay(pre_trigger_decode);
+                    };
+                    state->camera = sepia::make_unique<
+                        sepia::psee413::buffered_camera<gen4::record_history<decode>, decltype(handle_exception)&>>(
+                        gen4::record_history<decode>(
+                            decode(
+                                std::move(handle_event),
+                                std::move(handle_trigger_event),
+                                std::move(before_buffer),
+                                std::move(after_buffer)),
+                            state->pre_trigger),
+                        handle_exception,
+                        configuration.psee413_parameters,
+                        state->device.serial,
+                        std::chrono::milliseconds(100),
+                        64,
+                        configuration.fifo_size,
+                        handle_drop);
+                }
+            }
+            std::unique_ptr<gen4::metrics_server> metrics_server;
+            if (configuration.metrics_port > 0) {
+                metrics_server = sepia::make_unique<gen4::metrics_server>(configuration.metrics_port, [&]() {
+                    std::vector<gen4::camera_sample> samples;
+                    std::vector<gen4::writer_sample> writers;
+                    for (const auto& state : cameras) {
+                        samples.push_back(
+                            {state->device.serial, state->camera->get_transfer_statistics(), &state->metrics});
+                        writers.push_back(
+                            {"recording", state->device.serial, state->filebuf.get_cumulative_statistics()});
+                        if (state->trigger_gate) {
+                            writers.push_back(
+                                {"trigger", state->device.serial, state->trigger_gate->writer_statistics()});
+                        }
+                    }
+                    return metrics.scrape(samples, writers);
+                });
             }
-            drop_threshold = configuration.drop_threshold;
             auto return_value = app.exec();
+            // the cameras' threads use the displays and the metrics, they must stop before these are destroyed
+            metrics_server.reset();
+            for (auto& state : cameras) {
+                state->camera.reset();
+            }
             if (return_value > 0) {
                 throw std::runtime_error("qt returned a non-zero code");
             }
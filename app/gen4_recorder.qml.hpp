@@ -9,7 +9,7 @@ R"(
     Window {
         id: window
         visible: true
-        width: header_width
+        width: Math.round(header_width * camera_columns / camera_rows)
         height: header_height
         Timer {
             interval: 16
@@ -18,6 +18,8 @@ R"(
             onTriggered: {
                 if (parameters.use_count_display) {
                     count_display.trigger_draw();
+                } else if (camera_count > 1) {
+                    dvs_array_display.trigger_draw();
                 } else {
                     dvs_display.trigger_draw();
                 }
@@ -75,15 +77,16 @@ R"(
                 DvsDisplay {
                     objectName: "dvs_display"
                     id: dvs_display
-                    width: parameters.use_count_display ? 0 : eventsView.width
-                    height: parameters.use_count_display ? 0 : eventsView.height
+                    width: parameters.use_count_display || camera_count > 1 ? 0 : eventsView.width
+                    height: parameters.use_count_display || camera_count > 1 ? 0 : eventsView.height
                     canvas_size: Qt.size(header_width, header_height)
+                    gpu_scatter: display_gpu_scatter
                     parameter: 100000
                     style: DvsDisplay.Linear
                     on_colormap: ['#F4C20D', '#191919']
                     off_colormap: ['#1E88E5', '#191919']
                     onPaintAreaChanged: {
-                        if (!parameters.use_count_display) {
+                        if (!parameters.use_count_display && camera_count == 1) {
                             crosshairsPaintArea = Qt.rect(
                                 paint_area.x / Screen.devicePixelRatio,
                                 paint_area.y / Screen.devicePixelRatio,
@@ -93,6 +96,31 @@ R"(
                         }
                     }
                 }
+                DvsArrayDisplay {
+                    objectName: "dvs_array_display"
+                    id: dvs_array_display
+                    visible: camera_count > 1
+                    width: parameters.use_count_display || camera_count == 1 ? 0 : eventsView.width
+                    height: parameters.use_count_display || camera_count == 1 ? 0 : eventsView.height
+                    canvas_size: Qt.size(header_width, header_height)
+                    cameras: camera_count
+                    columns: camera_columns
+                    parameter: 100000
+                    style: DvsArrayDisplay.Linear
+                    on_colormap: ['#F4C20D', '#191919']
+                    off_colormap: ['#1E88E5', '#191919']
+                    onPaintAreaChanged: {
+                        if (!parameters.use_count_display && camera_count > 1) {
+                            // the crosshairs follow the first camera
+                            crosshairsPaintArea = Qt.rect(
+                                paint_area.x / Screen.devicePixelRatio,
+                                paint_area.y / Screen.devicePixelRatio,
+                                paint_area.width / camera_columns / Screen.devicePixelRatio,
+                                paint_area.height / camera_rows / Screen.devicePixelRatio,
+                            );
+                        }
+                    }
+                }
                 CountDisplay {
                     objectName: "count_display"
                     id: count_display
@@ -284,6 +312,7 @@ R"(
                                     if (currentIndex < 3) {
                                         parameters.use_count_display = false
                                         dvs_display.style = [DvsDisplay.Exponential, DvsDisplay.Linear, DvsDisplay.Window][currentIndex]
+                                        dvs_array_display.style = [DvsArrayDisplay.Exponential, DvsArrayDisplay.Linear, DvsArrayDisplay.Window][currentIndex]
                                     } else {
                                         parameters.use_count_display = true
                                     }
@@ -328,6 +357,7 @@ R"(
                                 onCurrentIndexChanged: {
                                     var tau = [50, 100, 200, 500, 1000, 5000, 10000, 50000, 100000][currentIndex] * 1000;
                                     dvs_display.parameter = tau;
+                                    dvs_array_display.parameter = tau;
                                     parameters.tau = tau;
                                 }
                                 palette.button: "#393939"
@@ -411,6 +441,14 @@ R"(
             y: 10
             visible: !parameters.speed.startsWith("USB 3")
         }
+        Text {
+            text: parameters.display_degradation
+            color: "#FFCE44"
+            font: title_font
+            x: 10
+            y: parameters.speed.startsWith("USB 3") ? 10 : 60
+            visible: parameters.display_degradation != ""
+        }
         RoundButton {
             text: parameters.recording_name ? "\uE047" : "\uE061"
             palette.button: "#393939"
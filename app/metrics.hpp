@@ -0,0 +1,485 @@
+#pragma once
+
+#include "../common/camera.hpp"
+#include "async_filebuf.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace gen4 {
+    /// counter is a cumulative metric updated by a single thread.
+    /// The owner updates the value with a relaxed load and store (no read-modify-write), other threads only read it.
+    class counter {
+        public:
+        counter() : _value(0) {}
+        counter(const counter&) = delete;
+        counter(counter&&) = delete;
+        counter& operator=(const counter&) = delete;
+        counter& operator=(counter&&) = delete;
+        virtual ~counter() {}
+
+        /// add increments the counter, it must only be called by the owner thread.
+        void add(uint64_t value) {
+            _value.store(_value.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        /// load returns the current value, it can be called from any thread.
+        uint64_t load() const {
+            return _value.load(std::memory_order_relaxed);
+        }
+
+        protected:
+        std::atomic<uint64_t> _value;
+    };
+
+    /// gauge is an instantaneous metric updated by a single thread.
+    class gauge {
+        public:
+        gauge() : _value(0) {}
+        gauge(const gauge&) = delete;
+        gauge(gauge&&) = delete;
+        gauge& operator=(const gauge&) = delete;
+        gauge& operator=(gauge&&) = delete;
+        virtual ~gauge() {}
+
+        /// set changes the value, it must only be called by the owner thread.
+        void set(uint64_t value) {
+            _value.store(value, std::memory_order_relaxed);
+        }
+
+        /// load returns the current value, it can be called from any thread.
+        uint64_t load() const {
+            return _value.load(std::memory_order_relaxed);
+        }
+
+        protected:
+        std::atomic<uint64_t> _value;
+    };
+
+    /// metrics_writer formats samples with the Prometheus text exposition format.
+    class metrics_writer {
+        public:
+        metrics_writer() {}
+        metrics_writer(const metrics_writer&) = delete;
+        metrics_writer(metrics_writer&&) = delete;
+        metrics_writer& operator=(const metrics_writer&) = delete;
+        metrics_writer& operator=(metrics_writer&&) = delete;
+        virtual ~metrics_writer() {}
+
+        /// counter writes a cumulative sample without labels.
+        template <typename Value>
+        void counter(const std::string& name, const std::string& help, Value value) {
+            family(name, help, "counter");
+            sample(name, {}, value);
+        }
+
+        /// gauge writes an instantaneous sample without labels.
+        template <typename Value>
+        void gauge(const std::string& name, const std::string& help, Value value) {
+            family(name, help, "gauge");
+            sample(name, {}, value);
+        }
+
+        /// family writes the metadata of a metric. It must be followed by all the metric's samples.
+        void family(const std::string& name, const std::string& help, const std::string& type) {
+            _stream << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+        }
+
+        /// sample writes a sample with the given labels (pairs of names and values).
+        template <typename Value>
+        void sample(
+            const std::string& name,
+            const std::vector<std::pair<std::string, std::string>>& labels,
+            Value value) {
+            _stream << name;
+            for (std::size_t index = 0; index < labels.size(); ++index) {
+                _stream << (index == 0 ? "{" : ",") << labels[index].first << "=\"";
+                for (const auto character : labels[index].second) {
+                    switch (character) {
+                        case '\\':
+                            _stream << "\\\\";
+                            break;
+                        case '"':
+                            _stream << "\\\"";
+                            break;
+                        case '\n':
+                            _stream << "\\n";
+                            break;
+                        default:
+                            _stream << character;
+                    }
+                }
+                _stream << "\"" << (index == labels.size() - 1 ? "}" : "");
+            }
+            _stream << " " << value << "\n";
+        }
+
+        /// str returns the formatted samples.
+        std::string str() const {
+            return _stream.str();
+        }
+
+        protected:
+        std::stringstream _stream;
+    };
+
+    /// camera_metrics gathers the counters updated by a camera's decode thread.
+    class camera_metrics {
+        public:
+        camera_metrics() {}
+        camera_metrics(const camera_metrics&) = delete;
+        camera_metrics(camera_metrics&&) = delete;
+        camera_metrics& operator=(const camera_metrics&) = delete;
+        camera_metrics& operator=(camera_metrics&&) = delete;
+        virtual ~camera_metrics() {}
+
+        /// decoded_buffers is updated by the decode thread.
+        counter decoded_buffers;
+
+        /// events is updated by the decode thread.
+        counter events;
+
+        /// decode_duration is updated by the decode thread, in ns.
+        counter decode_duration;
+    };
+
+    /// camera_sample is the state of a camera read by the metrics server.
+    struct camera_sample {
+        std::string serial;
+        sepia::transfer_statistics transfers;
+        const camera_metrics* metrics;
+    };
+
+    /// writer_sample is the state of a writer thread read by the metrics server.
+    /// The name is part of the metric names (for instance "recording" or "trigger"), and the serial is a label.
+    struct writer_sample {
+        std::string name;
+        std::string serial;
+        async_filebuf::statistics statistics;
+    };
+
+    /// pipeline_metrics gathers the counters updated by the render thread.
+    /// Each counter has a single writer, and scrape combines them with the cameras and writers statistics.
+    /// Camera and writer samples are labelled with the camera serial.
+    class pipeline_metrics {
+        public:
+        pipeline_metrics() : _previous_time(std::chrono::steady_clock::now()) {}
+        pipeline_metrics(const pipeline_metrics&) = delete;
+        pipeline_metrics(pipeline_metrics&&) = delete;
+        pipeline_metrics& operator=(const pipeline_metrics&) = delete;
+        pipeline_metrics& operator=(pipeline_metrics&&) = delete;
+        virtual ~pipeline_metrics() {}
+
+        /// frames is updated by the render thread.
+        counter frames;
+
+        /// frame_duration is the interval between the last two frames, updated by the render thread, in ns.
+        gauge frame_duration;
+
+        /// render_duration is the time spent rendering the last frame, updated by the render thread, in ns.
+        gauge render_duration;
+
+        /// scrape formats the metrics. Rates are calculated over the interval since the previous call.
+        /// It must be called by a single thread (typically the metrics server's).
+        std::string scrape(const std::vector<camera_sample>& cameras, const std::vector<writer_sample>& writers) {
+            const auto now = std::chrono::steady_clock::now();
+            const auto interval = std::chrono::duration<double>(now - _previous_time).count();
+            std::vector<snapshot> currents;
+            std::vector<snapshot> previouses;
+            currents.reserve(cameras.size());
+            previouses.reserve(cameras.size());
+            for (const auto& camera : cameras) {
+                currents.push_back({
+                    camera.transfers.transfers,
+                    camera.transfers.bytes,
+                    camera.metrics->events.load(),
+                    camera.metrics->decode_duration.load(),
+                });
+                const auto previous = _previous.find(camera.serial);
+                previouses.push_back(previous == _previous.end() ? snapshot{0, 0, 0, 0} : previous->second);
+            }
+            metrics_writer writer;
+            const auto for_each_camera =
+                [&](const std::string& name, const std::string& help, const std::string& type, auto value) {
+                    writer.family(name, help, type);
+                    for (std::size_t index = 0; index < cameras.size(); ++index) {
+                        writer.sample(
+                            name,
+                            {{"serial", cameras[index].serial}},
+                            value(cameras[index], currents[index], previouses[index]));
+                    }
+                };
+            for_each_camera(
+                "gen4_usb_transfers_total", "USB transfers received", "counter", [](auto&, auto& current, auto&) {
+                    return current.transfers;
+                });
+            for_each_camera(
+                "gen4_usb_bytes_total", "Bytes received over USB", "counter", [](auto&, auto& current, auto&) {
+                    return current.bytes;
+                });
+            for_each_camera(
+                "gen4_usb_transfers_per_second",
+                "USB transfers rate since the previous scrape",
+                "gauge",
+                [&](auto&, auto& current, auto& previous) {
+                    return rate(current.transfers - previous.transfers, interval);
+                });
+            for_each_camera(
+                "gen4_usb_bytes_per_second",
+                "USB throughput since the previous scrape",
+                "gauge",
+                [&](auto&, auto& current, auto& previous) { return rate(current.bytes - previous.bytes, interval); });
+            for_each_camera(
+                "gen4_dropped_buffers_total",
+                "USB buffers dropped because the FIFO was full",
+                "counter",
+                [](auto& camera, auto&, auto&) { return camera.transfers.drops; });
+            for_each_camera(
+                "gen4_fifo_used_buffers",
+                "Buffers waiting for the decode thread",
+                "gauge",
+                [](auto& camera, auto&, auto&) { return camera.transfers.used; });
+            for_each_camera("gen4_fifo_size_buffers", "FIFO capacity", "gauge", [](auto& camera, auto&, auto&) {
+                return camera.transfers.size;
+            });
+            for_each_camera(
+                "gen4_decoded_buffers_total",
+                "Buffers handled by the decode thread",
+                "counter",
+                [](auto& camera, auto&, auto&) { return camera.metrics->decoded_buffers.load(); });
+            for_each_camera("gen4_events_total", "Decoded events", "counter", [](auto&, auto& current, auto&) {
+                return current.events;
+            });
+            for_each_camera(
+                "gen4_decode_seconds_total",
+                "Time spent by the decode thread on buffers",
+                "counter",
+                [](auto&, auto& current, auto&) { return static_cast<double>(current.decode_duration) / 1e9; });
+            for_each_camera(
+                "gen4_decode_nanoseconds_per_event",
+                "Decode time per event since the previous scrape",
+                "gauge",
+                [](auto&, auto& current, auto& previous) {
+                    return current.events == previous.events ?
+                               0.0 :
+                               static_cast<double>(current.decode_duration - previous.decode_duration)
+                                   / static_cast<double>(current.events - previous.events);
+                });
+
+            // writers are grouped by name, so that each metric's samples follow its metadata
+            std::vector<std::string> names;
+            for (const auto& sample : writers) {
+                if (std::find(names.begin(), names.end(), sample.name) == names.end()) {
+                    names.push_back(sample.name);
+                }
+            }
+            for (const auto& name : names) {
+                const auto prefix = "gen4_" + name + "_writer_";
+                const auto for_each_writer =
+                    [&](const std::string& suffix, const std::string& help, const std::string& type, auto value) {
+                        writer.family(prefix + suffix, help, type);
+                        for (const auto& sample : writers) {
+                            if (sample.name == name) {
+                                writer.sample(prefix + suffix, {{"serial", sample.serial}}, value(sample.statistics));
+                            }
+                        }
+                    };
+                for_each_writer("bytes_total", "Bytes written to disk", "counter", [](auto& statistics) {
+                    return statistics.bytes_written;
+                });
+                for_each_writer("queue_depth", "Chunks waiting for the writer thread", "gauge", [](auto& statistics) {
+                    return statistics.queue_depth;
+                });
+                for_each_writer("chunks", "Writer chunks", "gauge", [](auto& statistics) {
+                    return statistics.chunks_count;
+                });
+                for_each_writer("writes_total", "Write system calls", "counter", [](auto& statistics) {
+                    return statistics.writes;
+                });
+                for_each_writer(
+                    "write_seconds_total", "Time spent in write system calls", "counter", [](auto& statistics) {
+                        return static_cast<double>(statistics.total_write_duration.count()) / 1e9;
+                    });
+            }
+            writer.counter("gen4_display_frames_total", "Rendered frames", frames.load());
+            writer.gauge(
+                "gen4_display_frame_seconds",
+                "Interval between the last two frames",
+                static_cast<double>(frame_duration.load()) / 1e9);
+            writer.gauge(
+                "gen4_display_render_seconds",
+                "Render time of the last frame",
+                static_cast<double>(render_duration.load()) / 1e9);
+            _previous_time = now;
+            for (std::size_t index = 0; index < cameras.size(); ++index) {
+                _previous[cameras[index].serial] = currents[index];
+            }
+            return writer.str();
+        }
+
+        protected:
+        /// snapshot stores the counters used to calculate rates.
+        struct snapshot {
+            uint64_t transfers;
+            uint64_t bytes;
+            uint64_t events;
+            uint64_t decode_duration;
+        };
+
+        /// rate divides a count by an interval in seconds.
+        static double rate(uint64_t count, double interval) {
+            return interval > 0.0 ? static_cast<double>(count) / interval : 0.0;
+        }
+
+        std::chrono::steady_clock::time_point _previous_time;
+        std::map<std::string, snapshot> _previous;
+    };
+
+    /// metrics_server answers HTTP GET requests on the loopback interface with the output of a scrape function.
+    /// The scrape function runs on the server thread, it must only read metrics (atomics or lock-free snapshots).
+    class metrics_server {
+        public:
+#if defined(_WIN32)
+        using socket_type = SOCKET;
+        static constexpr socket_type invalid_socket = INVALID_SOCKET;
+#else
+        using socket_type = int;
+        static constexpr socket_type invalid_socket = -1;
+#endif
+
+        metrics_server(uint16_t port, std::function<std::string()> scrape) :
+            _scrape(std::move(scrape)), _socket(invalid_socket), _running(true) {
+#if defined(_WIN32)
+            WSADATA data;
+            if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+                throw std::runtime_error("initializing Windows sockets failed");
+            }
+#endif
+            _socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (_socket == invalid_socket) {
+                throw std::runtime_error("creating the metrics socket failed");
+            }
+            {
+                int reuse = 1;
+                setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+            }
+            sockaddr_in address;
+            std::memset(&address, 0, sizeof(address));
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (bind(_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+                || listen(_socket, 4) != 0) {
+                close_socket(_socket);
+                throw std::runtime_error("listening on 127.0.0.1:" + std::to_string(port) + " failed");
+            }
+            _loop = std::thread([this]() {
+                while (_running.load(std::memory_order_acquire)) {
+                    if (!wait_readable(_socket, 100)) {
+                        continue;
+                    }
+                    const auto client = accept(_socket, nullptr, nullptr);
+                    if (client == invalid_socket) {
+                        continue;
+                    }
+                    respond(client);
+                    close_socket(client);
+                }
+            });
+        }
+        metrics_server(const metrics_server&) = delete;
+        metrics_server(metrics_server&&) = delete;
+        metrics_server& operator=(const metrics_server&) = delete;
+        metrics_server& operator=(metrics_server&&) = delete;
+        virtual ~metrics_server() {
+            _running.store(false, std::memory_order_release);
+            _loop.join();
+            close_socket(_socket);
+#if defined(_WIN32)
+            WSACleanup();
+#endif
+        }
+
+        protected:
+        /// wait_readable returns true if the socket has pending data or connections.
+        static bool wait_readable(socket_type socket, int timeout) {
+#if defined(_WIN32)
+            WSAPOLLFD descriptor{socket, POLLIN, 0};
+            return WSAPoll(&descriptor, 1, timeout) > 0;
+#else
+            pollfd descriptor{socket, POLLIN, 0};
+            return poll(&descriptor, 1, timeout) > 0;
+#endif
+        }
+
+        /// close_socket releases a socket.
+        static void close_socket(socket_type socket) {
+#if defined(_WIN32)
+            closesocket(socket);
+#else
+            close(socket);
+#endif
+        }
+
+        /// respond reads the request header and sends the scraped metrics.
+        virtual void respond(socket_type client) {
+            std::string request;
+            char buffer[1024];
+            while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+                if (!wait_readable(client, 1000)) {
+                    return;
+                }
+                const auto size = recv(client, buffer, sizeof(buffer), 0);
+                if (size <= 0) {
+                    return;
+                }
+                request.append(buffer, static_cast<std::size_t>(size));
+            }
+            std::string status;
+            std::string body;
+            if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0) {
+                status = "200 OK";
+                body = _scrape();
+            } else {
+                status = "404 Not Found";
+            }
+            const auto response = "HTTP/1.1 " + status
+                                  + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                                  + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            for (std::size_t offset = 0; offset < response.size();) {
+                const auto size = send(client, response.data() + offset, static_cast<int>(response.size() - offset), 0);
+                if (size <= 0) {
+                    return;
+                }
+                offset += static_cast<std::size_t>(size);
+            }
+        }
+
+        std::function<std::string()> _scrape;
+        socket_type _socket;
+        std::atomic_bool _running;
+        std::thread _loop;
+    };
+}
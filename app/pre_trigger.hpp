@@ -0,0 +1,148 @@
+#pragma once
+
+#include "../common/psee.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace gen4 {
+    /// pre_trigger_ring keeps the most recent raw camera buffers in preallocated memory.
+    /// Buffers are stored undecoded, together with the decoder state before them, so that a second decoder can replay
+    /// them later. The history is bounded by a number of bytes and by a duration measured on the camera clock.
+    class pre_trigger_ring {
+        public:
+        pre_trigger_ring(std::size_t capacity, uint64_t duration) :
+            _bytes(capacity),
+            _entries(std::max(static_cast<std::size_t>(1024), capacity / 1024)),
+            _duration(duration),
+            _first(0),
+            _count(0),
+            _head(0) {
+            _buffer.reserve((1 << 17) + sizeof(uint64_t));
+        }
+        pre_trigger_ring(const pre_trigger_ring&) = delete;
+        pre_trigger_ring(pre_trigger_ring&&) = default;
+        pre_trigger_ring& operator=(const pre_trigger_ring&) = delete;
+        pre_trigger_ring& operator=(pre_trigger_ring&&) = default;
+        virtual ~pre_trigger_ring() {}
+
+        /// enabled returns false if the ring cannot hold any data.
+        bool enabled() const {
+            return !_bytes.empty() && _duration > 0;
+        }
+
+        /// push copies a buffer into the ring, evicting the oldest buffers if needed.
+        void push(const std::vector<uint8_t>& buffer, const sepia::psee::decode_state& state) {
+            if (!enabled()) {
+                return;
+            }
+            if (buffer.size() > _bytes.size()) {
+                clear();
+                return;
+            }
+            while (_count > 0
+                   && (_count == _entries.size() || state.event.t - _entries[_first].state.event.t > _duration)) {
+                pop();
+            }
+            const auto offset = allocate(buffer.size());
+            std::copy(buffer.begin(), buffer.end(), std::next(_bytes.begin(), offset));
+            _entries[(_first + _count) % _entries.size()] = {offset, buffer.size(), state};
+            ++_count;
+            _head = offset + buffer.size();
+        }
+
+        /// replay feeds the stored buffers to a decoder, from the oldest to the most recent.
+        /// The decoder state is restored before the first buffer.
+        template <typename Decode>
+        void replay(Decode& decode) {
+            for (std::size_t index = 0; index < _count; ++index) {
+                const auto& entry = _entries[(_first + index) % _entries.size()];
+                if (index == 0) {
+                    decode.restore(entry.state);
+                }
+                _buffer.resize(entry.size);
+                std::copy(
+                    std::next(_bytes.begin(), entry.offset),
+                    std::next(_bytes.begin(), entry.offset + entry.size),
+                    _buffer.begin());
+                decode(_buffer, 0, 0);
+            }
+        }
+
+        /// clear removes all the stored buffers.
+        void clear() {
+            _first = 0;
+            _count = 0;
+            _head = 0;
+        }
+
+        protected:
+        /// entry locates a buffer in the ring.
+        struct entry {
+            std::size_t offset;
+            std::size_t size;
+            sepia::psee::decode_state state;
+        };
+
+        /// pop evicts the oldest buffer.
+        void pop() {
+            _first = (_first + 1) % _entries.size();
+            --_count;
+        }
+
+        /// allocate returns the offset of a contiguous free region, evicting the oldest buffers if needed.
+        std::size_t allocate(std::size_t size) {
+            for (;;) {
+                if (_count == 0) {
+                    return 0;
+                }
+                const auto oldest = _entries[_first].offset;
+                if (oldest > _head) {
+                    if (oldest - _head >= size) {
+                        return _head;
+                    }
+                } else if (oldest < _head) {
+                    if (_bytes.size() - _head >= size) {
+                        return _head;
+                    }
+                    if (oldest >= size) {
+                        return 0;
+                    }
+                }
+                pop();
+            }
+        }
+
+        std::vector<uint8_t> _bytes;
+        std::vector<entry> _entries;
+        uint64_t _duration;
+        std::size_t _first;
+        std::size_t _count;
+        std::size_t _head;
+        std::vector<uint8_t> _buffer;
+    };
+
+    /// record_history saves every buffer in a pre-trigger ring before decoding it.
+    /// It can be used as the buffer handler of sepia::evk4::buffered_camera and sepia::psee413::buffered_camera.
+    template <typename Decode>
+    class record_history {
+        public:
+        record_history(Decode&& decode, pre_trigger_ring& ring) : _decode(std::forward<Decode>(decode)), _ring(ring) {}
+        record_history(const record_history&) = delete;
+        record_history(record_history&&) = default;
+        record_history& operator=(const record_history&) = delete;
+        record_history& operator=(record_history&&) = delete;
+        virtual ~record_history() {}
+
+        /// operator() handles a buffer.
+        void operator()(const std::vector<uint8_t>& buffer, std::size_t used, std::size_t size) {
+            _ring.push(buffer, _decode.state());
+            _decode(buffer, used, size);
+        }
+
+        protected:
+        Decode _decode;
+        pre_trigger_ring& _ring;
+    };
+}
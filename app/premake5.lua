@@ -19,6 +19,7 @@ project "gen4_recorder"
     files(qt.moc({
         "chameleon/source/background_cleaner.hpp",
         "chameleon/source/dvs_display.hpp",
+        "chameleon/source/dvs_array_display.hpp",
         "chameleon/source/count_display.hpp"},
         "build/moc"))
     includedirs(qt.includedirs())
@@ -45,6 +46,86 @@ project "gen4_recorder"
         libdirs {"../common/libusb"}
         links {"libusb-1.0"}
 
+project "gen4_daemon"
+    location "build"
+    kind "ConsoleApp"
+    language "C++"
+    defines {"SEPIA_COMPILER_WORKING_DIRECTORY='" .. project().location .. "'"}
+    files {"gen4_daemon.cpp", "../common/*.hpp"}
+    filter "system:linux"
+        buildoptions {"-std=c++17"}
+        linkoptions {"-std=c++17"}
+        links {"pthread", "usb-1.0"}
+    filter "system:macosx"
+        buildoptions {"-std=c++17"}
+        linkoptions {"-std=c++17"}
+        includedirs {"/usr/local/include", "/opt/homebrew/include"}
+        libdirs {"/usr/local/lib", "/opt/homebrew/lib"}
+        links {"usb-1.0"}
+    filter "system:windows"
+        architecture "x64"
+        defines {"NOMINMAX"}
+        buildoptions {"/std:c++17"}
+        files {"../.clang-format"}
+        libdirs {"../common/libusb"}
+        links {"libusb-1.0"}
+
+project "render_benchmark"
+    location "build"
+    kind "ConsoleApp"
+    language "C++"
+    files {"render_benchmark.cpp"}
+    files(qt.moc({
+        "chameleon/source/count_display.hpp",
+        "chameleon/source/delta_t_display.hpp",
+        "chameleon/source/dvs_display.hpp",
+        "chameleon/source/flow_display.hpp"},
+        "build/moc"))
+    includedirs(qt.includedirs())
+    libdirs(qt.libdirs())
+    links(qt.links())
+    buildoptions(qt.buildoptions())
+    linkoptions(qt.linkoptions())
+    filter "system:linux"
+        buildoptions {"-std=c++17"}
+        linkoptions {"-std=c++17"}
+        links {"pthread"}
+    filter "system:macosx"
+        buildoptions {"-std=c++17"}
+        linkoptions {"-std=c++17"}
+    filter "system:windows"
+        architecture "x64"
+        defines {"NOMINMAX"}
+        buildoptions {"/std:c++17"}
+        files {"../.clang-format"}
+
+project "es_to_video"
+    location "build"
+    kind "ConsoleApp"
+    language "C++"
+    files {"es_to_video.cpp"}
+    files(qt.moc({
+        "chameleon/source/dvs_display.hpp",
+        "chameleon/source/frame_generator.hpp"},
+        "build/moc"))
+    includedirs(qt.includedirs())
+    libdirs(qt.libdirs())
+    links(qt.links())
+    buildoptions(qt.buildoptions())
+    linkoptions(qt.linkoptions())
+    filter "system:linux"
+        buildoptions {"-std=c++17"}
+        linkoptions {"-std=c++17"}
+        links {"pthread"}
+    filter "system:macosx"
+        buildoptions {"-std=c++17"}
+        linkoptions {"-std=c++17"}
+    filter "system:windows"
+        architecture "x64"
+        defines {"NOMINMAX"}
+        buildoptions {"/std:c++17"}
+        files {"../.clang-format"}
+
 project "lsgen4"
     location "build"
     kind "ConsoleApp"
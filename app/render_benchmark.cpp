@@ -0,0 +1,377 @@
+#include "chameleon/source/count_display.hpp"
+#include "chameleon/source/delta_t_display.hpp"
+#include "chameleon/source/dvs_display.hpp"
+#include "chameleon/source/flow_display.hpp"
+#include "pontella.hpp"
+#include <QtGui/QGuiApplication>
+#include <QtGui/QOffscreenSurface>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFramebufferObject>
+#include <QtGui/QSurfaceFormat>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+/// event contains the fields read by every renderer.
+struct event {
+    uint64_t t;
+    uint16_t x;
+    uint16_t y;
+    bool on;
+    uint32_t count;
+    uint32_t delta_t;
+    float vx;
+    float vy;
+};
+
+/// benchmark_parameters describes the synthetic stream and the render loop.
+struct benchmark_parameters {
+    uint16_t width;
+    uint16_t height;
+    double rate;
+    double density;
+    std::size_t frames;
+    double frame_rate;
+    bool gpu_scatter;
+};
+
+/// event_generator produces uniformly distributed events on a random subset of the pixels.
+class event_generator {
+    public:
+    event_generator(const benchmark_parameters& parameters) :
+        _width(parameters.width), _engine(42), _delta_t_distribution(std::log(10.0), std::log(1e5)) {
+        std::vector<uint32_t> pixels(static_cast<std::size_t>(parameters.width) * parameters.height);
+        for (std::size_t index = 0; index < pixels.size(); ++index) {
+            pixels[index] = static_cast<uint32_t>(index);
+        }
+        std::shuffle(pixels.begin(), pixels.end(), _engine);
+        pixels.resize(std::max(
+            static_cast<std::size_t>(1),
+            static_cast<std::size_t>(std::round(parameters.density * static_cast<double>(pixels.size())))));
+        _active_pixels = std::move(pixels);
+        _pixel_distribution = std::uniform_int_distribution<std::size_t>(0, _active_pixels.size() - 1);
+    }
+    event_generator(const event_generator&) = delete;
+    event_generator(event_generator&&) = delete;
+    event_generator& operator=(const event_generator&) = delete;
+    event_generator& operator=(event_generator&&) = delete;
+    virtual ~event_generator() {}
+
+    /// next returns an event with the given timestamp.
+    event next(uint64_t t) {
+        const auto pixel = _active_pixels[_pixel_distribution(_engine)];
+        return {
+            t,
+            static_cast<uint16_t>(pixel % _width),
+            static_cast<uint16_t>(pixel / _width),
+            (_engine() & 1) == 1,
+            1 + static_cast<uint32_t>(_engine() % 255),
+            static_cast<uint32_t>(std::exp(_delta_t_distribution(_engine))),
+            _flow_distribution(_engine),
+            _flow_distribution(_engine),
+        };
+    }
+
+    protected:
+    const uint16_t _width;
+    std::mt19937 _engine;
+    std::vector<uint32_t> _active_pixels;
+    std::uniform_int_distribution<std::size_t> _pixel_distribution;
+    std::uniform_real_distribution<double> _delta_t_distribution;
+    std::normal_distribution<float> _flow_distribution;
+};
+
+/// measurement summarises a benchmark phase.
+struct measurement {
+    double duration;
+    uint64_t events;
+    double push_duration;
+    std::vector<double> paint_durations;
+    std::vector<double> finish_durations;
+};
+
+/// measure feeds a renderer in real time from a producer thread for parameters.frames frames.
+/// If painting is true, the main thread paints at parameters.frame_rate concurrently with the producer.
+/// Event timestamps are measured from origin, so that they keep increasing across phases. Durations are in seconds.
+template <typename Push, typename Paint>
+measurement measure(
+    const benchmark_parameters& parameters,
+    std::chrono::steady_clock::time_point origin,
+    Push push,
+    Paint paint,
+    bool painting) {
+    measurement result{0.0, 0, 0.0, {}, {}};
+    std::atomic_bool running(true);
+    const auto begin = std::chrono::steady_clock::now();
+    std::thread producer([&]() {
+        event_generator generator(parameters);
+        std::vector<event> batch;
+        const auto maximum_batch_size =
+            std::max(static_cast<std::size_t>(1), static_cast<std::size_t>(parameters.rate / 1000));
+        batch.reserve(maximum_batch_size);
+        while (running.load(std::memory_order_acquire)) {
+            const auto now = std::chrono::steady_clock::now();
+            const auto target =
+                static_cast<uint64_t>(parameters.rate * std::chrono::duration<double>(now - begin).count());
+            const auto t =
+                static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - origin).count());
+            if (target > result.events) {
+                batch.clear();
+                for (auto index = std::min(static_cast<std::size_t>(target - result.events), maximum_batch_size);
+                     index > 0;
+                     --index) {
+                    batch.push_back(generator.next(t));
+                }
+                const auto push_begin = std::chrono::steady_clock::now();
+                push(batch);
+                result.push_duration +=
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - push_begin).count();
+                result.events += batch.size();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    });
+    const auto frame_duration = std::chrono::duration<double>(1.0 / parameters.frame_rate);
+    for (std::size_t frame = 0; frame < parameters.frames; ++frame) {
+        std::this_thread::sleep_until(
+            begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(frame_duration * (frame + 1)));
+        if (painting) {
+            const auto paint_begin = std::chrono::steady_clock::now();
+            paint();
+            const auto paint_end = std::chrono::steady_clock::now();
+            glFinish();
+            result.paint_durations.push_back(std::chrono::duration<double>(paint_end - paint_begin).count());
+            result.finish_durations.push_back(
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - paint_end).count());
+        }
+    }
+    running.store(false, std::memory_order_release);
+    producer.join();
+    result.duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+/// statistics_to_json formats the mean, median and 99th percentile of durations in milliseconds.
+std::string statistics_to_json(std::vector<double> durations) {
+    if (durations.empty()) {
+        return "null";
+    }
+    std::sort(durations.begin(), durations.end());
+    double sum = 0.0;
+    for (const auto duration : durations) {
+        sum += duration;
+    }
+    std::stringstream stream;
+    stream << "{\"mean\":" << sum / static_cast<double>(durations.size()) * 1e3
+           << ",\"p50\":" << durations[durations.size() / 2] * 1e3
+           << ",\"p99\":" << durations[std::min(durations.size() - 1, durations.size() * 99 / 100)] * 1e3 << "}";
+    return stream.str();
+}
+
+/// benchmark runs the producer alone, then with painting, and prints the results as a JSON line.
+/// The lock wait is estimated from the difference between the push costs of both phases.
+template <typename Renderer, typename Push>
+void benchmark(const std::string& name, const benchmark_parameters& parameters, Renderer& renderer, Push push) {
+    const auto origin = std::chrono::steady_clock::now();
+    const auto alone = measure(
+        parameters, origin, [&](const std::vector<event>& batch) { push(renderer, batch); }, []() {}, false);
+    const auto painting = measure(
+        parameters,
+        origin,
+        [&](const std::vector<event>& batch) { push(renderer, batch); },
+        [&]() { renderer.paint(); },
+        true);
+    const auto push_alone = alone.events == 0 ? 0.0 : alone.push_duration / static_cast<double>(alone.events);
+    const auto push_painting =
+        painting.events == 0 ? 0.0 : painting.push_duration / static_cast<double>(painting.events);
+    const auto lock_wait = std::max(0.0, push_painting - push_alone) * static_cast<double>(painting.events)
+                           / static_cast<double>(parameters.frames);
+    std::cout << "{\"display\":\"" << name << "\",\"width\":" << parameters.width << ",\"height\":" << parameters.height
+              << ",\"rate\":" << parameters.rate << ",\"density\":" << parameters.density
+              << ",\"events_per_second\":" << static_cast<double>(painting.events) / painting.duration
+              << ",\"push_ns_per_event_alone\":" << push_alone * 1e9
+              << ",\"push_ns_per_event_painting\":" << push_painting * 1e9
+              << ",\"lock_wait_ms_per_frame\":" << lock_wait * 1e3
+              << ",\"paint_ms\":" << statistics_to_json(painting.paint_durations)
+              << ",\"finish_ms\":" << statistics_to_json(painting.finish_durations) << "}" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    return pontella::main(
+        {"render_benchmark measures the cost of the display renderers on an offscreen surface",
+         "Syntax: render_benchmark [options]",
+         "Each display is fed in real time by a producer thread, first alone, then while the main thread paints.",
+         "Results are printed as one JSON object per display. Run with QT_QPA_PLATFORM=offscreen",
+         "(and LIBGL_ALWAYS_SOFTWARE=1 to use Mesa llvmpipe) on machines without display or GPU.",
+         "Available options:",
+         "    -d [name], --display [name]          selects the display (dvs, count, delta_t, flow or all)",
+         "                                             defaults to all",
+         "    -s [size], --size [size]             sets the canvas size",
+         "                                             defaults to 1280x720",
+         "    -r [rate], --rate [rate]             sets the event rate in events per second",
+         "                                             defaults to 10e6",
+         "    -e [ratio], --density [ratio]        sets the ratio of pixels that receive events",
+         "                                             defaults to 0.1",
+         "    -f [frames], --frames [frames]       sets the number of frames per phase",
+         "                                             defaults to 300",
+         "    -t [rate], --frame-rate [rate]       sets the paint rate in frames per second",
+         "                                             defaults to 60",
+         "    -g, --gpu-scatter                    uses the GPU scatter mode of the dvs display",
+         "    -h, --help                           shows this help message"},
+        argc,
+        argv,
+        0,
+        {
+            {"display", {"d"}},
+            {"size", {"s"}},
+            {"rate", {"r"}},
+            {"density", {"e"}},
+            {"frames", {"f"}},
+            {"frame-rate", {"t"}},
+        },
+        {
+            {"gpu-scatter", {"g"}},
+        },
+        [&](pontella::command command) {
+            benchmark_parameters parameters{1280, 720, 10e6, 0.1, 300, 60.0, false};
+            std::string display = "all";
+            {
+                auto display_candidate = command.options.find("display");
+                if (display_candidate != command.options.end()) {
+                    display = display_candidate->second;
+                    if (display != "dvs" && display != "count" && display != "delta_t" && display != "flow"
+                        && display != "all") {
+                        throw std::runtime_error(
+                            "unknown display \"" + display + "\" (expected dvs, count, delta_t, flow or all)");
+                    }
+                }
+            }
+            {
+                auto size_candidate = command.options.find("size");
+                if (size_candidate != command.options.end()) {
+                    const auto separator = size_candidate->second.find('x');
+                    if (separator == std::string::npos) {
+                        throw std::runtime_error("the size must have the format [width]x[height]");
+                    }
+                    parameters.width = static_cast<uint16_t>(std::stoul(size_candidate->second.substr(0, separator)));
+                    parameters.height = static_cast<uint16_t>(std::stoul(size_candidate->second.substr(separator + 1)));
+                }
+            }
+            {
+                auto rate_candidate = command.options.find("rate");
+                if (rate_candidate != command.options.end()) {
+                    parameters.rate = std::stod(rate_candidate->second);
+                }
+            }
+            {
+                auto density_candidate = command.options.find("density");
+                if (density_candidate != command.options.end()) {
+                    parameters.density = std::stod(density_candidate->second);
+                }
+            }
+            {
+                auto frames_candidate = command.options.find("frames");
+                if (frames_candidate != command.options.end()) {
+                    parameters.frames = std::stoull(frames_candidate->second);
+                }
+            }
+            {
+                auto frame_rate_candidate = command.options.find("frame-rate");
+                if (frame_rate_candidate != command.options.end()) {
+                    parameters.frame_rate = std::stod(frame_rate_candidate->second);
+                }
+            }
+            parameters.gpu_scatter = command.flags.find("gpu-scatter") != command.flags.end();
+            if (parameters.width == 0 || parameters.height == 0 || parameters.rate <= 0.0
+                || parameters.density <= 0.0 || parameters.density > 1.0 || parameters.frames == 0
+                || parameters.frame_rate <= 0.0) {
+                throw std::runtime_error("the benchmark parameters are out of range");
+            }
+
+            int qt_argc = 1;
+            char* qt_argv[] = {argv[0], nullptr};
+            QGuiApplication app(qt_argc, qt_argv);
+            QSurfaceFormat format;
+            format.setVersion(3, 3);
+            format.setProfile(QSurfaceFormat::CoreProfile);
+            QOffscreenSurface surface;
+            surface.setFormat(format);
+            surface.create();
+            QOpenGLContext context;
+            context.setFormat(format);
+            if (!context.create() || !context.makeCurrent(&surface)) {
+                throw std::runtime_error("creating an OpenGL 3.3 context failed");
+            }
+            const QSize canvas_size(parameters.width, parameters.height);
+            QOpenGLFramebufferObject framebuffer(canvas_size);
+            framebuffer.bind();
+            const QRectF area(0, 0, parameters.width, parameters.height);
+            if (display == "dvs" || display == "all") {
+                chameleon::dvs_display_renderer renderer(
+                    canvas_size,
+                    1e5f,
+                    0,
+                    QVector<QColor>({QColor("#f4c20d"), QColor("#191919")}),
+                    QVector<QColor>({QColor("#1e88e5"), QColor("#191919")}),
+                    QColor("#191919"),
+                    parameters.gpu_scatter);
+                renderer.set_rendering_area(area, parameters.height);
+                benchmark(
+                    parameters.gpu_scatter ? "dvs_gpu_scatter" : "dvs",
+                    parameters,
+                    renderer,
+                    [](chameleon::dvs_display_renderer& renderer, const std::vector<event>& batch) {
+                        renderer.lock();
+                        for (const auto& event : batch) {
+                            renderer.push_unsafe(event);
+                        }
+                        renderer.unlock();
+                    });
+            }
+            if (display == "count" || display == "all") {
+                chameleon::count_display_renderer renderer(canvas_size, 0.01f, 1);
+                renderer.set_rendering_area(area, area, parameters.height);
+                benchmark(
+                    "count",
+                    parameters,
+                    renderer,
+                    [](chameleon::count_display_renderer& renderer, const std::vector<event>& batch) {
+                        renderer.push_range(batch.begin(), batch.end());
+                    });
+            }
+            if (display == "delta_t" || display == "all") {
+                chameleon::delta_t_display_renderer renderer(canvas_size, 0.01f, 1);
+                renderer.set_rendering_area(area, area, parameters.height);
+                benchmark(
+                    "delta_t",
+                    parameters,
+                    renderer,
+                    [](chameleon::delta_t_display_renderer& renderer, const std::vector<event>& batch) {
+                        for (const auto& event : batch) {
+                            renderer.push(event);
+                        }
+                    });
+            }
+            if (display == "flow" || display == "all") {
+                chameleon::flow_display_renderer renderer(canvas_size, 1.0f, 1e5f);
+                renderer.set_rendering_area(area, parameters.height);
+                benchmark(
+                    "flow",
+                    parameters,
+                    renderer,
+                    [](chameleon::flow_display_renderer& renderer, const std::vector<event>& batch) {
+                        for (const auto& event : batch) {
+                            renderer.push(event);
+                        }
+                    });
+            }
+            framebuffer.release();
+            context.doneCurrent();
+        });
+}
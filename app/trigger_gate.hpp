@@ -0,0 +1,258 @@
+#pragma once
+
+#include "async_filebuf.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace gen4 {
+    /// trigger_edge lists the external trigger transitions that open a clip.
+    enum class trigger_edge {
+        rising,
+        falling,
+        both,
+    };
+
+    /// string_to_trigger_edge converts a configuration value.
+    inline trigger_edge string_to_trigger_edge(const std::string& value) {
+        if (value == "rising") {
+            return trigger_edge::rising;
+        }
+        if (value == "falling") {
+            return trigger_edge::falling;
+        }
+        if (value == "both") {
+            return trigger_edge::both;
+        }
+        throw std::runtime_error(
+            "unknown trigger edge \"" + value + "\" (expected \"rising\", \"falling\", or \"both\")");
+    }
+
+    /// trigger_configuration describes trigger-gated recordings.
+    struct trigger_configuration {
+        /// enabled replaces manual recordings with trigger-gated clips.
+        bool enabled;
+
+        /// id is the external trigger channel.
+        uint8_t id;
+
+        /// edge is the transition that opens a clip.
+        trigger_edge edge;
+
+        /// gate keeps the clip open until the opposite transition, instead of closing it after a fixed window.
+        bool gate;
+
+        /// before is the duration recorded before the opening transition, in µs.
+        uint64_t before;
+
+        /// after is the duration recorded after the opening (or closing, in gate mode) transition, in µs.
+        uint64_t after;
+
+        /// history is the maximum number of events kept to record the duration before a transition.
+        std::size_t history;
+    };
+
+    /// trigger_gate cuts the decoded event stream into clips delimited by external trigger transitions.
+    /// Triggers and events come from the same decoder, therefore clip boundaries are exact to the microsecond
+    /// instead of being aligned on USB buffers. All the clips share a single writer thread and its preallocated chunks,
+    /// so opening a clip only costs a file creation.
+    class trigger_gate {
+        public:
+        trigger_gate(
+            const trigger_configuration& configuration,
+            uint16_t width,
+            uint16_t height,
+            std::ofstream& control_events) :
+            _configuration(configuration),
+            _width(width),
+            _height(height),
+            _control_events(control_events),
+            _filebuf(1 << 20, 16),
+            _stream(&_filebuf),
+            _armed(false),
+            _open(false),
+            _begin_t(0),
+            _end_t(0),
+            _clips(0),
+            _armed_bytes(0),
+            _history(configuration.before > 0 ? configuration.history : 0),
+            _history_first(0),
+            _history_count(0) {}
+        trigger_gate(const trigger_gate&) = delete;
+        trigger_gate(trigger_gate&&) = delete;
+        trigger_gate& operator=(const trigger_gate&) = delete;
+        trigger_gate& operator=(trigger_gate&&) = delete;
+        virtual ~trigger_gate() {
+            disarm();
+        }
+
+        /// arm waits for triggers, and names the next clips after the given path and stem.
+        void arm(const std::string& directory, const std::string& stem) {
+            disarm();
+            _directory = directory;
+            _stem = stem;
+            _clips = 0;
+            _armed_bytes = _filebuf.get_cumulative_statistics().bytes_submitted;
+            _history_count = 0;
+            _armed = true;
+            std::stringstream message;
+            message << "{\"stem\":\"" << _stem << "\",\"id\":" << static_cast<int32_t>(_configuration.id) << "}";
+            control_log(_control_events, utc_timestamp(), "arm_trigger", message.str());
+        }
+
+        /// disarm flushes and closes the active clip, if any, and ignores the next triggers.
+        void disarm() {
+            if (_armed) {
+                close();
+                _armed = false;
+                control_log(_control_events, utc_timestamp(), "disarm_trigger", std::to_string(_clips));
+            }
+        }
+
+        /// armed returns true if the gate is waiting for or recording a clip.
+        bool armed() const {
+            return _armed;
+        }
+
+        /// clips returns the number of clips opened since the gate was armed.
+        std::size_t clips() const {
+            return _clips;
+        }
+
+        /// bytes returns the number of bytes handed to the writer thread since the gate was armed.
+        /// The writer's statistics are cumulative, hence the total at arm time is subtracted.
+        uint64_t bytes() const {
+            return _filebuf.get_cumulative_statistics().bytes_submitted - _armed_bytes;
+        }
+
+        /// writer_statistics returns the activity of the thread that writes clips.
+        async_filebuf::statistics writer_statistics() const {
+            return _filebuf.get_cumulative_statistics();
+        }
+
+        /// writer returns the thread that writes clips, for instance to pin it.
+        std::thread& writer() {
+            return _filebuf.writer();
+        }
+
+        /// trigger handles an external trigger transition.
+        /// In gate mode, the clip closes after the transition opposite to edge, or after the next transition if edge
+        /// is both. It closes immediately if after is zero.
+        void trigger(uint64_t t, uint8_t id, bool rising) {
+            if (!_armed || id != _configuration.id) {
+                return;
+            }
+            if (_open && t > _end_t) {
+                close();
+            }
+            auto opens = _configuration.edge == trigger_edge::both
+                         || (_configuration.edge == trigger_edge::rising) == rising;
+            if (_configuration.gate && _open && _configuration.edge == trigger_edge::both) {
+                opens = _end_t != std::numeric_limits<uint64_t>::max();
+            }
+            if (opens) {
+                if (_open) {
+                    _end_t = _configuration.gate ? std::numeric_limits<uint64_t>::max() :
+                                                   std::max(_end_t, t + _configuration.after);
+                } else {
+                    open(t);
+                }
+            } else if (_configuration.gate && _open) {
+                _end_t = t + _configuration.after;
+                if (_configuration.after == 0) {
+                    close();
+                }
+            }
+        }
+
+        /// push handles a decoded event.
+        void push(sepia::dvs_event event) {
+            if (!_armed) {
+                return;
+            }
+            if (_open) {
+                if (event.t <= _end_t) {
+                    write(event);
+                    return;
+                }
+                close();
+            }
+            if (!_history.empty()) {
+                _history[(_history_first + _history_count) % _history.size()] = event;
+                if (_history_count == _history.size()) {
+                    _history_first = (_history_first + 1) % _history.size();
+                } else {
+                    ++_history_count;
+                }
+            }
+        }
+
+        protected:
+        /// open starts a clip and writes the events that precede the transition.
+        void open(uint64_t trigger_t) {
+            _begin_t = trigger_t > _configuration.before ? trigger_t - _configuration.before : 0;
+            _end_t = _configuration.gate ? std::numeric_limits<uint64_t>::max() : trigger_t + _configuration.after;
+            std::stringstream filename;
+            filename << _stem << "_trigger_" << std::setfill('0') << std::setw(6) << _clips << ".es";
+            _filename = sepia::join({_directory, filename.str()});
+            _filebuf.open(_filename);
+            _write = sepia::make_unique<sepia::write_to_reference<sepia::type::dvs>>(_stream, _width, _height);
+            _open = true;
+            ++_clips;
+            std::stringstream message;
+            message << "{\"filename\":\"" << _filename << "\",\"trigger_t\":" << trigger_t
+                    << ",\"initial_t\":" << _begin_t << "}";
+            control_log(_control_events, utc_timestamp(), "start_clip", message.str());
+            for (; _history_count > 0; --_history_count) {
+                const auto event = _history[_history_first];
+                _history_first = (_history_first + 1) % _history.size();
+                if (event.t >= _begin_t) {
+                    write(event);
+                }
+            }
+            _history_first = 0;
+        }
+
+        /// close ends the active clip.
+        void close() {
+            if (_open) {
+                _open = false;
+                _write.reset();
+                _filebuf.close();
+                control_log(_control_events, utc_timestamp(), "stop_clip", std::string("\"") + _filename + "\"");
+            }
+        }
+
+        /// write sends an event to the active clip.
+        void write(sepia::dvs_event event) {
+            event.t -= _begin_t;
+            _write->operator()(event);
+        }
+
+        const trigger_configuration _configuration;
+        const uint16_t _width;
+        const uint16_t _height;
+        std::ofstream& _control_events;
+        async_filebuf _filebuf;
+        std::ostream _stream;
+        std::unique_ptr<sepia::write_to_reference<sepia::type::dvs>> _write;
+        bool _armed;
+        bool _open;
+        uint64_t _begin_t;
+        uint64_t _end_t;
+        std::size_t _clips;
+        uint64_t _armed_bytes;
+        std::string _directory;
+        std::string _stem;
+        std::string _filename;
+        std::vector<sepia::dvs_event> _history;
+        std::size_t _history_first;
+        std::size_t _history_count;
+    };
+}
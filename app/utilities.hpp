@@ -0,0 +1,84 @@
+#pragma once
+
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace gen4 {
+    /// utc_timestamp_and_filename returns the current time as an ISO 8601 timestamp and as a filename stem.
+    inline std::pair<std::string, std::string> utc_timestamp_and_filename() {
+        std::timespec timespec;
+        std::timespec_get(&timespec, TIME_UTC);
+        std::stringstream timestamp;
+        std::stringstream filename;
+        timestamp << std::put_time(std::gmtime(&timespec.tv_sec), "%FT%T.") << std::setfill('0') << std::setw(6)
+                  << (timespec.tv_nsec / 1000) << "Z";
+        filename << std::put_time(std::gmtime(&timespec.tv_sec), "%FT%H-%M-%SZ");
+        return {timestamp.str(), filename.str()};
+    }
+
+    /// utc_timestamp returns the current time as an ISO 8601 timestamp.
+    inline std::string utc_timestamp() {
+        std::timespec timespec;
+        std::timespec_get(&timespec, TIME_UTC);
+        std::stringstream timestamp;
+        timestamp << std::put_time(std::gmtime(&timespec.tv_sec), "%FT%T.") << std::setfill('0') << std::setw(6)
+                  << (timespec.tv_nsec / 1000) << "Z";
+        return timestamp.str();
+    }
+
+    /// control_log appends a JSON line to the control events file.
+    inline void control_log(
+        std::ofstream& control_events,
+        const std::string& timestamp,
+        const std::string& type,
+        const std::string& payload) {
+        std::stringstream message;
+        message << "{\"t\":\"" << timestamp << "\",\"type\":\"" << type << "\",\"payload\":" << payload << "}\n";
+        control_events << message.rdbuf();
+        control_events.flush();
+    }
+
+    /// pin_thread restricts a thread to the given CPU.
+    /// On platforms without an affinity API (macOS), the call has no effect and false is returned.
+    inline bool pin_thread(std::thread::native_handle_type handle, std::size_t cpu) {
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cpus) != 0) {
+            throw std::runtime_error("pinning a thread to CPU " + std::to_string(cpu) + " failed");
+        }
+        return true;
+#elif defined(_WIN32)
+        if (SetThreadAffinityMask(handle, static_cast<DWORD_PTR>(1) << cpu) == 0) {
+            throw std::runtime_error("pinning a thread to CPU " + std::to_string(cpu) + " failed");
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /// pin_current_thread restricts the calling thread to the given CPU.
+    inline bool pin_current_thread(std::size_t cpu) {
+#if defined(__linux__)
+        return pin_thread(pthread_self(), cpu);
+#elif defined(_WIN32)
+        return pin_thread(GetCurrentThread(), cpu);
+#else
+        return false;
+#endif
+    }
+}
@@ -0,0 +1,433 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sepia {
+    namespace accumulate {
+        /// representation lists the supported frame types.
+        enum class representation {
+            /// histogram counts events per pixel, with two channels (off, on).
+            histogram,
+
+            /// time_surface evaluates exp((t_last - t) / tau) per pixel at the end of each window, with two channels
+            /// (off, on). The pixel state is kept across windows.
+            time_surface,
+
+            /// voxel_grid splits each window into bins and sums polarities (+1 for on, -1 for off) with a linear
+            /// interpolation between the two nearest bins.
+            voxel_grid,
+        };
+
+        /// string_to_representation converts a representation name.
+        inline representation string_to_representation(const std::string& value) {
+            if (value == "histogram") {
+                return representation::histogram;
+            }
+            if (value == "time_surface") {
+                return representation::time_surface;
+            }
+            if (value == "voxel_grid") {
+                return representation::voxel_grid;
+            }
+            throw std::runtime_error(
+                "unknown representation \"" + value
+                + "\" (expected \"histogram\", \"time_surface\", or \"voxel_grid\")");
+        }
+
+        /// window_mode lists the strategies used to cut the stream into frames.
+        enum class window_mode {
+            /// duration creates a frame every window µs, windows are aligned on the first event.
+            duration,
+
+            /// count creates a frame every window events.
+            count,
+        };
+
+        /// string_to_window_mode converts a window mode name.
+        inline window_mode string_to_window_mode(const std::string& value) {
+            if (value == "duration") {
+                return window_mode::duration;
+            }
+            if (value == "count") {
+                return window_mode::count;
+            }
+            throw std::runtime_error("unknown window mode \"" + value + "\" (expected \"duration\" or \"count\")");
+        }
+
+        /// exp_negative approximates exp(x) for x <= 0 and returns 0 below -87.
+        /// The function has no branches nor calls, and the clamp is an integer operation on the float bits (negative
+        /// floats sort like their unsigned representation), so that loops over pixels are vectorized by the compiler
+        /// even without -ffast-math (the relative error is smaller than 2e-5).
+        inline float exp_negative(float x) {
+            uint32_t x_bits;
+            std::memcpy(&x_bits, &x, sizeof(x_bits));
+            x_bits = std::min(x_bits, 0xc2b00000u); // -88.0f
+            float clamped;
+            std::memcpy(&clamped, &x_bits, sizeof(clamped));
+            const auto shifted = clamped * 1.4426950409f + 128.0f;
+            const auto integer = static_cast<int32_t>(shifted);
+            const auto fraction = shifted - static_cast<float>(integer);
+            const auto power = 1.0f
+                               + fraction
+                                     * (0.6931471806f
+                                        + fraction
+                                              * (0.2402265070f
+                                                 + fraction
+                                                       * (0.0555041087f
+                                                          + fraction
+                                                                * (0.0096181291f
+                                                                   + fraction
+                                                                         * (0.0013333558f
+                                                                            + fraction * 0.0001540353f)))));
+            const auto mask = static_cast<uint32_t>(-static_cast<int32_t>(integer > 1));
+            const auto bits = (static_cast<uint32_t>(integer - 1) << 23) & mask;
+            float scale;
+            std::memcpy(&scale, &bits, sizeof(scale));
+            return power * scale;
+        }
+
+        /// thread_pool runs indexed tasks on persistent threads.
+        /// The calling thread participates, so a pool with zero workers runs tasks sequentially.
+        class thread_pool {
+            public:
+            thread_pool(std::size_t workers) : _running(true), _generation(0) {
+                for (std::size_t index = 0; index < workers; ++index) {
+                    _workers.emplace_back([this]() {
+                        uint64_t generation = 0;
+                        for (;;) {
+                            std::shared_ptr<job> current;
+                            {
+                                std::unique_lock<std::mutex> lock(_mutex);
+                                _job_ready.wait(lock, [&]() { return !_running || _generation != generation; });
+                                if (!_running) {
+                                    return;
+                                }
+                                generation = _generation;
+                                current = _job;
+                            }
+                            if (!current) {
+                                continue;
+                            }
+                            const auto completed = work(*current);
+                            if (completed > 0) {
+                                std::lock_guard<std::mutex> lock(_mutex);
+                                current->done += completed;
+                                if (current->done == current->tasks) {
+                                    _job_done.notify_all();
+                                }
+                            }
+                        }
+                    });
+                }
+            }
+            thread_pool(const thread_pool&) = delete;
+            thread_pool(thread_pool&&) = delete;
+            thread_pool& operator=(const thread_pool&) = delete;
+            thread_pool& operator=(thread_pool&&) = delete;
+            virtual ~thread_pool() {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _running = false;
+                }
+                _job_ready.notify_all();
+                for (auto& worker : _workers) {
+                    worker.join();
+                }
+            }
+
+            /// size returns the number of threads, including the caller.
+            std::size_t size() const {
+                return _workers.size() + 1;
+            }
+
+            /// run calls task(index) for every index in [0, tasks) and returns once all the calls are complete.
+            /// Each call creates a job that owns its task and index counter. A worker that picks up a job after run
+            /// returned finds its counter exhausted, and never touches the next job.
+            void run(std::size_t tasks, std::function<void(std::size_t)> task) {
+                if (tasks == 0) {
+                    return;
+                }
+                auto current = std::make_shared<job>(std::move(task), tasks);
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _job = current;
+                    ++_generation;
+                }
+                _job_ready.notify_all();
+                const auto completed = work(*current);
+                std::unique_lock<std::mutex> lock(_mutex);
+                current->done += completed;
+                _job_done.wait(lock, [&]() { return current->done == current->tasks; });
+                _job.reset();
+            }
+
+            protected:
+            /// job is a batch of indexed tasks.
+            struct job {
+                job(std::function<void(std::size_t)> task, std::size_t tasks) :
+                    task(std::move(task)), tasks(tasks), next(0), done(0) {}
+
+                const std::function<void(std::size_t)> task;
+                const std::size_t tasks;
+                std::atomic<std::size_t> next;
+                std::size_t done;
+            };
+
+            /// work runs the job's tasks until none is left, and returns the number of tasks it completed.
+            static std::size_t work(job& current) {
+                std::size_t completed = 0;
+                for (;;) {
+                    const auto index = current.next.fetch_add(1, std::memory_order_relaxed);
+                    if (index >= current.tasks) {
+                        break;
+                    }
+                    current.task(index);
+                    ++completed;
+                }
+                return completed;
+            }
+
+            std::vector<std::thread> _workers;
+            std::mutex _mutex;
+            std::condition_variable _job_ready;
+            std::condition_variable _job_done;
+            bool _running;
+            uint64_t _generation;
+            std::shared_ptr<job> _job;
+        };
+
+        /// accumulator converts a stream of DVS events into frames.
+        /// Events are buffered until a window is complete, then sorted into bands of rows (tiles) processed in
+        /// parallel by a thread pool. Tiles never share pixels, hence workers write frames without synchronisation.
+        /// The frame buffer is allocated once and handed to the frame handler by reference: it is valid until the
+        /// handler returns.
+        /// Frames have the shape [channels, height, width] (row-major, float32).
+        template <typename Event>
+        class accumulator {
+            public:
+            accumulator(
+                uint16_t width,
+                uint16_t height,
+                representation frame_representation,
+                window_mode mode,
+                uint64_t window,
+                float tau,
+                std::size_t bins,
+                std::size_t threads) :
+                _width(width),
+                _height(height),
+                _representation(frame_representation),
+                _mode(mode),
+                _window(window),
+                _inverse_tau(tau > 0.0f ? 1.0f / tau : 0.0f),
+                _channels(frame_representation == representation::voxel_grid ? bins : 2),
+                _pool(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) - 1 : threads - 1),
+                _tiles(std::max(std::min(static_cast<std::size_t>(height), _pool.size() * 4), std::size_t(1))),
+                _tile_height((height + _tiles - 1) / _tiles),
+                _frame(_channels * width * height, 0.0f),
+                _window_begin_t(0),
+                _started(false) {
+                if (width == 0 || height == 0) {
+                    throw std::logic_error("the accumulator width and height must be larger than zero");
+                }
+                if (window == 0) {
+                    throw std::logic_error("the accumulator window must be larger than zero");
+                }
+                if (frame_representation == representation::time_surface && tau <= 0.0f) {
+                    throw std::logic_error("the time surface decay must be larger than zero");
+                }
+                if (frame_representation == representation::voxel_grid && bins == 0) {
+                    throw std::logic_error("the voxel grid must have at least one bin");
+                }
+                if (frame_representation == representation::time_surface) {
+                    _last_ts.resize(2 * static_cast<std::size_t>(width) * height, never_t);
+                }
+                _tile_offsets.resize(_tiles + 1, 0);
+            }
+            accumulator(const accumulator&) = delete;
+            accumulator(accumulator&&) = delete;
+            accumulator& operator=(const accumulator&) = delete;
+            accumulator& operator=(accumulator&&) = delete;
+            virtual ~accumulator() {}
+
+            /// channels returns the number of frame channels.
+            std::size_t channels() const {
+                return _channels;
+            }
+
+            /// width returns the frame width.
+            uint16_t width() const {
+                return _width;
+            }
+
+            /// height returns the frame height.
+            uint16_t height() const {
+                return _height;
+            }
+
+            /// push adds events and calls handle_frame(begin_t, end_t, frame) for every completed window.
+            /// Events must be sorted by timestamp. In duration mode, windows without events generate frames as well.
+            template <typename Iterator, typename HandleFrame>
+            void push(Iterator begin, Iterator end, HandleFrame handle_frame) {
+                for (; begin != end; ++begin) {
+                    const Event event = *begin;
+                    if (!_started) {
+                        _started = true;
+                        _window_begin_t = event.t;
+                    }
+                    if (_mode == window_mode::duration) {
+                        while (event.t >= _window_begin_t + _window) {
+                            complete(_window_begin_t + _window, handle_frame);
+                            _window_begin_t += _window;
+                        }
+                        _events.push_back(event);
+                    } else {
+                        _events.push_back(event);
+                        if (_events.size() == _window) {
+                            complete(event.t, handle_frame);
+                            _window_begin_t = event.t;
+                        }
+                    }
+                }
+            }
+
+            /// flush generates a frame with the events of the current window, if any.
+            template <typename HandleFrame>
+            void flush(HandleFrame handle_frame) {
+                if (!_events.empty()) {
+                    const auto end_t = _mode == window_mode::duration ? _window_begin_t + _window : _events.back().t;
+                    complete(end_t, handle_frame);
+                    _window_begin_t = end_t;
+                }
+            }
+
+            protected:
+            /// never_t is the timestamp of pixels without events, far enough in the past to decay to zero but small
+            /// enough to be represented by a float once subtracted from a timestamp.
+            static constexpr double never_t = -1e30;
+
+            /// complete computes the frame of the buffered events and calls the handler.
+            template <typename HandleFrame>
+            void complete(uint64_t end_t, HandleFrame& handle_frame) {
+                const auto begin_t = _mode == window_mode::duration || _events.empty() ? _window_begin_t :
+                                                                                         _events.front().t;
+                sort_by_tile();
+                _pool.run(_tiles, [&](std::size_t tile) { accumulate_tile(tile, begin_t, end_t); });
+                handle_frame(begin_t, end_t, static_cast<const std::vector<float>&>(_frame));
+                _events.clear();
+            }
+
+            /// sort_by_tile groups the buffered events by tile (counting sort, stable).
+            void sort_by_tile() {
+                std::fill(_tile_offsets.begin(), _tile_offsets.end(), 0);
+                for (const auto& event : _events) {
+                    ++_tile_offsets[event.y / _tile_height + 1];
+                }
+                for (std::size_t tile = 0; tile < _tiles; ++tile) {
+                    _tile_offsets[tile + 1] += _tile_offsets[tile];
+                }
+                _tile_cursors.assign(_tile_offsets.begin(), std::prev(_tile_offsets.end()));
+                _sorted_events.resize(_events.size());
+                for (const auto& event : _events) {
+                    _sorted_events[_tile_cursors[event.y / _tile_height]++] = event;
+                }
+            }
+
+            /// accumulate_tile updates the frame rows of a tile.
+            void accumulate_tile(std::size_t tile, uint64_t begin_t, uint64_t end_t) {
+                const auto pixels = static_cast<std::size_t>(_width) * _height;
+                const auto first_row = tile * _tile_height;
+                const auto last_row = std::min(first_row + _tile_height, static_cast<std::size_t>(_height));
+                if (first_row >= last_row) {
+                    return;
+                }
+                const auto first_pixel = first_row * _width;
+                const auto tile_pixels = (last_row - first_row) * _width;
+                const auto events_begin = std::next(_sorted_events.begin(), _tile_offsets[tile]);
+                const auto events_end = std::next(_sorted_events.begin(), _tile_offsets[tile + 1]);
+                switch (_representation) {
+                    case representation::histogram: {
+                        for (std::size_t channel = 0; channel < _channels; ++channel) {
+                            std::fill_n(std::next(_frame.begin(), channel * pixels + first_pixel), tile_pixels, 0.0f);
+                        }
+                        for (auto event = events_begin; event != events_end; ++event) {
+                            _frame
+                                [(event->on ? pixels : 0) + static_cast<std::size_t>(event->x)
+                                 + static_cast<std::size_t>(event->y) * _width] += 1.0f;
+                        }
+                        break;
+                    }
+                    case representation::time_surface: {
+                        for (auto event = events_begin; event != events_end; ++event) {
+                            _last_ts
+                                [(event->on ? pixels : 0) + static_cast<std::size_t>(event->x)
+                                 + static_cast<std::size_t>(event->y) * _width] = static_cast<double>(event->t);
+                        }
+                        const auto reference_t = static_cast<double>(end_t);
+                        for (std::size_t channel = 0; channel < _channels; ++channel) {
+                            const auto last_ts = _last_ts.data() + channel * pixels + first_pixel;
+                            const auto values = _frame.data() + channel * pixels + first_pixel;
+                            for (std::size_t index = 0; index < tile_pixels; ++index) {
+                                values[index] =
+                                    exp_negative(static_cast<float>(last_ts[index] - reference_t) * _inverse_tau);
+                            }
+                        }
+                        break;
+                    }
+                    case representation::voxel_grid: {
+                        for (std::size_t channel = 0; channel < _channels; ++channel) {
+                            std::fill_n(std::next(_frame.begin(), channel * pixels + first_pixel), tile_pixels, 0.0f);
+                        }
+                        const auto scale = end_t > begin_t ? static_cast<double>(_channels - 1)
+                                                                 / static_cast<double>(end_t - begin_t) :
+                                                             0.0;
+                        for (auto event = events_begin; event != events_end; ++event) {
+                            const auto position = std::min(
+                                static_cast<double>(event->t - begin_t) * scale, static_cast<double>(_channels - 1));
+                            const auto bin = static_cast<std::size_t>(position);
+                            const auto weight = static_cast<float>(position - static_cast<double>(bin));
+                            const auto polarity = event->on ? 1.0f : -1.0f;
+                            const auto index =
+                                static_cast<std::size_t>(event->x) + static_cast<std::size_t>(event->y) * _width;
+                            _frame[bin * pixels + index] += polarity * (1.0f - weight);
+                            if (bin + 1 < _channels) {
+                                _frame[(bin + 1) * pixels + index] += polarity * weight;
+                            }
+                        }
+                        break;
+                    }
+                }
+            }
+
+            const uint16_t _width;
+            const uint16_t _height;
+            const representation _representation;
+            const window_mode _mode;
+            const uint64_t _window;
+            const float _inverse_tau;
+            const std::size_t _channels;
+            thread_pool _pool;
+            const std::size_t _tiles;
+            const std::size_t _tile_height;
+            std::vector<float> _frame;
+            std::vector<double> _last_ts;
+            std::vector<Event> _events;
+            std::vector<Event> _sorted_events;
+            std::vector<std::size_t> _tile_offsets;
+            std::vector<std::size_t> _tile_cursors;
+            uint64_t _window_begin_t;
+            bool _started;
+        };
+    }
+}
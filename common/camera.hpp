@@ -17,6 +17,16 @@ namespace sepia {
                 .count());
     }
 
+    /// transfer_statistics summarises the USB transfers received by a camera.
+    /// Counters are cumulative since the camera was created.
+    struct transfer_statistics {
+        uint64_t transfers;
+        uint64_t bytes;
+        uint64_t drops;
+        std::size_t used;
+        std::size_t size;
+    };
+
     /// camera is a common base type for buffered cameras.
     class camera {
         public:
@@ -26,6 +36,12 @@ namespace sepia {
         camera& operator=(const camera&) = default;
         camera& operator=(camera&& other) = default;
         virtual ~camera() {}
+
+        /// get_transfer_statistics returns the USB transfers counters.
+        /// It can be called from any thread.
+        virtual transfer_statistics get_transfer_statistics() const {
+            return {0, 0, 0, 0, 0};
+        }
     };
 
     /// parametric_camera adds parameters update support to camera.
@@ -67,7 +83,7 @@ namespace sepia {
     class fifo {
         public:
         fifo(const std::chrono::steady_clock::duration& timeout, std::size_t fifo_size, std::function<void()> handle_drop) :
-            _timeout(timeout), _handle_drop(std::move(handle_drop)) {
+            _timeout(timeout), _handle_drop(std::move(handle_drop)), _transfers(0), _bytes(0), _drops(0), _used(0) {
             _buffers.resize(fifo_size);
         }
         fifo(const fifo&) = delete;
@@ -93,7 +109,7 @@ namespace sepia {
             buffer.swap(_buffers[_read_index]);
             _read_index = (_read_index + 1) % _buffers.size();
             return pop_result{
-                (_write_index + _buffers.size() - _read_index) % _buffers.size(),
+                store_used(),
                 _buffers.size(),
                 true,
             };
@@ -104,12 +120,16 @@ namespace sepia {
             {
                 std::lock_guard<std::mutex> lock(_mutex);
                 const auto next_write_index = (_write_index + 1) % _buffers.size();
+                increment(_transfers, 1);
+                increment(_bytes, buffer.size());
                 if (_read_index == next_write_index) {
+                    increment(_drops, 1);
                     _handle_drop();
                 } else {
                     buffer.swap(_buffers[_write_index]);
                     _write_index = next_write_index;
                 }
+                store_used();
             }
             _condition_variable.notify_one();
         }
@@ -121,7 +141,10 @@ namespace sepia {
             {
                 std::lock_guard<std::mutex> lock(_mutex);
                 const auto next_write_index = (_write_index + 1) % _buffers.size();
+                increment(_transfers, 1);
+                increment(_bytes, static_cast<uint64_t>(std::distance(first, last)));
                 if (_read_index == next_write_index) {
+                    increment(_drops, 1);
                     _handle_drop();
                 } else {
                     const auto data_size = static_cast<std::size_t>(std::distance(first, last));
@@ -133,13 +156,44 @@ namespace sepia {
                         _buffers[_write_index].data() + data_size);
                     _write_index = next_write_index;
                 }
+                store_used();
             }
             _condition_variable.notify_one();
         }
 
+        /// statistics returns the counters updated by push and copy_and_push, and the occupancy after the last
+        /// push, copy_and_push, or pop.
+        /// It does not lock the FIFO and can be called from any thread.
+        virtual transfer_statistics statistics() const {
+            return {
+                _transfers.load(std::memory_order_relaxed),
+                _bytes.load(std::memory_order_relaxed),
+                _drops.load(std::memory_order_relaxed),
+                _used.load(std::memory_order_relaxed),
+                _buffers.size(),
+            };
+        }
+
         protected:
+        /// increment adds a value to a counter written by the producer thread only.
+        /// A relaxed load and store avoids the cost of an atomic read-modify-write on the USB thread.
+        static void increment(std::atomic<uint64_t>& counter, uint64_t value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        /// store_used publishes and returns the number of buffers in the FIFO. It must be called with _mutex locked.
+        std::size_t store_used() {
+            const auto used = (_write_index + _buffers.size() - _read_index) % _buffers.size();
+            _used.store(used, std::memory_order_relaxed);
+            return used;
+        }
+
         const std::chrono::steady_clock::duration& _timeout;
         std::function<void()> _handle_drop;
+        std::atomic<uint64_t> _transfers;
+        std::atomic<uint64_t> _bytes;
+        std::atomic<uint64_t> _drops;
+        std::atomic<std::size_t> _used;
         std::vector<std::vector<uint8_t>> _buffers;
         std::mutex _mutex;
         std::condition_variable _condition_variable;
@@ -186,6 +240,11 @@ namespace sepia {
             _buffer_loop.join();
         }
 
+        /// get_transfer_statistics returns the USB transfers counters.
+        virtual transfer_statistics get_transfer_statistics() const override {
+            return _fifo.statistics();
+        }
+
         protected:
         /// push inserts a buffer.
         virtual void push(std::vector<uint8_t>& buffer) {
@@ -0,0 +1,312 @@
+#pragma once
+
+#include "sepia.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace sepia {
+    namespace es {
+        /// index_entry associates a byte offset in a DVS event stream with the timestamp of the previous event.
+        /// The decoder can start at offset (its state is idle there) with t as the current timestamp.
+        struct index_entry {
+            uint64_t t;
+            uint64_t offset;
+        };
+
+        /// index_signature starts index files.
+        inline const std::string& index_signature() {
+            static const std::string signature("ESINDEX1");
+            return signature;
+        }
+
+        /// index_filename returns the path of the index associated with an event stream.
+        inline std::string index_filename(const std::string& filename) {
+            return filename + ".index";
+        }
+
+        /// write_uint64 writes an integer in little endian order.
+        inline void write_uint64(std::ostream& stream, uint64_t value) {
+            std::array<uint8_t, 8> bytes;
+            for (std::size_t index = 0; index < bytes.size(); ++index) {
+                bytes[index] = static_cast<uint8_t>((value >> (8 * index)) & 0xff);
+            }
+            stream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        }
+
+        /// read_uint64 reads an integer in little endian order, and returns false at the end of the stream.
+        inline bool read_uint64(std::istream& stream, uint64_t& value) {
+            std::array<uint8_t, 8> bytes;
+            stream.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+            if (stream.gcount() != static_cast<std::streamsize>(bytes.size())) {
+                return false;
+            }
+            value = 0;
+            for (std::size_t index = 0; index < bytes.size(); ++index) {
+                value |= (static_cast<uint64_t>(bytes[index]) << (8 * index));
+            }
+            return true;
+        }
+
+        /// write_index decodes a DVS event stream and writes an index entry every period µs.
+        /// The index stores the size of the stream, so that read_index can ignore stale indexes.
+        inline void write_index(const std::string& filename, uint64_t period, std::size_t chunk_size = 1 << 20) {
+            if (period == 0) {
+                throw std::runtime_error("the index period must be larger than zero");
+            }
+            auto event_stream = filename_to_ifstream(filename);
+            const auto header = read_header(*event_stream);
+            if (header.event_stream_type != type::dvs) {
+                throw unsupported_event_type();
+            }
+            auto offset = static_cast<uint64_t>(event_stream->tellg());
+            std::vector<index_entry> entries{{0, offset}};
+            handle_byte<type::dvs> handle_dvs_byte(header.width, header.height);
+            dvs_event event = {};
+            uint64_t next_entry_t = period;
+            std::vector<uint8_t> bytes(chunk_size);
+            for (;;) {
+                event_stream->read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+                const auto size = static_cast<std::size_t>(event_stream->gcount());
+                for (std::size_t index = 0; index < size; ++index) {
+                    if (handle_dvs_byte(bytes[index], event) && event.t >= next_entry_t) {
+                        entries.push_back({event.t, offset + index + 1});
+                        next_entry_t = event.t + period;
+                    }
+                }
+                offset += size;
+                if (size < bytes.size()) {
+                    break;
+                }
+            }
+            auto index_stream = filename_to_ofstream(index_filename(filename));
+            index_stream->write(index_signature().data(), index_signature().size());
+            write_uint64(*index_stream, offset);
+            for (const auto& entry : entries) {
+                write_uint64(*index_stream, entry.t);
+                write_uint64(*index_stream, entry.offset);
+            }
+        }
+
+        /// read_index loads the index associated with an event stream.
+        /// It returns an empty vector if the index does not exist or does not match the stream's size.
+        inline std::vector<index_entry> read_index(const std::string& filename) {
+            std::vector<index_entry> entries;
+            std::ifstream index_stream(index_filename(filename), std::ifstream::in | std::ifstream::binary);
+            if (!index_stream.good()) {
+                return entries;
+            }
+            std::string signature(index_signature().size(), '\0');
+            index_stream.read(&signature[0], signature.size());
+            uint64_t size = 0;
+            if (signature != index_signature() || !read_uint64(index_stream, size)
+                || size != static_cast<uint64_t>(std::filesystem::file_size(filename))) {
+                return entries;
+            }
+            index_entry entry;
+            while (read_uint64(index_stream, entry.t) && read_uint64(index_stream, entry.offset)) {
+                entries.push_back(entry);
+            }
+            return entries;
+        }
+
+        /// reader decodes a DVS event stream on a background thread and cuts it into chunks of chunk_events events or
+        /// chunk_duration µs (windows are aligned on begin_t, empty windows are skipped). Only events in the range
+        /// [begin_t, end_t) are returned. If the stream has an index, the thread starts at the last entry before
+        /// begin_t.
+        /// MakeChunk must return an empty Chunk, and PushEvent(Chunk&, dvs_event) must append an event to a chunk.
+        /// Chunk must have a size() method. At most prefetch chunks are decoded ahead of the consumer.
+        template <typename Chunk, typename MakeChunk, typename PushEvent>
+        class reader {
+            public:
+            reader(
+                const std::string& filename,
+                MakeChunk&& make_chunk,
+                PushEvent&& push_event,
+                std::size_t chunk_events,
+                uint64_t chunk_duration,
+                uint64_t begin_t,
+                uint64_t end_t,
+                std::size_t prefetch,
+                std::size_t chunk_size = 1 << 20) :
+                _make_chunk(std::forward<MakeChunk>(make_chunk)),
+                _push_event(std::forward<PushEvent>(push_event)),
+                _chunk_events(chunk_events),
+                _chunk_duration(chunk_duration),
+                _begin_t(begin_t),
+                _end_t(end_t),
+                _prefetch(std::max(prefetch, static_cast<std::size_t>(1))),
+                _running(true),
+                _done(false) {
+                if ((_chunk_events == 0) == (_chunk_duration == 0)) {
+                    throw std::runtime_error("exactly one of chunk_events and chunk_duration must be larger than zero");
+                }
+                auto event_stream = filename_to_ifstream(filename);
+                _header = read_header(*event_stream);
+                if (_header.event_stream_type != type::dvs) {
+                    throw unsupported_event_type();
+                }
+                dvs_event event = {};
+                if (_begin_t > 0) {
+                    const auto entries = read_index(filename);
+                    const auto entry = std::upper_bound(
+                        entries.begin(), entries.end(), _begin_t, [](uint64_t t, const index_entry& entry) {
+                            return t < entry.t;
+                        });
+                    if (entry != entries.begin()) {
+                        event.t = std::prev(entry)->t;
+                        event_stream->seekg(static_cast<std::streamoff>(std::prev(entry)->offset));
+                    }
+                }
+                _loop = std::thread([this, event, chunk_size, event_stream = std::move(event_stream)]() mutable {
+                    try {
+                        decode(*event_stream, event, chunk_size);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _exception = std::current_exception();
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _done = true;
+                    }
+                    _chunk_ready.notify_all();
+                });
+            }
+            reader(const reader&) = delete;
+            reader(reader&&) = delete;
+            reader& operator=(const reader&) = delete;
+            reader& operator=(reader&&) = delete;
+            virtual ~reader() {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _running = false;
+                }
+                _space_available.notify_all();
+                _loop.join();
+            }
+
+            /// header returns the stream's header.
+            const sepia::header& header() const {
+                return _header;
+            }
+
+            /// next blocks until a chunk is available and moves it to chunk.
+            /// It returns false once all the chunks have been read, and rethrows the decoding thread's exceptions.
+            bool next(Chunk& chunk) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _chunk_ready.wait(lock, [&]() { return !_chunks.empty() || _done; });
+                if (_chunks.empty()) {
+                    if (_exception) {
+                        std::rethrow_exception(_exception);
+                    }
+                    return false;
+                }
+                chunk = std::move(_chunks.front());
+                _chunks.pop_front();
+                lock.unlock();
+                _space_available.notify_all();
+                return true;
+            }
+
+            protected:
+            /// decode runs on the background thread.
+            void decode(std::istream& event_stream, dvs_event event, std::size_t chunk_size) {
+                handle_byte<type::dvs> handle_dvs_byte(_header.width, _header.height);
+                std::vector<uint8_t> bytes(chunk_size);
+                auto chunk = _make_chunk();
+                auto window_end = _chunk_duration > 0 ? _begin_t + _chunk_duration : 0;
+                for (;;) {
+                    event_stream.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+                    const auto size = static_cast<std::size_t>(event_stream.gcount());
+                    for (std::size_t index = 0; index < size; ++index) {
+                        if (handle_dvs_byte(bytes[index], event)) {
+                            if (event.t < _begin_t) {
+                                continue;
+                            }
+                            if (event.t >= _end_t) {
+                                publish(chunk);
+                                return;
+                            }
+                            if (_chunk_duration > 0 && event.t >= window_end) {
+                                if (!publish(chunk)) {
+                                    return;
+                                }
+                                window_end += ((event.t - window_end) / _chunk_duration + 1) * _chunk_duration;
+                            }
+                            _push_event(chunk, event);
+                            if (_chunk_events > 0 && chunk.size() == _chunk_events && !publish(chunk)) {
+                                return;
+                            }
+                        }
+                    }
+                    if (size < bytes.size()) {
+                        publish(chunk);
+                        return;
+                    }
+                }
+            }
+
+            /// publish waits for space in the prefetch queue and moves a non-empty chunk to it.
+            /// It returns false if the reader is being destroyed.
+            bool publish(Chunk& chunk) {
+                if (chunk.size() == 0) {
+                    return true;
+                }
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _space_available.wait(lock, [&]() { return !_running || _chunks.size() < _prefetch; });
+                    if (!_running) {
+                        return false;
+                    }
+                    _chunks.push_back(std::move(chunk));
+                }
+                _chunk_ready.notify_all();
+                chunk = _make_chunk();
+                return true;
+            }
+
+            MakeChunk _make_chunk;
+            PushEvent _push_event;
+            const std::size_t _chunk_events;
+            const uint64_t _chunk_duration;
+            const uint64_t _begin_t;
+            const uint64_t _end_t;
+            const std::size_t _prefetch;
+            sepia::header _header;
+            std::mutex _mutex;
+            std::condition_variable _chunk_ready;
+            std::condition_variable _space_available;
+            std::deque<Chunk> _chunks;
+            bool _running;
+            bool _done;
+            std::exception_ptr _exception;
+            std::thread _loop;
+        };
+
+        /// make_reader creates a reader from functors.
+        template <typename Chunk, typename MakeChunk, typename PushEvent>
+        inline std::unique_ptr<reader<Chunk, MakeChunk, PushEvent>> make_reader(
+            const std::string& filename,
+            MakeChunk&& make_chunk,
+            PushEvent&& push_event,
+            std::size_t chunk_events,
+            uint64_t chunk_duration,
+            uint64_t begin_t = 0,
+            uint64_t end_t = std::numeric_limits<uint64_t>::max(),
+            std::size_t prefetch = 4) {
+            return sepia::make_unique<reader<Chunk, MakeChunk, PushEvent>>(
+                filename,
+                std::forward<MakeChunk>(make_chunk),
+                std::forward<PushEvent>(push_event),
+                chunk_events,
+                chunk_duration,
+                begin_t,
+                end_t,
+                prefetch);
+        }
+    }
+}
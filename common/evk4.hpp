@@ -123,12 +123,30 @@ namespace sepia {
             }
         };
 
+        /// event_rate_controller configures the sensor's event rate controller (ERC).
+        /// When enabled, the sensor drops events to output at most target_event_rate events every reference_period µs.
+        struct event_rate_controller {
+            bool enable;
+            uint32_t target_event_rate;
+            uint16_t reference_period;
+
+            bool operator==(const event_rate_controller& other) const {
+                return enable == other.enable && target_event_rate == other.target_event_rate
+                       && reference_period == other.reference_period;
+            }
+
+            bool operator!=(const event_rate_controller& other) const {
+                return !(*this == other);
+            }
+        };
+
         /// parameters lists the camera parameters.
         struct parameters {
             bias_currents biases;
             std::array<uint64_t, 20> x_mask;
             std::array<uint64_t, 12> y_mask;
             bool mask_intersection_only;
+            event_rate_controller erc;
         };
 
         /// default_parameters provides camera parameters tuned for standard use.
@@ -151,6 +169,11 @@ namespace sepia {
             {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
             {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
             false,
+            {
+                false, // enable
+                4000,  // target_event_rate (20 Mev/s)
+                200,   // reference_period
+            },
         };
 
         /// base_camera is a common base type for EVK4 cameras.
@@ -1385,6 +1408,14 @@ namespace sepia {
                     bias_unknown_2_address,
                     unknown_2,
                     bgen_buf_stg(1) | bgen_mux_en | bgen_buf_en | bgen_idac_en | bgen_single);
+                if (force || camera_parameters.erc != _previous_parameters.erc) {
+                    write_register(
+                        reference_period_address, mask_and_shift(0x3ff, 0, camera_parameters.erc.reference_period));
+                    write_register(
+                        td_target_event_rate_address,
+                        mask_and_shift(0x3fffff, 0, camera_parameters.erc.target_event_rate));
+                    write_register(t_dropping_control_address, camera_parameters.erc.enable ? 1u : 0u);
+                }
                 _previous_parameters = camera_parameters;
             }
 
@@ -1425,6 +1456,19 @@ namespace sepia {
             decode& operator=(decode&& other) = default;
             virtual ~decode() {}
 
+            /// state returns the decoder context.
+            virtual psee::decode_state state() const {
+                return {_previous_msb_t, _previous_lsb_t, _overflows, _event};
+            }
+
+            /// restore overwrites the decoder context.
+            virtual void restore(const psee::decode_state& state) {
+                _previous_msb_t = state.previous_msb_t;
+                _previous_lsb_t = state.previous_lsb_t;
+                _overflows = state.overflows;
+                _event = state.event;
+            }
+
             /// operator() decodes a buffer of bytes.
             virtual void operator()(const std::vector<uint8_t>& buffer, std::size_t used, std::size_t size) {
                 const auto dispatch = _before_buffer(used, size);
@@ -3,6 +3,7 @@
 #include <iomanip>
 #include <sstream>
 
+#include "sepia.hpp"
 #include "usb.hpp"
 
 namespace sepia {
@@ -11,6 +12,15 @@ namespace sepia {
         const uint32_t EVK3_HD = 1;
         const uint32_t EVK4 = 2;
 
+        /// decode_state is the context of an EVT 3 decoder between two buffers.
+        /// Restoring a saved state lets a second decoder replay buffers that the first one already consumed.
+        struct decode_state {
+            uint32_t previous_msb_t;
+            uint32_t previous_lsb_t;
+            uint32_t overflows;
+            sepia::dvs_event event;
+        };
+
         std::initializer_list<usb::identity> identities = {
             {0x04b4, 0x00f4},
             {0x04b4, 0x00f5},
@@ -1473,6 +1473,19 @@ namespace sepia {
             decode& operator=(decode&& other) = default;
             virtual ~decode() {}
 
+            /// state returns the decoder context.
+            virtual psee::decode_state state() const {
+                return {_previous_msb_t, _previous_lsb_t, _overflows, _event};
+            }
+
+            /// restore overwrites the decoder context.
+            virtual void restore(const psee::decode_state& state) {
+                _previous_msb_t = state.previous_msb_t;
+                _previous_lsb_t = state.previous_lsb_t;
+                _overflows = state.overflows;
+                _event = state.event;
+            }
+
             /// operator() decodes a buffer of bytes.
             virtual void operator()(const std::vector<uint8_t>& buffer, std::size_t used, std::size_t size) {
                 const auto dispatch = _before_buffer(used, size);
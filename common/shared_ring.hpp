@@ -0,0 +1,298 @@
+#pragma once
+
+#include "sepia.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sepia {
+    /// shared_ring shares a stream of DVS events between processes with POSIX shared memory.
+    /// A single writer copies batches of events in a ring, and any number of readers map it read-only and track their
+    /// own cursor. Readers never block the writer: a reader that falls more than capacity events behind loses the
+    /// oldest events.
+    namespace shared_ring {
+        /// ring_signature identifies rings ("SEPRING1" in little endian order).
+        constexpr uint64_t ring_signature = 0x31474e4952504553ull;
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared rings require lock-free 64-bit atomics");
+
+        /// header is stored at the beginning of the shared memory, and followed by capacity events.
+        /// sequence is a seqlock: it is odd while the writer copies a batch of pending events that ends at the
+        /// position written + pending, and even otherwise. written counts the events published since the ring's
+        /// creation. pending is only meaningful while sequence is odd, and written only changes at the end of a batch.
+        struct header {
+            uint64_t signature;
+            uint64_t capacity;
+            uint64_t event_size;
+            uint16_t width;
+            uint16_t height;
+            alignas(64) std::atomic<uint64_t> sequence;
+            std::atomic<uint64_t> written;
+            std::atomic<uint64_t> pending;
+        };
+
+        /// events_offset is the position of the first event in the shared memory.
+        constexpr std::size_t events_offset = ((sizeof(header) + 63) / 64) * 64;
+
+        /// normalize_name prepends a slash to names, as required by shm_open.
+        inline std::string normalize_name(const std::string& name) {
+            if (name.empty()) {
+                throw std::runtime_error("the shared ring name cannot be empty");
+            }
+            return name[0] == '/' ? name : "/" + name;
+        }
+
+        /// mapping owns a shared memory file descriptor and its mapping.
+        class mapping {
+            public:
+            mapping(int file_descriptor, std::size_t size, bool writable) :
+                _file_descriptor(file_descriptor), _size(size) {
+                _data = mmap(
+                    nullptr, _size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, _file_descriptor, 0);
+                if (_data == MAP_FAILED) {
+                    close(_file_descriptor);
+                    throw std::runtime_error("mapping the shared ring failed");
+                }
+            }
+            mapping(const mapping&) = delete;
+            mapping(mapping&&) = delete;
+            mapping& operator=(const mapping&) = delete;
+            mapping& operator=(mapping&&) = delete;
+            virtual ~mapping() {
+                munmap(_data, _size);
+                close(_file_descriptor);
+            }
+
+            /// ring_header returns the header at the beginning of the mapping.
+            header* ring_header() const {
+                return reinterpret_cast<header*>(_data);
+            }
+
+            /// events returns the ring's events.
+            dvs_event* events() const {
+                return reinterpret_cast<dvs_event*>(reinterpret_cast<uint8_t*>(_data) + events_offset);
+            }
+
+            protected:
+            const int _file_descriptor;
+            const std::size_t _size;
+            void* _data;
+        };
+
+        /// state is a consistent copy of the header's counters.
+        struct state {
+            uint64_t sequence;
+            uint64_t written;
+            uint64_t pending;
+
+            /// oldest returns the position of the oldest event that the writer has not started overwriting.
+            uint64_t oldest(uint64_t capacity) const {
+                const auto end = written + ((sequence & 1) == 1 ? pending : 0);
+                return end > capacity ? end - capacity : 0;
+            }
+        };
+
+        /// load_state reads the header's counters, retrying until the writer does not modify them during the read.
+        /// The writer publishes pending before the odd sequence, hence odd states are consistent too.
+        inline state load_state(const header& ring_header) {
+            for (;;) {
+                state result;
+                result.sequence = ring_header.sequence.load(std::memory_order_acquire);
+                result.written = ring_header.written.load(std::memory_order_relaxed);
+                result.pending = ring_header.pending.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (ring_header.sequence.load(std::memory_order_relaxed) == result.sequence) {
+                    return result;
+                }
+            }
+        }
+
+        /// writer creates a ring and publishes events.
+        /// An existing ring with the same name is replaced, and its readers stop receiving events.
+        /// capacity must be a power of two.
+        class writer {
+            public:
+            writer(const std::string& name, std::size_t capacity, uint16_t width, uint16_t height) :
+                _name(normalize_name(name)), _capacity(capacity) {
+                if (_capacity == 0 || (_capacity & (_capacity - 1)) != 0) {
+                    throw std::runtime_error("the shared ring capacity must be a power of two");
+                }
+                shm_unlink(_name.c_str());
+                const auto file_descriptor = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+                if (file_descriptor < 0) {
+                    throw std::runtime_error(std::string("creating the shared ring \"") + _name + "\" failed");
+                }
+                const auto size = events_offset + _capacity * sizeof(dvs_event);
+                if (ftruncate(file_descriptor, static_cast<off_t>(size)) < 0) {
+                    close(file_descriptor);
+                    shm_unlink(_name.c_str());
+                    throw std::runtime_error(std::string("resizing the shared ring \"") + _name + "\" failed");
+                }
+                try {
+                    _mapping = sepia::make_unique<mapping>(file_descriptor, size, true);
+                } catch (...) {
+                    shm_unlink(_name.c_str());
+                    throw;
+                }
+                auto ring_header = new (_mapping->ring_header()) header;
+                ring_header->capacity = _capacity;
+                ring_header->event_size = sizeof(dvs_event);
+                ring_header->width = width;
+                ring_header->height = height;
+                ring_header->sequence.store(0, std::memory_order_relaxed);
+                ring_header->written.store(0, std::memory_order_relaxed);
+                ring_header->pending.store(0, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                ring_header->signature = ring_signature;
+            }
+            writer(const writer&) = delete;
+            writer(writer&&) = delete;
+            writer& operator=(const writer&) = delete;
+            writer& operator=(writer&&) = delete;
+            virtual ~writer() {
+                _mapping.reset();
+                shm_unlink(_name.c_str());
+            }
+
+            /// write publishes a batch of events. Only the last capacity events are kept if the batch is larger.
+            void write(const dvs_event* events, std::size_t count) {
+                if (count == 0) {
+                    return;
+                }
+                auto ring_header = _mapping->ring_header();
+                const auto sequence = ring_header->sequence.load(std::memory_order_relaxed);
+                const auto written = ring_header->written.load(std::memory_order_relaxed);
+
+                // pending is ignored while sequence is even, and the release store publishes it with the odd sequence
+                ring_header->pending.store(count, std::memory_order_relaxed);
+                ring_header->sequence.store(sequence + 1, std::memory_order_release);
+                std::atomic_thread_fence(std::memory_order_release);
+
+                // skipped events are reported as lost, since they are older than oldest
+                auto position = written;
+                auto copy_count = count;
+                if (copy_count > _capacity) {
+                    position += copy_count - _capacity;
+                    events += copy_count - _capacity;
+                    copy_count = _capacity;
+                }
+                const auto begin = static_cast<std::size_t>(position & (_capacity - 1));
+                const auto first_count = std::min(copy_count, _capacity - begin);
+                std::memcpy(_mapping->events() + begin, events, first_count * sizeof(dvs_event));
+                std::memcpy(_mapping->events(), events + first_count, (copy_count - first_count) * sizeof(dvs_event));
+                ring_header->written.store(written + count, std::memory_order_relaxed);
+                ring_header->sequence.store(sequence + 2, std::memory_order_release);
+            }
+
+            protected:
+            const std::string _name;
+            const std::size_t _capacity;
+            std::unique_ptr<mapping> _mapping;
+        };
+
+        /// reader maps an existing ring read-only.
+        /// The cursor starts at the most recent event, or at the oldest event available if from_oldest is true.
+        class reader {
+            public:
+            reader(const std::string& name, bool from_oldest = false) : _lost(0) {
+                const auto normalized_name = normalize_name(name);
+                const auto file_descriptor = shm_open(normalized_name.c_str(), O_RDONLY, 0);
+                if (file_descriptor < 0) {
+                    throw std::runtime_error(std::string("the shared ring \"") + normalized_name + "\" does not exist");
+                }
+                struct stat status;
+                if (fstat(file_descriptor, &status) < 0 || static_cast<std::size_t>(status.st_size) < events_offset) {
+                    close(file_descriptor);
+                    throw std::runtime_error(std::string("the shared ring \"") + normalized_name + "\" is not ready");
+                }
+                _mapping =
+                    sepia::make_unique<mapping>(file_descriptor, static_cast<std::size_t>(status.st_size), false);
+                const auto ring_header = _mapping->ring_header();
+                if (ring_header->signature != ring_signature || ring_header->event_size != sizeof(dvs_event)
+                    || events_offset + ring_header->capacity * sizeof(dvs_event)
+                           > static_cast<std::size_t>(status.st_size)) {
+                    throw std::runtime_error(std::string("\"") + normalized_name + "\" is not a shared ring");
+                }
+                _capacity = ring_header->capacity;
+                const auto current = load_state(*ring_header);
+                _cursor = from_oldest ? current.oldest(_capacity) : current.written;
+            }
+            reader(const reader&) = delete;
+            reader(reader&&) = delete;
+            reader& operator=(const reader&) = delete;
+            reader& operator=(reader&&) = delete;
+            virtual ~reader() {}
+
+            /// width returns the sensor width.
+            uint16_t width() const {
+                return _mapping->ring_header()->width;
+            }
+
+            /// height returns the sensor height.
+            uint16_t height() const {
+                return _mapping->ring_header()->height;
+            }
+
+            /// lost returns the number of events overwritten by the writer before this reader could copy them.
+            uint64_t lost() const {
+                return _lost;
+            }
+
+            /// read appends the events published since the previous call to events, and returns the number of
+            /// appended events. It never waits for the writer.
+            std::size_t read(std::vector<dvs_event>& events) {
+                const auto ring_header = _mapping->ring_header();
+                const auto before = load_state(*ring_header);
+                skip_to(before.oldest(_capacity));
+                if (_cursor >= before.written) {
+                    return 0;
+                }
+                const auto first_index = events.size();
+                const auto count = static_cast<std::size_t>(before.written - _cursor);
+                events.resize(first_index + count);
+                const auto begin = static_cast<std::size_t>(_cursor & (_capacity - 1));
+                const auto first_count = std::min(count, static_cast<std::size_t>(_capacity) - begin);
+                std::memcpy(events.data() + first_index, _mapping->events() + begin, first_count * sizeof(dvs_event));
+                std::memcpy(
+                    events.data() + first_index + first_count,
+                    _mapping->events(),
+                    (count - first_count) * sizeof(dvs_event));
+
+                // events that the writer started overwriting during the copy form a prefix, since copies are sequential
+                // the state is reloaded even if the sequence did not change, since the writer may have been copying a
+                // batch (odd sequence) during the whole read
+                std::atomic_thread_fence(std::memory_order_acquire);
+                const auto begin_position = _cursor;
+                _cursor = before.written;
+                const auto oldest = load_state(*ring_header).oldest(_capacity);
+                if (oldest > begin_position) {
+                    const auto overwritten = static_cast<std::size_t>(std::min(oldest - begin_position, count));
+                    _lost += overwritten;
+                    events.erase(
+                        events.begin() + static_cast<std::ptrdiff_t>(first_index),
+                        events.begin() + static_cast<std::ptrdiff_t>(first_index + overwritten));
+                    return count - overwritten;
+                }
+                return count;
+            }
+
+            protected:
+            /// skip_to moves the cursor forward and counts the skipped events as lost.
+            void skip_to(uint64_t position) {
+                if (_cursor < position) {
+                    _lost += position - _cursor;
+                    _cursor = position;
+                }
+            }
+
+            std::unique_ptr<mapping> _mapping;
+            uint64_t _capacity;
+            uint64_t _cursor;
+            uint64_t _lost;
+        };
+    }
+}
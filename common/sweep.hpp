@@ -0,0 +1,233 @@
+#pragma once
+
+#include "camera.hpp"
+#include "sepia.hpp"
+
+namespace sepia {
+    /// sweep measures the event rate for a grid of bias values.
+    /// The decoding thread feeds a monitor, and a control thread applies each setting, waits for the biases to settle,
+    /// and collects the statistics of the following events.
+    namespace sweep {
+        /// axis lists the values of one bias.
+        struct axis {
+            std::string name;
+            std::vector<uint8_t> values;
+        };
+
+        /// grid returns the cartesian product of the axes applied to base (the last axis varies fastest).
+        /// Parameters must have a biases member with a by_name method.
+        template <typename Parameters>
+        inline std::vector<Parameters> grid(const Parameters& base, const std::vector<axis>& axes) {
+            std::vector<Parameters> result{base};
+            for (const auto& current_axis : axes) {
+                if (current_axis.values.empty()) {
+                    throw std::runtime_error(std::string("the axis \"") + current_axis.name + "\" has no values");
+                }
+                std::vector<Parameters> next;
+                next.reserve(result.size() * current_axis.values.size());
+                for (const auto& parameters : result) {
+                    for (const auto value : current_axis.values) {
+                        next.push_back(parameters);
+                        next.back().biases.by_name(current_axis.name) = value;
+                    }
+                }
+                result.swap(next);
+            }
+            return result;
+        }
+
+        /// statistics summarises the events of a measurement window.
+        /// Rates are in events per second, and hot pixels emit more than hot_pixel_rate events per second.
+        struct statistics {
+            uint64_t duration;
+            uint64_t on_events;
+            uint64_t off_events;
+            std::size_t buffers;
+            double event_rate;
+            double peak_buffer_rate;
+            double on_ratio;
+            std::size_t hot_pixels;
+            double hot_pixel_share;
+        };
+
+        /// monitor accumulates event statistics in the decoding thread.
+        /// push must be called for every event and end_buffer after every USB buffer, both by the decoding thread.
+        /// measure is called by another thread. The decoding thread starts and stops measurements at buffer
+        /// boundaries, therefore measure fails if the camera does not send buffers.
+        class monitor {
+            public:
+            monitor(uint16_t width, uint16_t height) :
+                _width(width),
+                _counts(static_cast<std::size_t>(width) * height, 0),
+                _recording(false),
+                _t(0),
+                _begin_t(0),
+                _buffer_begin_t(0),
+                _buffer_events(0),
+                _on_events(0),
+                _off_events(0),
+                _buffers(0),
+                _peak_buffer_rate(0.0),
+                _request(request::none),
+                _hot_pixel_rate(0.0) {}
+            monitor(const monitor&) = delete;
+            monitor(monitor&&) = delete;
+            monitor& operator=(const monitor&) = delete;
+            monitor& operator=(monitor&&) = delete;
+            virtual ~monitor() {}
+
+            /// push counts an event if a measurement is running.
+            void push(const dvs_event& event) {
+                _t = event.t;
+                if (_recording) {
+                    ++_counts[static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * _width];
+                    if (event.on) {
+                        ++_on_events;
+                    } else {
+                        ++_off_events;
+                    }
+                    ++_buffer_events;
+                }
+            }
+
+            /// end_buffer updates the per-buffer statistics, and starts or stops a measurement if requested.
+            void end_buffer() {
+                if (_recording) {
+                    ++_buffers;
+                    if (_t > _buffer_begin_t) {
+                        _peak_buffer_rate = std::max(
+                            _peak_buffer_rate,
+                            static_cast<double>(_buffer_events) * 1e6 / static_cast<double>(_t - _buffer_begin_t));
+                    }
+                    _buffer_events = 0;
+                    _buffer_begin_t = _t;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    switch (_request) {
+                        case request::none:
+                            return;
+                        case request::start:
+                            std::fill(_counts.begin(), _counts.end(), 0);
+                            _on_events = 0;
+                            _off_events = 0;
+                            _buffers = 0;
+                            _buffer_events = 0;
+                            _peak_buffer_rate = 0.0;
+                            _begin_t = _t;
+                            _buffer_begin_t = _t;
+                            _recording = true;
+                            break;
+                        case request::stop:
+                            _recording = false;
+                            _result = summarise();
+                            break;
+                    }
+                    _request = request::none;
+                }
+                _served.notify_all();
+            }
+
+            /// measure collects statistics during duration (starting with the next buffer).
+            /// It throws if the decoding thread does not handle a request before timeout.
+            statistics measure(
+                std::chrono::steady_clock::duration duration,
+                double hot_pixel_rate,
+                std::chrono::steady_clock::duration timeout = std::chrono::seconds(1)) {
+                send(request::start, hot_pixel_rate, timeout);
+                std::this_thread::sleep_for(duration);
+                send(request::stop, hot_pixel_rate, timeout);
+                std::lock_guard<std::mutex> lock(_mutex);
+                return _result;
+            }
+
+            protected:
+            /// request lists the commands sent to the decoding thread.
+            enum class request {
+                none,
+                start,
+                stop,
+            };
+
+            /// send waits until the decoding thread handles a request.
+            void send(request new_request, double hot_pixel_rate, std::chrono::steady_clock::duration timeout) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _request = new_request;
+                _hot_pixel_rate = hot_pixel_rate;
+                if (!_served.wait_for(lock, timeout, [this]() { return _request == request::none; })) {
+                    _request = request::none;
+                    throw std::runtime_error("the camera did not send buffers during the measurement");
+                }
+            }
+
+            /// summarise computes the statistics of the current measurement.
+            statistics summarise() const {
+                statistics result;
+                result.duration = _t - _begin_t;
+                result.on_events = _on_events;
+                result.off_events = _off_events;
+                result.buffers = _buffers;
+                const auto events = _on_events + _off_events;
+                result.event_rate = result.duration > 0 ?
+                                        static_cast<double>(events) * 1e6 / static_cast<double>(result.duration) :
+                                        0.0;
+                result.peak_buffer_rate = _peak_buffer_rate;
+                result.on_ratio = events > 0 ? static_cast<double>(_on_events) / static_cast<double>(events) : 0.0;
+                result.hot_pixels = 0;
+                uint64_t hot_events = 0;
+                const auto hot_count = _hot_pixel_rate * static_cast<double>(result.duration) / 1e6;
+                for (const auto count : _counts) {
+                    if (static_cast<double>(count) > hot_count) {
+                        ++result.hot_pixels;
+                        hot_events += count;
+                    }
+                }
+                result.hot_pixel_share =
+                    events > 0 ? static_cast<double>(hot_events) / static_cast<double>(events) : 0.0;
+                return result;
+            }
+
+            const uint16_t _width;
+            std::vector<uint32_t> _counts;
+            bool _recording;
+            uint64_t _t;
+            uint64_t _begin_t;
+            uint64_t _buffer_begin_t;
+            uint64_t _buffer_events;
+            uint64_t _on_events;
+            uint64_t _off_events;
+            std::size_t _buffers;
+            double _peak_buffer_rate;
+            std::mutex _mutex;
+            std::condition_variable _served;
+            request _request;
+            double _hot_pixel_rate;
+            statistics _result;
+        };
+
+        /// run applies every setting to the camera, waits settle, and measures the events during duration.
+        /// handle_row(index, statistics) is called after each measurement, and the sweep stops if it returns false.
+        /// The camera keeps the last setting.
+        template <typename Parameters, typename HandleRow>
+        inline std::vector<statistics> run(
+            parametric_camera<Parameters>& camera,
+            monitor& camera_monitor,
+            const std::vector<Parameters>& settings,
+            std::chrono::steady_clock::duration settle,
+            std::chrono::steady_clock::duration duration,
+            double hot_pixel_rate,
+            HandleRow&& handle_row) {
+            std::vector<statistics> rows;
+            rows.reserve(settings.size());
+            for (std::size_t index = 0; index < settings.size(); ++index) {
+                camera.update_parameters(settings[index]);
+                std::this_thread::sleep_for(settle);
+                rows.push_back(camera_monitor.measure(duration, hot_pixel_rate));
+                if (!handle_row(index, rows.back())) {
+                    break;
+                }
+            }
+            return rows;
+        }
+    }
+}
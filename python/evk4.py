@@ -2,7 +2,9 @@ import dataclasses
 import os
 import pathlib
 import evk4_extension
+import numpy
 import re
+import typing
 import dataclasses
 
 
@@ -23,9 +25,23 @@ class Biases:
     unknown_2: int = 0x51
 
 
+@dataclasses.dataclass
+class Erc:
+    """Configures the sensor's event rate controller.
+
+    When enabled, the sensor drops events to output at most target_event_rate
+    events every reference_period µs (the defaults correspond to 20 Mev/s).
+    """
+
+    enable: bool = False
+    target_event_rate: int = 4000
+    reference_period: int = 200
+
+
 @dataclasses.dataclass
 class Parameters:
     biases: Biases
+    erc: Erc = dataclasses.field(default_factory=Erc)
 
 
 @dataclasses.dataclass
@@ -35,22 +51,130 @@ class RecordingStatus:
     size: int = 0
 
 
+@dataclasses.dataclass
+class Dropped:
+    packets: int = 0
+    events: int = 0
+
+
+@dataclasses.dataclass
+class SweepRow:
+    biases: dict[str, int]  # swept biases only
+    duration: int  # µs
+    on_events: int
+    off_events: int
+    buffers: int
+    event_rate: float  # events/s
+    peak_buffer_rate: float  # events/s, maximum over USB buffers
+    on_ratio: float
+    hot_pixels: int
+    hot_pixel_share: float  # ratio of events emitted by hot pixels
+
+
+@dataclasses.dataclass
+class Snapshot:
+    t: int
+    count: typing.Optional[numpy.ndarray]
+    time_surface: typing.Optional[numpy.ndarray]
+    polarity: typing.Optional[numpy.ndarray]
+
+
+@dataclasses.dataclass
+class Frame:
+    begin_t: int
+    end_t: int
+    values: numpy.ndarray  # float32, shape (channels, height, width)
+
+
 recording_name_pattern = re.compile(r"^[-\w .]+$")
 
 
+Columns = evk4_extension.Columns
+
+
 class Camera(evk4_extension.Camera):
+    """Reads events from an EVK4.
+
+    By default, packets are structured arrays with the packed dtype
+    [("t", "<u8"), ("x", "<u2"), ("y", "<u2"), ("on", "?")]. With columns=True,
+    packets are Columns named tuples (t, x, y, on) of contiguous arrays instead.
+
+    backlog_limit bounds the number of events waiting to be read (0 means no limit,
+    each event uses 13 bytes). overflow decides what happens to packets that do not fit:
+    "drop_oldest", "drop_newest", or "block" (the decoder waits and the camera's FIFO
+    absorbs the backlog until it drops USB buffers). The drop policies do not affect
+    recordings, but "block" does: USB buffers dropped by a full FIFO are lost to the
+    recording as well.
+
+    frames lists the images updated by the decoding thread and returned by snapshot:
+    "count" (events per pixel, uint32), "time_surface" (exp((t_last - t) / tau) with the
+    timestamp t_last of each pixel's last event, float32), and "polarity" (+1 or -1 for
+    the last event of each pixel, 0 without events, float32). With packets=False, events
+    are not buffered at all and only frames (and recordings) are available.
+
+    shared_ring publishes the events in a POSIX shared memory ring with this name, which
+    other processes read with Subscriber. shared_ring_capacity (in events, a power of two,
+    13 bytes per event) bounds how far behind subscribers can fall before losing events.
+    """
+
     def __init__(
         self,
         recordings_path: pathlib.Path,
         log_path: pathlib.Path,
+        columns: bool = False,
+        backlog_limit: int = 0,
+        overflow: typing.Literal["drop_oldest", "drop_newest", "block"] = "drop_oldest",
+        frames: typing.Sequence[typing.Literal["count", "time_surface", "polarity"]] = (),
+        tau: float = 10000.0,
+        packets: bool = True,
+        shared_ring: typing.Optional[str] = None,
+        shared_ring_capacity: int = 1 << 22,
     ):
         recordings_path.mkdir(exist_ok=True, parents=True)
         log_path.parent.mkdir(exist_ok=True, parents=True)
-        super().__init__(recordings_path, log_path)
+        super().__init__(
+            recordings_path,
+            log_path,
+            columns,
+            backlog_limit,
+            overflow,
+            tuple(frames),
+            tau,
+            packets,
+            shared_ring,
+            shared_ring_capacity,
+        )
 
     def set_parameters(self, parameters: Parameters):
         super().set_parameters(dataclasses.asdict(parameters))
 
+    def sweep(
+        self,
+        axes: dict[str, typing.Sequence[int]],
+        base: Parameters,
+        settle: float = 0.5,
+        duration: float = 1.0,
+        hot_pixel_rate: float = 100.0,
+    ) -> list[SweepRow]:
+        """Measures the event rate for every combination of bias values.
+
+        Each setting is base with the biases listed in axes, applied for settle
+        seconds before measuring events during duration seconds. Hot pixels
+        emit more than hot_pixel_rate events per second. The camera returns
+        to base afterwards. Rows are in grid order (the last axis varies fastest).
+        """
+        try:
+            rows = super().sweep(
+                dataclasses.asdict(base),
+                [(name, list(values)) for name, values in axes.items()],
+                settle,
+                duration,
+                hot_pixel_rate,
+            )
+        finally:
+            self.set_parameters(base)
+        return [SweepRow(*row) for row in rows]
+
     def start_recording_to(self, name: str):
         name = name.strip()
         if recording_name_pattern.match(name) is None:
@@ -65,3 +189,113 @@ class Camera(evk4_extension.Camera):
     def recording_status(self):
         data = super().recording_status()
         return RecordingStatus(name=data[0], duration=data[1], size=data[2])
+
+    def dropped(self):
+        data = super().dropped()
+        return Dropped(packets=data[0], events=data[1])
+
+    def snapshot(self, reset: bool = True) -> Snapshot:
+        """Returns the frames (height x width arrays, None if disabled).
+
+        t is the timestamp of the last event. If reset is true, count and polarity
+        start over from zero. The time surface is never reset.
+        """
+        data = super().snapshot(reset)
+        return Snapshot(t=data[0], count=data[1], time_surface=data[2], polarity=data[3])
+
+
+class Reader(evk4_extension.Reader):
+    """Reads DVS events from an Event Stream file (.es) in chunks.
+
+    Exactly one of events (chunk size in events) and duration (chunk duration in µs,
+    empty windows are skipped) must be set. Only events in [begin, end) are returned.
+    A background thread decodes up to prefetch chunks ahead. If the file has an index
+    (see build_index), the reader jumps close to begin instead of decoding from the start.
+    Chunks have the same layout as camera packets (see Camera).
+    """
+
+    def __init__(
+        self,
+        path: typing.Union[str, os.PathLike],
+        events: typing.Optional[int] = None,
+        duration: typing.Optional[int] = None,
+        begin: int = 0,
+        end: typing.Optional[int] = None,
+        columns: bool = False,
+        prefetch: int = 4,
+    ):
+        if events is None and duration is None:
+            events = 1 << 20
+        super().__init__(
+            path,
+            0 if events is None else events,
+            0 if duration is None else duration,
+            begin,
+            (1 << 64) - 1 if end is None else end,
+            columns,
+            prefetch,
+        )
+        self.width, self.height = self.dimensions()
+
+    def __iter__(self):
+        return self
+
+    def __next__(self) -> typing.Union[numpy.ndarray, Columns]:
+        chunk = self.next_chunk()
+        if chunk is None:
+            raise StopIteration
+        return chunk
+
+
+class Subscriber(evk4_extension.Subscriber):
+    """Reads the events that a Camera in another process publishes with shared_ring.
+
+    Subscribers map the ring read-only and never slow down the camera. next_packet returns
+    the events published since the previous call (possibly none) and does not block.
+    By default, the first packet starts with the next published event. With from_oldest=True,
+    it starts with the oldest event still in the ring. lost() counts the events overwritten
+    before this subscriber could read them. Packets have the same layout as Camera packets.
+    """
+
+    def __init__(self, name: str, from_oldest: bool = False, columns: bool = False):
+        super().__init__(name, from_oldest, columns)
+        self.width, self.height = self.dimensions()
+
+
+def build_index(path: typing.Union[str, os.PathLike], period: int = 100000):
+    """Writes path.index, which lets Reader start close to a timestamp (one entry every period µs)."""
+    evk4_extension.build_index(path, period)
+
+
+class Accumulator(evk4_extension.Accumulator):
+    """Converts events into frames on a pool of native threads.
+
+    representation is "histogram" (channels: off, on), "time_surface" (channels: off, on, exp((t_last - end_t) / tau))
+    or "voxel_grid" (bins channels, polarities interpolated between the two nearest bins).
+    window_mode "duration" cuts a frame every window µs, "count" every window events.
+    threads=0 uses one thread per core.
+    push accepts the packets returned by next_packet, either structured arrays or Columns (columns=True).
+    """
+
+    def __init__(
+        self,
+        width: int = 1280,
+        height: int = 720,
+        representation: typing.Literal[
+            "histogram", "time_surface", "voxel_grid"
+        ] = "histogram",
+        window_mode: typing.Literal["duration", "count"] = "duration",
+        window: int = 10000,
+        tau: float = 10000.0,
+        bins: int = 5,
+        threads: int = 0,
+    ):
+        super().__init__(
+            width, height, representation, window_mode, window, tau, bins, threads
+        )
+
+    def push(self, events: typing.Union[numpy.ndarray, Columns]) -> list[Frame]:
+        return [Frame(*frame) for frame in super().push(events)]
+
+    def flush(self) -> list[Frame]:
+        return [Frame(*frame) for frame in super().flush()]
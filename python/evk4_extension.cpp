@@ -1,13 +1,23 @@
 #define NOMINMAX
 #include <Python.h>
+#include <array>
+#include <condition_variable>
 #include <cstring>
+#include <mutex>
+#include <optional>
 #include <sstream>
 #include <structmember.h>
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #if defined(HAVE_SSIZE_T)
 #define _SSIZE_T_DEFINED
 #endif
+#include "../common/accumulate.hpp"
+#include "../common/es_reader.hpp"
 #include "../common/evk4.hpp"
+#include "../common/sweep.hpp"
+#ifndef _WIN32
+#include "../common/shared_ring.hpp"
+#endif
 #include <filesystem>
 #include <numpy/arrayobject.h>
 
@@ -189,6 +199,282 @@ PyObject* events_to_array(const std::vector<sepia::color_event>& buffer, const s
     return reinterpret_cast<PyObject*>(events);
 }
 
+/// packed_dvs_event has the memory layout of the packed dtype returned by event_type_to_dtype<sepia::type::dvs>.
+/// The camera's decoding thread writes events in this format so that packets can be handed to numpy without copies.
+#pragma pack(push, 1)
+struct packed_dvs_event {
+    uint64_t t;
+    uint16_t x;
+    uint16_t y;
+    bool on;
+};
+#pragma pack(pop)
+static_assert(sizeof(packed_dvs_event) == 13, "packed_dvs_event must not have padding");
+static_assert(offsetof(packed_dvs_event, on) == 12, "packed_dvs_event must match the dvs dtype");
+
+/// packet stores the events decoded from one USB buffer.
+/// Events are either packed in the layout of the dvs dtype (events) or split into aligned columns (ts, xs, ys, ons).
+struct packet {
+    std::vector<packed_dvs_event> events;
+    std::vector<uint64_t> ts;
+    std::vector<uint16_t> xs;
+    std::vector<uint16_t> ys;
+    std::vector<uint8_t> ons;
+
+    /// size returns the number of events in the packet.
+    std::size_t size() const {
+        return events.size() + ts.size();
+    }
+
+    /// reserve_like allocates the capacity of another packet.
+    void reserve_like(const packet& other) {
+        events.reserve(other.events.capacity());
+        ts.reserve(other.ts.capacity());
+        xs.reserve(other.xs.capacity());
+        ys.reserve(other.ys.capacity());
+        ons.reserve(other.ons.capacity());
+    }
+
+    /// push appends an event in the packed layout or in the columns layout.
+    void push(sepia::dvs_event event, bool columns) {
+        if (columns) {
+            ts.push_back(event.t);
+            xs.push_back(event.x);
+            ys.push_back(event.y);
+            ons.push_back(event.on ? 1 : 0);
+        } else {
+            events.push_back({event.t, event.x, event.y, event.on});
+        }
+    }
+
+    /// clear removes the events and keeps the allocated memory.
+    void clear() {
+        events.clear();
+        ts.clear();
+        xs.clear();
+        ys.clear();
+        ons.clear();
+    }
+};
+
+/// packet_pool recycles the memory of packets, so that the decoding thread does not allocate for every USB buffer.
+/// Packets come back from the consumer (dropped or concatenated packets) and from numpy (packet capsules).
+class packet_pool {
+    public:
+    packet_pool(std::size_t capacity) : _capacity(capacity) {}
+    packet_pool(const packet_pool&) = delete;
+    packet_pool(packet_pool&&) = delete;
+    packet_pool& operator=(const packet_pool&) = delete;
+    packet_pool& operator=(packet_pool&&) = delete;
+    virtual ~packet_pool() {}
+
+    /// acquire returns an empty packet, with pre-allocated memory if one is available.
+    packet acquire() {
+        std::lock_guard<std::mutex> lock(_accessing_packets);
+        if (_packets.empty()) {
+            return packet();
+        }
+        auto result = std::move(_packets.back());
+        _packets.pop_back();
+        return result;
+    }
+
+    /// release stores the memory of a packet for later use (or frees it if the pool is full).
+    void release(packet&& events) {
+        events.clear();
+        std::lock_guard<std::mutex> lock(_accessing_packets);
+        if (_packets.size() < _capacity) {
+            _packets.push_back(std::move(events));
+        }
+    }
+
+    protected:
+    const std::size_t _capacity;
+    std::mutex _accessing_packets;
+    std::vector<packet> _packets;
+};
+
+/// overflow_policy decides what happens to new packets when the backlog is full.
+enum class overflow_policy {
+    drop_oldest,
+    drop_newest,
+    block,
+};
+
+/// string_to_overflow_policy parses an overflow policy name.
+static overflow_policy string_to_overflow_policy(const std::string& name) {
+    if (name == "drop_oldest") {
+        return overflow_policy::drop_oldest;
+    }
+    if (name == "drop_newest") {
+        return overflow_policy::drop_newest;
+    }
+    if (name == "block") {
+        return overflow_policy::block;
+    }
+    throw std::runtime_error("overflow must be \"drop_oldest\", \"drop_newest\", or \"block\"");
+}
+
+/// columns_type is a named tuple (t, x, y, on) of contiguous arrays.
+static PyTypeObject columns_type;
+static PyStructSequence_Field columns_fields[] = {
+    {"t", "timestamps in µs (uint64)"},
+    {"x", "horizontal coordinates (uint16)"},
+    {"y", "vertical coordinates (uint16)"},
+    {"on", "polarities (bool)"},
+    {nullptr, nullptr},
+};
+static PyStructSequence_Desc columns_description = {
+    "evk4_extension.Columns",
+    "DVS events stored as a structure of arrays",
+    columns_fields,
+    4,
+};
+
+/// packets_pool_capacity is the maximum number of packets kept for reuse by a camera.
+static constexpr std::size_t packets_pool_capacity = 64;
+
+/// signals_period bounds the time spent without the GIL by blocking waits, so that Python can handle signals.
+static constexpr std::chrono::milliseconds signals_period(100);
+
+/// packet_capsule_name identifies the capsules that own packets memory.
+static const char* packet_capsule_name = "evk4_extension.packet";
+
+/// packet_capsule_destructor returns the memory of a packet to its pool once numpy drops the last reference to its
+/// arrays. The capsule context holds a reference to the pool, which may outlive the camera.
+static void packet_capsule_destructor(PyObject* capsule) {
+    auto events = reinterpret_cast<packet*>(PyCapsule_GetPointer(capsule, packet_capsule_name));
+    auto pool = reinterpret_cast<std::shared_ptr<packet_pool>*>(PyCapsule_GetContext(capsule));
+    (*pool)->release(std::move(*events));
+    delete pool;
+    delete events;
+}
+
+/// wrap_array creates an array that points to memory owned by capsule.
+static PyObject* wrap_array(PyObject* capsule, PyArray_Descr* dtype, npy_intp size, void* data) {
+    auto array = PyArray_NewFromDescr(&PyArray_Type, dtype, 1, &size, nullptr, data, NPY_ARRAY_CARRAY, nullptr);
+    if (!array) {
+        return nullptr;
+    }
+    Py_INCREF(capsule);
+    if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(array), capsule) < 0) {
+        Py_DECREF(array);
+        return nullptr;
+    }
+    return array;
+}
+
+/// columns_to_tuple packs four column arrays in a Columns named tuple, and steals the arrays' references.
+static PyObject* columns_to_tuple(std::array<PyObject*, 4> arrays) {
+    auto columns = PyStructSequence_New(&columns_type);
+    if (!columns || !arrays[0] || !arrays[1] || !arrays[2] || !arrays[3]) {
+        for (auto array : arrays) {
+            Py_XDECREF(array);
+        }
+        Py_XDECREF(columns);
+        return nullptr;
+    }
+    for (Py_ssize_t index = 0; index < 4; ++index) {
+        PyStructSequence_SET_ITEM(columns, index, arrays[index]);
+    }
+    return columns;
+}
+
+/// packet_to_object wraps a packet in a numpy array (or in a Columns named tuple) without copying the events.
+/// The arrays own the packet through a capsule set as their base object.
+static PyObject* packet_to_object(packet&& events, bool columns, const std::shared_ptr<packet_pool>& pool) {
+    if (events.size() == 0) {
+        pool->release(std::move(events));
+        npy_intp size = 0;
+        if (columns) {
+            return columns_to_tuple({
+                PyArray_SimpleNew(1, &size, NPY_UINT64),
+                PyArray_SimpleNew(1, &size, NPY_UINT16),
+                PyArray_SimpleNew(1, &size, NPY_UINT16),
+                PyArray_SimpleNew(1, &size, NPY_BOOL),
+            });
+        }
+        return reinterpret_cast<PyObject*>(allocate_array<sepia::type::dvs>(0));
+    }
+    auto owner = new packet(std::move(events));
+    auto capsule = PyCapsule_New(owner, packet_capsule_name, nullptr);
+    if (!capsule) {
+        delete owner;
+        return nullptr;
+    }
+    PyCapsule_SetContext(capsule, new std::shared_ptr<packet_pool>(pool));
+    PyCapsule_SetDestructor(capsule, packet_capsule_destructor);
+    const auto size = static_cast<npy_intp>(owner->size());
+    PyObject* result = nullptr;
+    if (columns) {
+        result = columns_to_tuple({
+            wrap_array(capsule, PyArray_DescrFromType(NPY_UINT64), size, owner->ts.data()),
+            wrap_array(capsule, PyArray_DescrFromType(NPY_UINT16), size, owner->xs.data()),
+            wrap_array(capsule, PyArray_DescrFromType(NPY_UINT16), size, owner->ys.data()),
+            wrap_array(capsule, PyArray_DescrFromType(NPY_BOOL), size, owner->ons.data()),
+        });
+    } else {
+        result = wrap_array(capsule, event_type_to_dtype<sepia::type::dvs>(), size, owner->events.data());
+    }
+    Py_DECREF(capsule);
+    return result;
+}
+
+/// frames holds per-pixel images updated by the decoding thread, so that Python can monitor the camera without
+/// receiving events. counts and polarities (+1 for on, -1 for off, 0 without events) cover the events since the last
+/// reset, whereas ts holds the timestamp of the last event of every pixel (never_t if the pixel has not spiked).
+struct frames {
+    static constexpr uint64_t never_t = std::numeric_limits<uint64_t>::max();
+    bool count;
+    bool time_surface;
+    bool polarity;
+    uint64_t t;
+    std::vector<uint32_t> counts;
+    std::vector<uint64_t> ts;
+    std::vector<int8_t> polarities;
+
+    frames(bool enable_count, bool enable_time_surface, bool enable_polarity) :
+        count(enable_count),
+        time_surface(enable_time_surface),
+        polarity(enable_polarity),
+        t(0),
+        counts(enable_count ? sepia::evk4::width * sepia::evk4::height : 0, 0),
+        ts(enable_time_surface ? sepia::evk4::width * sepia::evk4::height : 0, never_t),
+        polarities(enable_polarity ? sepia::evk4::width * sepia::evk4::height : 0, 0) {}
+
+    /// push updates the images with an event.
+    void push(sepia::dvs_event event) {
+        const auto index = static_cast<std::size_t>(event.x) + static_cast<std::size_t>(event.y) * sepia::evk4::width;
+        if (count) {
+            ++counts[index];
+        }
+        if (time_surface) {
+            ts[index] = event.t;
+        }
+        if (polarity) {
+            polarities[index] = event.on ? 1 : -1;
+        }
+        t = event.t;
+    }
+
+    /// copy_to copies the images to other, and resets counts and polarities if reset is true.
+    /// Counts and polarities are swapped rather than copied on reset, hence other's must be zero.
+    void copy_to(frames& other, bool reset) {
+        if (reset) {
+            counts.swap(other.counts);
+            polarities.swap(other.polarities);
+        } else {
+            std::copy(counts.begin(), counts.end(), other.counts.begin());
+            std::copy(polarities.begin(), polarities.end(), other.polarities.begin());
+        }
+        std::copy(ts.begin(), ts.end(), other.ts.begin());
+        other.t = t;
+    }
+};
+
+/// frame_names lists the images that a camera can maintain.
+static const std::array<std::string, 3> frame_names = {"count", "time_surface", "polarity"};
+
 /// read_bias extracts a bias from a Python dict.
 static uint8_t read_bias(PyObject* biases_dict, const char* key) {
     auto value = PyDict_GetItemString(biases_dict, key);
@@ -206,9 +492,76 @@ static uint8_t read_bias(PyObject* biases_dict, const char* key) {
     return static_cast<uint8_t>(result);
 }
 
+/// read_erc_value extracts an event rate controller setting from a Python dict.
+static uint32_t read_erc_value(PyObject* erc_dict, const char* key, uint32_t minimum, uint32_t maximum) {
+    auto value = PyDict_GetItemString(erc_dict, key);
+    if (!value) {
+        throw std::runtime_error(std::string("parameters.erc must have a ") + key + " key");
+    }
+    if (!PyLong_Check(value)) {
+        throw std::runtime_error(std::string("parameters.erc.") + key + " must be an int");
+    }
+    auto result = PyLong_AsLongLong(value);
+    PyErr_Clear();
+    if (result < minimum || result > maximum) {
+        throw std::runtime_error(
+            std::string("parameters.erc.") + key + " must be in the range [" + std::to_string(minimum) + ", "
+            + std::to_string(maximum) + "]");
+    }
+    return static_cast<uint32_t>(result);
+}
+
+/// dict_to_parameters converts a Python dict (see evk4.Parameters) to camera parameters.
+static sepia::evk4::parameters dict_to_parameters(PyObject* parameters_dict) {
+    auto biases_dict = PyDict_GetItemString(parameters_dict, "biases");
+    if (!biases_dict) {
+        throw std::runtime_error("parameters must have a biases key");
+    }
+    if (!PyDict_Check(biases_dict)) {
+        throw std::runtime_error("parameters.biases must be a dict");
+    }
+    auto parameters = sepia::evk4::default_parameters;
+    parameters.biases.pr = read_bias(biases_dict, "pr");
+    parameters.biases.fo = read_bias(biases_dict, "fo");
+    parameters.biases.hpf = read_bias(biases_dict, "hpf");
+    parameters.biases.diff_on = read_bias(biases_dict, "diff_on");
+    parameters.biases.diff = read_bias(biases_dict, "diff");
+    parameters.biases.diff_off = read_bias(biases_dict, "diff_off");
+    parameters.biases.inv = read_bias(biases_dict, "inv");
+    parameters.biases.refr = read_bias(biases_dict, "refr");
+    parameters.biases.reqpuy = read_bias(biases_dict, "reqpuy");
+    parameters.biases.reqpux = read_bias(biases_dict, "reqpux");
+    parameters.biases.sendreqpdy = read_bias(biases_dict, "sendreqpdy");
+    parameters.biases.unknown_1 = read_bias(biases_dict, "unknown_1");
+    parameters.biases.unknown_2 = read_bias(biases_dict, "unknown_2");
+    auto erc_dict = PyDict_GetItemString(parameters_dict, "erc");
+    if (erc_dict) {
+        if (!PyDict_Check(erc_dict)) {
+            throw std::runtime_error("parameters.erc must be a dict");
+        }
+        auto enable = PyDict_GetItemString(erc_dict, "enable");
+        if (!enable || !PyBool_Check(enable)) {
+            throw std::runtime_error("parameters.erc.enable must be a bool");
+        }
+        parameters.erc.enable = enable == Py_True;
+        parameters.erc.target_event_rate = read_erc_value(erc_dict, "target_event_rate", 0, 0x3fffff);
+        parameters.erc.reference_period = static_cast<uint16_t>(read_erc_value(erc_dict, "reference_period", 1, 0x3ff));
+    }
+    return parameters;
+}
+
 /// camera reads events from a Prophesee Gen 4 dev kit 1.3 (Denebola).
+/// The decoding thread appends packets to buffers and notifies packet_ready after each USB buffer.
+/// If columns is true, packets are returned as Columns named tuples instead of structured arrays.
+/// If backlog_limit is not zero, overflow decides what to do with packets that do not fit in the backlog, and
+/// backlog_full is set until Python takes packets.
+/// If live_frames is not null, the decoding thread updates it and copies it to snapshot_frames on request, after a USB
+/// buffer (snapshot_requested is reset and snapshot_ready notified). If packets is false, events are not buffered.
+/// If ring is not null, the events of each USB buffer are collected in ring_batch and published to other processes.
+/// monitor measures the event rate during bias sweeps.
 struct camera_data {
-    std::atomic_flag accessing_camera;
+    std::mutex accessing_camera;
+    std::condition_variable packet_ready;
     std::string recordings_directory;
     std::string target_recording_name;
     std::string recording_name;
@@ -220,9 +573,31 @@ struct camera_data {
     std::size_t file_duration;
     std::size_t file_size;
     std::exception_ptr exception;
-    std::vector<sepia::dvs_event> buffer;
-    std::deque<std::vector<sepia::dvs_event>>* buffers;
-    std::vector<uint8_t> dvs_offsets;
+    bool columns;
+    packet buffer;
+    std::deque<packet>* buffers;
+    std::size_t buffers_events;
+    std::shared_ptr<packet_pool> pool;
+    std::size_t backlog_limit;
+    overflow_policy overflow;
+    bool backlog_full;
+    std::condition_variable space_available;
+    bool closing;
+    uint64_t dropped_packets;
+    uint64_t dropped_events;
+    bool packets;
+    std::unique_ptr<frames> live_frames;
+    std::unique_ptr<frames> snapshot_frames;
+    float tau;
+    bool snapshot_requested;
+    bool snapshot_reset;
+    std::condition_variable snapshot_ready;
+    std::mutex taking_snapshot;
+#ifndef _WIN32
+    std::unique_ptr<sepia::shared_ring::writer> ring;
+    std::vector<sepia::dvs_event> ring_batch;
+#endif
+    std::unique_ptr<sepia::sweep::monitor> monitor;
     std::unique_ptr<std::ofstream> jsonl_log;
     std::unique_ptr<sepia::evk4::base_camera> base_camera;
 };
@@ -232,6 +607,11 @@ struct camera {
 static void camera_dealloc(PyObject* self) {
     auto current = reinterpret_cast<camera*>(self);
     if (current->data) {
+        {
+            std::lock_guard<std::mutex> lock(current->data->accessing_camera);
+            current->data->closing = true;
+        }
+        current->data->space_available.notify_all();
         delete current->data;
         current->data = nullptr;
     }
@@ -243,24 +623,216 @@ static PyObject* camera_new(PyTypeObject* type, PyObject*, PyObject*) {
 static PyMemberDef camera_members[] = {
     {nullptr, 0, 0, 0, nullptr},
 };
+
+/// push_packet moves the packet being decoded to the backlog, and applies the overflow policy if the backlog is full.
+/// The caller must hold accessing_camera with lock.
+static void push_packet(camera_data* data, std::unique_lock<std::mutex>& lock) {
+    const auto size = data->buffer.size();
+    auto push = true;
+    if (data->backlog_limit > 0 && data->buffers_events + size > data->backlog_limit) {
+        data->backlog_full = true;
+        switch (data->overflow) {
+            case overflow_policy::drop_oldest:
+                while (!data->buffers->empty() && data->buffers_events + size > data->backlog_limit) {
+                    ++data->dropped_packets;
+                    data->dropped_events += data->buffers->front().size();
+                    data->buffers_events -= data->buffers->front().size();
+                    data->pool->release(std::move(data->buffers->front()));
+                    data->buffers->pop_front();
+                }
+                break;
+            case overflow_policy::drop_newest:
+                ++data->dropped_packets;
+                data->dropped_events += size;
+                data->buffer.clear();
+                push = false;
+                break;
+            case overflow_policy::block:
+                // the camera's FIFO absorbs the backlog while the decoding thread waits
+                data->packet_ready.notify_all();
+                data->space_available.wait(lock, [&]() {
+                    return data->closing || data->buffers->empty()
+                           || data->buffers_events + size <= data->backlog_limit;
+                });
+                break;
+        }
+    }
+    if (push) {
+        // the next packet is likely to have a similar size, reserving avoids reallocations while decoding
+        data->buffers_events += size;
+        data->buffers->push_back(data->pool->acquire());
+        std::swap(data->buffer, data->buffers->back());
+        data->buffer.reserve_like(data->buffers->back());
+    }
+}
+
+/// take_packets moves one packet (or all the packets if all is true) out of the backlog.
+/// The caller must hold accessing_camera.
+static void take_packets(camera_data* data, bool all, std::deque<packet>& packets) {
+    if (all) {
+        packets.swap(*data->buffers);
+        data->buffers_events = 0;
+    } else if (!data->buffers->empty()) {
+        packets.push_back(std::move(data->buffers->front()));
+        data->buffers->pop_front();
+        data->buffers_events -= packets.back().size();
+    }
+    data->backlog_full = false;
+    data->space_available.notify_all();
+}
+
+/// concatenate_column copies one column of several packets in a new array.
+template <typename Type, typename Column>
+static PyObject* concatenate_column(
+    const std::deque<packet>& packets,
+    PyArray_Descr* dtype,
+    npy_intp total,
+    Column column) {
+    auto array = PyArray_NewFromDescr(&PyArray_Type, dtype, 1, &total, nullptr, nullptr, 0, nullptr);
+    if (!array) {
+        return nullptr;
+    }
+    auto destination = reinterpret_cast<uint8_t*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(array)));
+    for (const auto& events : packets) {
+        const std::vector<Type>& source = column(events);
+        std::memcpy(destination, source.data(), source.size() * sizeof(Type));
+        destination += source.size() * sizeof(Type);
+    }
+    return array;
+}
+
+/// packets_to_object concatenates packets in a numpy array (or in a Columns named tuple).
+/// Events are not copied if there is at most one packet.
+static PyObject*
+packets_to_object(std::deque<packet>& packets, bool columns, const std::shared_ptr<packet_pool>& pool) {
+    if (packets.size() <= 1) {
+        return packet_to_object(packets.empty() ? packet() : std::move(packets.front()), columns, pool);
+    }
+    std::size_t total = 0;
+    for (const auto& events : packets) {
+        total += events.size();
+    }
+    const auto size = static_cast<npy_intp>(total);
+    PyObject* result = nullptr;
+    if (columns) {
+        result = columns_to_tuple({
+            concatenate_column<uint64_t>(
+                packets, PyArray_DescrFromType(NPY_UINT64), size, [](const packet& events) -> const auto& {
+                    return events.ts;
+                }),
+            concatenate_column<uint16_t>(
+                packets, PyArray_DescrFromType(NPY_UINT16), size, [](const packet& events) -> const auto& {
+                    return events.xs;
+                }),
+            concatenate_column<uint16_t>(
+                packets, PyArray_DescrFromType(NPY_UINT16), size, [](const packet& events) -> const auto& {
+                    return events.ys;
+                }),
+            concatenate_column<uint8_t>(
+                packets, PyArray_DescrFromType(NPY_BOOL), size, [](const packet& events) -> const auto& {
+                    return events.ons;
+                }),
+        });
+    } else {
+        result = concatenate_column<packed_dvs_event>(
+            packets, event_type_to_dtype<sepia::type::dvs>(), size, [](const packet& events) -> const auto& {
+                return events.events;
+            });
+    }
+    for (auto& events : packets) {
+        pool->release(std::move(events));
+    }
+    return result;
+}
+
+/// parse_timeout converts None or a number of seconds to an optional duration.
+static bool parse_timeout(PyObject* timeout, std::optional<std::chrono::duration<double>>& result) {
+    if (timeout == Py_None) {
+        result.reset();
+        return true;
+    }
+    const auto seconds = PyFloat_AsDouble(timeout);
+    if (seconds == -1.0 && PyErr_Occurred()) {
+        return false;
+    }
+    if (seconds < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "timeout must be None or a positive number");
+        return false;
+    }
+    // timeouts longer than about 30 years would overflow the steady clock
+    if (seconds >= 1e9) {
+        result.reset();
+        return true;
+    }
+    result = std::chrono::duration<double>(seconds);
+    return true;
+}
+
+/// wait_packets releases the GIL and blocks until the backlog holds at least min_events events (at least one packet if
+/// min_events is zero) or is full, the camera fails, or the timeout expires. A full backlog cannot grow (the decoder
+/// drops packets or waits), hence waiting for more events would never return. It then moves one packet (or all the packets if all
+/// is true) to packets. The GIL is re-acquired periodically to run signal handlers (Ctrl+C), and wait_packets returns
+/// false if one of them raised an exception.
+static bool wait_packets(
+    camera_data* data,
+    std::size_t min_events,
+    bool all,
+    const std::optional<std::chrono::duration<double>>& timeout,
+    std::deque<packet>& packets,
+    std::exception_ptr& exception) {
+    const auto deadline = timeout ? std::chrono::steady_clock::now()
+                                        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(*timeout) :
+                                    std::chrono::steady_clock::time_point::max();
+    auto ready = [&]() {
+        return data->exception
+               || (min_events == 0 ? !data->buffers->empty() :
+                                     data->buffers_events >= min_events
+                                         || (data->backlog_full && !data->buffers->empty()));
+    };
+    for (;;) {
+        auto done = false;
+        Py_BEGIN_ALLOW_THREADS
+        {
+            std::unique_lock<std::mutex> lock(data->accessing_camera);
+            const auto now = std::chrono::steady_clock::now();
+            const auto slice_end = deadline - now < signals_period ? deadline : now + signals_period;
+            data->packet_ready.wait_until(lock, slice_end, ready);
+            if (ready() || std::chrono::steady_clock::now() >= deadline) {
+                done = true;
+                if (data->exception) {
+                    exception = data->exception;
+                } else {
+                    take_packets(data, all, packets);
+                }
+            }
+        }
+        Py_END_ALLOW_THREADS
+        if (done) {
+            return true;
+        }
+        if (PyErr_CheckSignals() < 0) {
+            return false;
+        }
+    }
+}
+
 static PyObject* next_packet(PyObject* self, PyObject* args) {
     auto current = reinterpret_cast<camera*>(self);
     try {
         std::exception_ptr exception;
-        std::vector<sepia::dvs_event> events;
-        while (current->data->accessing_camera.test_and_set(std::memory_order_acquire)) {
-        }
-        if (current->data->exception) {
-            exception = current->data->exception;
-        } else if (!current->data->buffers->empty()) {
-            events.swap(current->data->buffers->front());
-            current->data->buffers->pop_front();
+        std::deque<packet> packets;
+        {
+            std::lock_guard<std::mutex> lock(current->data->accessing_camera);
+            if (current->data->exception) {
+                exception = current->data->exception;
+            } else {
+                take_packets(current->data, false, packets);
+            }
         }
-        current->data->accessing_camera.clear(std::memory_order_release);
         if (exception) {
             std::rethrow_exception(exception);
         }
-        return events_to_array<sepia::type::dvs>(events, current->data->dvs_offsets);
+        return packets_to_object(packets, current->data->columns, current->data->pool);
     } catch (const std::exception& exception) {
         PyErr_SetString(PyExc_RuntimeError, exception.what());
         return nullptr;
@@ -271,43 +843,80 @@ static PyObject* all_packets(PyObject* self, PyObject* args) {
     auto current = reinterpret_cast<camera*>(self);
     try {
         std::exception_ptr exception;
-        std::vector<sepia::dvs_event> events;
-        std::size_t total = 0;
-        while (current->data->accessing_camera.test_and_set(std::memory_order_acquire)) {
+        std::deque<packet> packets;
+        {
+            std::lock_guard<std::mutex> lock(current->data->accessing_camera);
+            if (current->data->exception) {
+                exception = current->data->exception;
+            } else {
+                take_packets(current->data, true, packets);
+            }
         }
-        const auto size = current->data->buffers->size();
-        for (const auto& buffer : (*current->data->buffers)) {
-            total += buffer.size();
+        if (exception) {
+            std::rethrow_exception(exception);
         }
-        if (current->data->exception) {
-            exception = current->data->exception;
+        return packets_to_object(packets, current->data->columns, current->data->pool);
+    } catch (const std::exception& exception) {
+        PyErr_SetString(PyExc_RuntimeError, exception.what());
+        return nullptr;
+    }
+    return nullptr;
+}
+static PyObject* wait_packet(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<camera*>(self);
+    PyObject* raw_timeout = Py_None;
+    if (!PyArg_ParseTuple(args, "|O", &raw_timeout)) {
+        return nullptr;
+    }
+    std::optional<std::chrono::duration<double>> timeout;
+    if (!parse_timeout(raw_timeout, timeout)) {
+        return nullptr;
+    }
+    try {
+        std::exception_ptr exception;
+        std::deque<packet> packets;
+        if (!wait_packets(current->data, 0, false, timeout, packets, exception)) {
+            return nullptr;
         }
-        current->data->accessing_camera.clear(std::memory_order_release);
         if (exception) {
             std::rethrow_exception(exception);
         }
-        if (size == 0) {
-            return events_to_array<sepia::type::dvs>(events, current->data->dvs_offsets);
+        return packets_to_object(packets, current->data->columns, current->data->pool);
+    } catch (const std::exception& exception) {
+        PyErr_SetString(PyExc_RuntimeError, exception.what());
+        return nullptr;
+    }
+    return nullptr;
+}
+static PyObject* wait_events(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<camera*>(self);
+    Py_ssize_t min_count;
+    PyObject* raw_timeout = Py_None;
+    if (!PyArg_ParseTuple(args, "n|O", &min_count, &raw_timeout)) {
+        return nullptr;
+    }
+    if (min_count < 1) {
+        PyErr_SetString(PyExc_ValueError, "min_count must be larger than zero");
+        return nullptr;
+    }
+    if (current->data->backlog_limit > 0 && static_cast<std::size_t>(min_count) > current->data->backlog_limit) {
+        PyErr_SetString(PyExc_ValueError, "min_count cannot be larger than backlog_limit");
+        return nullptr;
+    }
+    std::optional<std::chrono::duration<double>> timeout;
+    if (!parse_timeout(raw_timeout, timeout)) {
+        return nullptr;
+    }
+    try {
+        std::exception_ptr exception;
+        std::deque<packet> packets;
+        if (!wait_packets(current->data, static_cast<std::size_t>(min_count), true, timeout, packets, exception)) {
+            return nullptr;
         }
-        auto events_array = allocate_array<sepia::type::dvs>(total);
-        std::size_t offset = 0;
-        for (std::size_t buffer_index = 0; buffer_index < size; ++buffer_index) {
-            while (current->data->accessing_camera.test_and_set(std::memory_order_acquire)) {
-            }
-            events.swap(current->data->buffers->front());
-            current->data->buffers->pop_front();
-            current->data->accessing_camera.clear(std::memory_order_release);
-            for (npy_intp index = 0; index < static_cast<npy_intp>(events.size()); ++index) {
-                const auto dvs_event = events[index];
-                auto payload = reinterpret_cast<uint8_t*>(PyArray_GETPTR1(events_array, index + offset));
-                *reinterpret_cast<uint64_t*>(payload + current->data->dvs_offsets[0]) = dvs_event.t;
-                *reinterpret_cast<uint16_t*>(payload + current->data->dvs_offsets[1]) = dvs_event.x;
-                *reinterpret_cast<uint16_t*>(payload + current->data->dvs_offsets[2]) = dvs_event.y;
-                *reinterpret_cast<bool*>(payload + current->data->dvs_offsets[3]) = dvs_event.on;
-            }
-            offset += events.size();
+        if (exception) {
+            std::rethrow_exception(exception);
         }
-        return reinterpret_cast<PyObject*>(events_array);
+        return packets_to_object(packets, current->data->columns, current->data->pool);
     } catch (const std::exception& exception) {
         PyErr_SetString(PyExc_RuntimeError, exception.what());
         return nullptr;
@@ -321,28 +930,7 @@ static PyObject* set_parameters(PyObject* self, PyObject* args) {
         return nullptr;
     }
     try {
-        auto biases_dict = PyDict_GetItemString(parameters_dict, "biases");
-        if (!biases_dict) {
-            throw std::runtime_error("parameters must have a biases key");
-        }
-        if (!PyDict_Check(biases_dict)) {
-            throw std::runtime_error("parameters.biases must be a dict");
-        }
-        auto parameters = sepia::evk4::default_parameters;
-        parameters.biases.pr = read_bias(biases_dict, "pr");
-        parameters.biases.fo = read_bias(biases_dict, "fo");
-        parameters.biases.hpf = read_bias(biases_dict, "hpf");
-        parameters.biases.diff_on = read_bias(biases_dict, "diff_on");
-        parameters.biases.diff = read_bias(biases_dict, "diff");
-        parameters.biases.diff_off = read_bias(biases_dict, "diff_off");
-        parameters.biases.inv = read_bias(biases_dict, "inv");
-        parameters.biases.refr = read_bias(biases_dict, "refr");
-        parameters.biases.reqpuy = read_bias(biases_dict, "reqpuy");
-        parameters.biases.reqpux = read_bias(biases_dict, "reqpux");
-        parameters.biases.sendreqpdy = read_bias(biases_dict, "sendreqpdy");
-        parameters.biases.unknown_1 = read_bias(biases_dict, "unknown_1");
-        parameters.biases.unknown_2 = read_bias(biases_dict, "unknown_2");
-        current->data->base_camera->update_parameters(parameters);
+        current->data->base_camera->update_parameters(dict_to_parameters(parameters_dict));
         Py_RETURN_NONE;
     } catch (const std::exception& exception) {
         PyErr_SetString(PyExc_RuntimeError, exception.what());
@@ -350,25 +938,264 @@ static PyObject* set_parameters(PyObject* self, PyObject* args) {
     }
     return nullptr;
 }
+static PyObject* sweep(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<camera*>(self);
+    PyObject* parameters_dict;
+    PyObject* axes_list;
+    double settle;
+    double duration;
+    double hot_pixel_rate;
+    if (!PyArg_ParseTuple(args, "OOddd", &parameters_dict, &axes_list, &settle, &duration, &hot_pixel_rate)) {
+        return nullptr;
+    }
+    try {
+        const auto base = dict_to_parameters(parameters_dict);
+        std::vector<sepia::sweep::axis> axes;
+        {
+            auto sequence = PySequence_Fast(axes_list, "axes must be a sequence of (name, values) tuples");
+            if (!sequence) {
+                return nullptr;
+            }
+            for (Py_ssize_t index = 0; index < PySequence_Fast_GET_SIZE(sequence); ++index) {
+                const char* name;
+                PyObject* values;
+                if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(sequence, index), "sO", &name, &values)) {
+                    Py_DECREF(sequence);
+                    return nullptr;
+                }
+                axes.push_back({name, {}});
+                auto values_sequence = PySequence_Fast(values, "axis values must be a sequence of ints");
+                if (!values_sequence) {
+                    Py_DECREF(sequence);
+                    return nullptr;
+                }
+                for (Py_ssize_t value_index = 0; value_index < PySequence_Fast_GET_SIZE(values_sequence);
+                     ++value_index) {
+                    const auto value = PyLong_AsLong(PySequence_Fast_GET_ITEM(values_sequence, value_index));
+                    if (value < 0 || value > 255) {
+                        PyErr_Clear();
+                        Py_DECREF(values_sequence);
+                        Py_DECREF(sequence);
+                        throw std::runtime_error(
+                            std::string("the values of ") + name + " must be in the range [0, 255]");
+                    }
+                    axes.back().values.push_back(static_cast<uint8_t>(value));
+                }
+                Py_DECREF(values_sequence);
+            }
+            Py_DECREF(sequence);
+        }
+        const auto settings = sepia::sweep::grid(base, axes);
+        std::vector<sepia::sweep::statistics> rows;
+        std::exception_ptr exception;
+        auto interrupted = false;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            rows = sepia::sweep::run(
+                *current->data->base_camera,
+                *current->data->monitor,
+                settings,
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(settle)),
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(duration)),
+                hot_pixel_rate,
+                [&](std::size_t, const sepia::sweep::statistics&) {
+                    Py_BLOCK_THREADS
+                    interrupted = PyErr_CheckSignals() < 0;
+                    Py_UNBLOCK_THREADS
+                    return !interrupted;
+                });
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        Py_END_ALLOW_THREADS
+        if (interrupted) {
+            return nullptr;
+        }
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        PyObject* result = PyList_New(static_cast<Py_ssize_t>(rows.size()));
+        for (std::size_t index = 0; index < rows.size(); ++index) {
+            PyObject* values = PyDict_New();
+            auto parameters = settings[index];
+            for (const auto& axis : axes) {
+                auto value = PyLong_FromUnsignedLong(parameters.biases.by_name(axis.name));
+                PyDict_SetItemString(values, axis.name.c_str(), value);
+                Py_DECREF(value);
+            }
+            const auto& row = rows[index];
+            PyList_SET_ITEM(
+                result,
+                static_cast<Py_ssize_t>(index),
+                Py_BuildValue(
+                    "(NKKKndddnd)",
+                    values,
+                    static_cast<unsigned long long>(row.duration),
+                    static_cast<unsigned long long>(row.on_events),
+                    static_cast<unsigned long long>(row.off_events),
+                    static_cast<Py_ssize_t>(row.buffers),
+                    row.event_rate,
+                    row.peak_buffer_rate,
+                    row.on_ratio,
+                    static_cast<Py_ssize_t>(row.hot_pixels),
+                    row.hot_pixel_share));
+        }
+        return result;
+    } catch (const std::exception& exception) {
+        PyErr_SetString(PyExc_RuntimeError, exception.what());
+        return nullptr;
+    }
+    return nullptr;
+}
 static PyObject* backlog(PyObject* self, PyObject* args) {
     auto current = reinterpret_cast<camera*>(self);
     std::size_t total = 0;
-    while (current->data->accessing_camera.test_and_set(std::memory_order_acquire)) {
-    }
-    for (const auto& buffer : (*current->data->buffers)) {
-        total += buffer.size();
+    {
+        std::lock_guard<std::mutex> lock(current->data->accessing_camera);
+        total = current->data->buffers_events;
     }
-    current->data->accessing_camera.clear(std::memory_order_release);
     return PyLong_FromSsize_t(total);
 }
 static PyObject* clear_backlog(PyObject* self, PyObject* args) {
     auto current = reinterpret_cast<camera*>(self);
-    while (current->data->accessing_camera.test_and_set(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(current->data->accessing_camera);
+    for (auto& events : *current->data->buffers) {
+        current->data->pool->release(std::move(events));
     }
     current->data->buffers->clear();
-    current->data->accessing_camera.clear(std::memory_order_release);
+    current->data->buffers_events = 0;
+    current->data->backlog_full = false;
+    current->data->space_available.notify_all();
     Py_RETURN_NONE;
 }
+static PyObject* dropped(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<camera*>(self);
+    uint64_t dropped_packets = 0;
+    uint64_t dropped_events = 0;
+    {
+        std::lock_guard<std::mutex> lock(current->data->accessing_camera);
+        dropped_packets = current->data->dropped_packets;
+        dropped_events = current->data->dropped_events;
+    }
+    PyObject* result = PyTuple_New(2);
+    PyTuple_SET_ITEM(result, 0, PyLong_FromUnsignedLongLong(dropped_packets));
+    PyTuple_SET_ITEM(result, 1, PyLong_FromUnsignedLongLong(dropped_events));
+    return result;
+}
+static PyObject* snapshot(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<camera*>(self);
+    auto data = current->data;
+    int reset = 1;
+    if (!PyArg_ParseTuple(args, "|p", &reset)) {
+        return nullptr;
+    }
+    if (!data->live_frames) {
+        PyErr_SetString(PyExc_RuntimeError, "the camera was created without frames");
+        return nullptr;
+    }
+    npy_intp dimensions[2] = {sepia::evk4::height, sepia::evk4::width};
+    std::array<PyObject*, 3> arrays = {
+        data->live_frames->count ? PyArray_SimpleNew(2, dimensions, NPY_UINT32) : Py_None,
+        data->live_frames->time_surface ? PyArray_SimpleNew(2, dimensions, NPY_FLOAT32) : Py_None,
+        data->live_frames->polarity ? PyArray_SimpleNew(2, dimensions, NPY_FLOAT32) : Py_None,
+    };
+    auto release_arrays = [&]() {
+        for (auto array : arrays) {
+            if (array != Py_None) {
+                Py_XDECREF(array);
+            }
+        }
+    };
+    if (!arrays[0] || !arrays[1] || !arrays[2]) {
+        release_arrays();
+        return nullptr;
+    }
+
+    // the decoding thread copies the frames after a USB buffer, so that it never waits for Python
+    std::unique_lock<std::mutex> taking_snapshot_lock(data->taking_snapshot, std::defer_lock);
+    std::exception_ptr exception;
+    Py_BEGIN_ALLOW_THREADS
+    taking_snapshot_lock.lock();
+    {
+        std::lock_guard<std::mutex> lock(data->accessing_camera);
+        data->snapshot_reset = reset != 0;
+        data->snapshot_requested = true;
+    }
+    Py_END_ALLOW_THREADS
+    for (;;) {
+        auto done = false;
+        Py_BEGIN_ALLOW_THREADS
+        {
+            std::unique_lock<std::mutex> lock(data->accessing_camera);
+            data->snapshot_ready.wait_for(
+                lock, signals_period, [&]() { return !data->snapshot_requested || data->exception; });
+            if (data->snapshot_requested && data->exception) {
+                exception = data->exception;
+                data->snapshot_requested = false;
+            }
+            done = !data->snapshot_requested;
+        }
+        Py_END_ALLOW_THREADS
+        if (done) {
+            break;
+        }
+        if (PyErr_CheckSignals() < 0) {
+            {
+                std::lock_guard<std::mutex> lock(data->accessing_camera);
+                data->snapshot_requested = false;
+            }
+            release_arrays();
+            return nullptr;
+        }
+    }
+    if (exception) {
+        release_arrays();
+        try {
+            std::rethrow_exception(exception);
+        } catch (const std::exception& camera_exception) {
+            PyErr_SetString(PyExc_RuntimeError, camera_exception.what());
+        }
+        return nullptr;
+    }
+    auto& copy = *data->snapshot_frames;
+    Py_BEGIN_ALLOW_THREADS
+    if (copy.count) {
+        std::copy(
+            copy.counts.begin(),
+            copy.counts.end(),
+            reinterpret_cast<uint32_t*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(arrays[0]))));
+        std::fill(copy.counts.begin(), copy.counts.end(), 0);
+    }
+    if (copy.time_surface) {
+        auto time_surface = reinterpret_cast<float*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(arrays[1])));
+        for (std::size_t index = 0; index < copy.ts.size(); ++index) {
+            time_surface[index] = copy.ts[index] == frames::never_t ?
+                                      0.0f :
+                                      sepia::accumulate::exp_negative(
+                                          -static_cast<float>(copy.t - copy.ts[index]) / data->tau);
+        }
+    }
+    if (copy.polarity) {
+        auto polarity = reinterpret_cast<float*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(arrays[2])));
+        for (std::size_t index = 0; index < copy.polarities.size(); ++index) {
+            polarity[index] = static_cast<float>(copy.polarities[index]);
+        }
+        std::fill(copy.polarities.begin(), copy.polarities.end(), 0);
+    }
+    Py_END_ALLOW_THREADS
+    const auto t = copy.t;
+    taking_snapshot_lock.unlock();
+    PyObject* result = PyTuple_New(4);
+    PyTuple_SET_ITEM(result, 0, PyLong_FromUnsignedLongLong(t));
+    for (std::size_t index = 0; index < arrays.size(); ++index) {
+        if (arrays[index] == Py_None) {
+            Py_INCREF(Py_None);
+        }
+        PyTuple_SET_ITEM(result, index + 1, arrays[index]);
+    }
+    return result;
+}
 static PyObject* record_to(PyObject* self, PyObject* args) {
     auto current = reinterpret_cast<camera*>(self);
     const char* raw_name;
@@ -376,10 +1203,10 @@ static PyObject* record_to(PyObject* self, PyObject* args) {
         return nullptr;
     }
     auto name = std::string(raw_name);
-    while (current->data->accessing_camera.test_and_set(std::memory_order_acquire)) {
+    {
+        std::lock_guard<std::mutex> lock(current->data->accessing_camera);
+        current->data->target_recording_name.swap(name);
     }
-    current->data->target_recording_name.swap(name);
-    current->data->accessing_camera.clear(std::memory_order_release);
     Py_RETURN_NONE;
 }
 
@@ -388,12 +1215,12 @@ static PyObject* recording_status(PyObject* self, PyObject* args) {
     std::string file_name;
     std::size_t file_duration = 0;
     std::size_t file_size = 0;
-    while (current->data->accessing_camera.test_and_set(std::memory_order_acquire)) {
+    {
+        std::lock_guard<std::mutex> lock(current->data->accessing_camera);
+        file_name = current->data->file_name;
+        file_duration = current->data->file_duration;
+        file_size = current->data->file_size;
     }
-    file_name = current->data->file_name;
-    file_duration = current->data->file_duration;
-    file_size = current->data->file_size;
-    current->data->accessing_camera.clear(std::memory_order_release);
     PyObject* status = PyTuple_New(3);
     PyTuple_SET_ITEM(status, 0, PyUnicode_FromString(file_name.c_str()));
     PyTuple_SET_ITEM(status, 1, PyLong_FromUnsignedLongLong(file_duration));
@@ -404,9 +1231,14 @@ static PyObject* recording_status(PyObject* self, PyObject* args) {
 static PyMethodDef camera_methods[] = {
     {"next_packet", next_packet, METH_VARARGS, nullptr},
     {"all_packets", all_packets, METH_VARARGS, nullptr},
+    {"wait_packet", wait_packet, METH_VARARGS, nullptr},
+    {"wait_events", wait_events, METH_VARARGS, nullptr},
     {"set_parameters", set_parameters, METH_VARARGS, nullptr},
+    {"sweep", sweep, METH_VARARGS, nullptr},
     {"backlog", backlog, METH_NOARGS, nullptr},
     {"clear_backlog", clear_backlog, METH_NOARGS, nullptr},
+    {"dropped", dropped, METH_NOARGS, nullptr},
+    {"snapshot", snapshot, METH_VARARGS, nullptr},
     {"record_to", record_to, METH_VARARGS, nullptr},
     {"recording_status", recording_status, METH_NOARGS, nullptr},
     {nullptr, nullptr, 0, nullptr},
@@ -415,26 +1247,114 @@ static int camera_init(PyObject* self, PyObject* args, PyObject*) {
     auto current = reinterpret_cast<camera*>(self);
     PyObject* recordings_path;
     PyObject* log_path;
-    if (!PyArg_ParseTuple(args, "OO", &recordings_path, &log_path)) {
+    int columns = 0;
+    Py_ssize_t backlog_limit = 0;
+    const char* overflow = "drop_oldest";
+    PyObject* frames_names = nullptr;
+    float tau = 10000.0f;
+    int packets = 1;
+    const char* ring_name = nullptr;
+    Py_ssize_t ring_capacity = 1 << 22;
+    if (!PyArg_ParseTuple(
+            args,
+            "OO|pnsOfpzn",
+            &recordings_path,
+            &log_path,
+            &columns,
+            &backlog_limit,
+            &overflow,
+            &frames_names,
+            &tau,
+            &packets,
+            &ring_name,
+            &ring_capacity)) {
         return -1;
     }
+    if (backlog_limit < 0) {
+        PyErr_SetString(PyExc_ValueError, "backlog_limit must be zero (no limit) or larger");
+        return -1;
+    }
+    if (tau <= 0.0f) {
+        PyErr_SetString(PyExc_ValueError, "tau must be larger than zero");
+        return -1;
+    }
+    std::array<bool, 3> enabled_frames = {false, false, false};
+    if (frames_names && frames_names != Py_None) {
+        auto sequence = PySequence_Fast(frames_names, "frames must be a sequence of strings");
+        if (!sequence) {
+            return -1;
+        }
+        for (Py_ssize_t index = 0; index < PySequence_Fast_GET_SIZE(sequence); ++index) {
+            auto raw_name = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(sequence, index));
+            if (!raw_name) {
+                Py_DECREF(sequence);
+                return -1;
+            }
+            const auto name = std::find(frame_names.begin(), frame_names.end(), raw_name);
+            if (name == frame_names.end()) {
+                Py_DECREF(sequence);
+                PyErr_SetString(PyExc_ValueError, "frames must contain \"count\", \"time_surface\", or \"polarity\"");
+                return -1;
+            }
+            enabled_frames[std::distance(frame_names.begin(), name)] = true;
+        }
+        Py_DECREF(sequence);
+    }
     try {
         current->data = new camera_data;
         auto data = current->data;
-        data->accessing_camera.clear(std::memory_order_release);
         data->recordings_directory = python_path_to_string(recordings_path);
         data->first_t = 0;
         data->previous_t = 0;
         data->last_size_read_t = 0;
         data->file_duration = 0;
         data->file_size = 0;
-        data->buffers = new std::deque<std::vector<sepia::dvs_event>>;
-        data->dvs_offsets = get_offsets<sepia::type::dvs>();
+        data->columns = columns != 0;
+        data->buffers = new std::deque<packet>;
+        data->buffers_events = 0;
+        data->pool = std::make_shared<packet_pool>(packets_pool_capacity);
+        data->backlog_limit = static_cast<std::size_t>(backlog_limit);
+        data->overflow = string_to_overflow_policy(overflow);
+        data->backlog_full = false;
+        data->closing = false;
+        data->dropped_packets = 0;
+        data->dropped_events = 0;
+        data->packets = packets != 0;
+        if (enabled_frames[0] || enabled_frames[1] || enabled_frames[2]) {
+            data->live_frames = std::make_unique<frames>(enabled_frames[0], enabled_frames[1], enabled_frames[2]);
+            data->snapshot_frames = std::make_unique<frames>(enabled_frames[0], enabled_frames[1], enabled_frames[2]);
+        }
+        data->tau = tau;
+        data->snapshot_requested = false;
+        data->snapshot_reset = false;
+        if (ring_name) {
+#ifdef _WIN32
+            throw std::runtime_error("shared rings are not supported on Windows");
+#else
+            if (ring_capacity < 1) {
+                throw std::runtime_error("shared_ring_capacity must be larger than zero");
+            }
+            data->ring = sepia::make_unique<sepia::shared_ring::writer>(
+                ring_name, static_cast<std::size_t>(ring_capacity), sepia::evk4::width, sepia::evk4::height);
+#endif
+        }
+        data->monitor = sepia::make_unique<sepia::sweep::monitor>(sepia::evk4::width, sepia::evk4::height);
         data->jsonl_log.reset(
             new std::ofstream(python_path_to_string(log_path), std::ios::binary | std::ios::app | std::ios::out));
         data->base_camera = sepia::evk4::make_camera(
             [=](sepia::dvs_event event) {
-                data->buffer.push_back(event);
+                if (data->packets) {
+                    data->buffer.push(event, data->columns);
+                }
+                if (data->live_frames) {
+                    data->live_frames->push(event);
+                }
+                data->monitor->push(event);
+#ifndef _WIN32
+                if (data->ring) {
+                    data->ring_batch.push_back(event);
+                }
+#endif
                 if (data->write_event) {
                     data->write_event->operator()({
                         event.t - data->first_t,
@@ -459,10 +1379,16 @@ static int camera_init(PyObject* self, PyObject* args, PyObject*) {
                 }
                 data->previous_t = trigger_event.t;
             },
-            [=]() {},
+            [=](std::size_t, std::size_t) { return true; },
             [=]() {
-                while (data->accessing_camera.test_and_set(std::memory_order_acquire)) {
+                data->monitor->end_buffer();
+#ifndef _WIN32
+                if (data->ring) {
+                    data->ring->write(data->ring_batch.data(), data->ring_batch.size());
+                    data->ring_batch.clear();
                 }
+#endif
+                std::unique_lock<std::mutex> lock(data->accessing_camera);
                 if (data->write_event) {
                     if (data->target_recording_name.empty() || data->target_recording_name != data->recording_name) {
                         data->recording_name.clear();
@@ -497,24 +1423,32 @@ static int camera_init(PyObject* self, PyObject* args, PyObject*) {
                     data->jsonl_log->write(message_string.data(), message_string.size());
                     data->jsonl_log->flush();
                 }
-                data->buffers->emplace_back();
-                data->buffer.swap(data->buffers->back());
-                data->accessing_camera.clear(std::memory_order_release);
+                if (data->snapshot_requested) {
+                    data->live_frames->copy_to(*data->snapshot_frames, data->snapshot_reset);
+                    data->snapshot_requested = false;
+                    data->snapshot_ready.notify_all();
+                }
+                if (data->packets) {
+                    push_packet(data, lock);
+                }
+                lock.unlock();
+                data->packet_ready.notify_all();
             },
             [=](std::exception_ptr exception) {
-                while (data->accessing_camera.test_and_set(std::memory_order_acquire)) {
+                {
+                    std::lock_guard<std::mutex> lock(data->accessing_camera);
+                    data->exception = exception;
                 }
-                data->exception = exception;
-                data->accessing_camera.clear(std::memory_order_release);
+                data->packet_ready.notify_all();
             },
             sepia::evk4::default_parameters,
             "",
             std::chrono::milliseconds(100),
             64,
-            [=](std::size_t dropped_bytes) {
+            4096,
+            [=]() {
                 std::stringstream message;
-                message << "{\"timestamp\":" << utc_timestamp() << ",\"type\":\"drop\",\"bytes\":" << dropped_bytes
-                        << "}\n";
+                message << "{\"timestamp\":\"" << utc_timestamp() << "\",\"type\":\"drop\"}\n";
                 const std::string message_string = message.str();
                 data->jsonl_log->write(message_string.data(), message_string.size());
                 data->jsonl_log->flush();
@@ -527,6 +1461,463 @@ static int camera_init(PyObject* self, PyObject* args, PyObject*) {
 }
 static PyTypeObject camera_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
 
+/// accumulator converts DVS events into frames (see common/accumulate.hpp).
+struct accumulator_data {
+    std::unique_ptr<sepia::accumulate::accumulator<sepia::dvs_event>> accumulator;
+    std::vector<uint8_t> dvs_offsets;
+    std::vector<sepia::dvs_event> events;
+    uint64_t previous_t;
+};
+struct accumulator {
+    PyObject_HEAD accumulator_data* data;
+};
+static void accumulator_dealloc(PyObject* self) {
+    auto current = reinterpret_cast<accumulator*>(self);
+    if (current->data) {
+        delete current->data;
+        current->data = nullptr;
+    }
+    Py_TYPE(self)->tp_free(self);
+}
+static PyObject* accumulator_new(PyTypeObject* type, PyObject*, PyObject*) {
+    return type->tp_alloc(type, 0);
+}
+static PyMemberDef accumulator_members[] = {
+    {nullptr, 0, 0, 0, nullptr},
+};
+
+/// frame represents a completed window, copied out of the accumulator's reusable buffer.
+struct frame {
+    uint64_t begin_t;
+    uint64_t end_t;
+    std::vector<float> values;
+};
+
+/// frames_to_list converts frames to a list of (begin_t, end_t, ndarray) tuples.
+static PyObject* frames_to_list(std::vector<frame>& frames, const accumulator_data* data) {
+    auto list = PyList_New(static_cast<Py_ssize_t>(frames.size()));
+    npy_intp dimensions[3] = {
+        static_cast<npy_intp>(data->accumulator->channels()),
+        static_cast<npy_intp>(data->accumulator->height()),
+        static_cast<npy_intp>(data->accumulator->width()),
+    };
+    for (Py_ssize_t index = 0; index < static_cast<Py_ssize_t>(frames.size()); ++index) {
+        auto values = reinterpret_cast<PyArrayObject*>(PyArray_SimpleNew(3, dimensions, NPY_FLOAT32));
+        std::copy(
+            frames[index].values.begin(),
+            frames[index].values.end(),
+            reinterpret_cast<float*>(PyArray_DATA(values)));
+        PyObject* item = PyTuple_New(3);
+        PyTuple_SET_ITEM(item, 0, PyLong_FromUnsignedLongLong(frames[index].begin_t));
+        PyTuple_SET_ITEM(item, 1, PyLong_FromUnsignedLongLong(frames[index].end_t));
+        PyTuple_SET_ITEM(item, 2, reinterpret_cast<PyObject*>(values));
+        PyList_SET_ITEM(list, index, item);
+    }
+    return list;
+}
+static PyObject* accumulator_push(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<accumulator*>(self);
+    PyObject* events_object;
+    if (!PyArg_ParseTuple(args, "O", &events_object)) {
+        return nullptr;
+    }
+    try {
+        auto data = current->data;
+        const auto width = data->accumulator->width();
+        const auto height = data->accumulator->height();
+        auto previous_t = data->previous_t;
+        // read_events copies and validates the events, event_at returns the event with the given index
+        const auto read_events = [&](npy_intp size, auto event_at) {
+            data->events.resize(static_cast<std::size_t>(size));
+            for (npy_intp index = 0; index < size; ++index) {
+                const sepia::dvs_event event = event_at(index);
+                // the accumulator indexes its tiles and frames with the coordinates, without bounds checks
+                if (event.x >= width || event.y >= height) {
+                    data->events.clear();
+                    PyErr_Format(
+                        PyExc_ValueError,
+                        "the event %zd (x=%u, y=%u) is outside the accumulator's %ux%u frame",
+                        static_cast<Py_ssize_t>(index),
+                        static_cast<unsigned int>(event.x),
+                        static_cast<unsigned int>(event.y),
+                        static_cast<unsigned int>(width),
+                        static_cast<unsigned int>(height));
+                    return false;
+                }
+                if (event.t < previous_t) {
+                    data->events.clear();
+                    PyErr_Format(
+                        PyExc_ValueError,
+                        "the event %zd (t=%llu) is older than the previous event (t=%llu)",
+                        static_cast<Py_ssize_t>(index),
+                        static_cast<unsigned long long>(event.t),
+                        static_cast<unsigned long long>(previous_t));
+                    return false;
+                }
+                previous_t = event.t;
+                data->events[index] = event;
+            }
+            return true;
+        };
+        if (PyObject_TypeCheck(events_object, &columns_type)) {
+            // Columns (returned with columns=True) store each field in a contiguous array, read without strides
+            const std::array<int, 4> types{NPY_UINT64, NPY_UINT16, NPY_UINT16, NPY_BOOL};
+            std::array<PyArrayObject*, 4> arrays;
+            for (std::size_t index = 0; index < arrays.size(); ++index) {
+                auto column = PyStructSequence_GET_ITEM(events_object, static_cast<Py_ssize_t>(index));
+                if (!PyArray_Check(column)) {
+                    throw std::runtime_error("the Columns fields must be numpy arrays");
+                }
+                arrays[index] = reinterpret_cast<PyArrayObject*>(column);
+                if (PyArray_NDIM(arrays[index]) != 1 || PyArray_TYPE(arrays[index]) != types[index]
+                    || !PyArray_ISCARRAY_RO(arrays[index]) || PyArray_SIZE(arrays[index]) != PyArray_SIZE(arrays[0])) {
+                    throw std::runtime_error(
+                        "the Columns fields must be contiguous one-dimensional arrays with the same length and the "
+                        "types returned by next_packet");
+                }
+            }
+            const auto ts = reinterpret_cast<const uint64_t*>(PyArray_DATA(arrays[0]));
+            const auto xs = reinterpret_cast<const uint16_t*>(PyArray_DATA(arrays[1]));
+            const auto ys = reinterpret_cast<const uint16_t*>(PyArray_DATA(arrays[2]));
+            const auto ons = reinterpret_cast<const npy_bool*>(PyArray_DATA(arrays[3]));
+            if (!read_events(PyArray_SIZE(arrays[0]), [&](npy_intp index) {
+                    return sepia::dvs_event{ts[index], xs[index], ys[index], ons[index] != 0};
+                })) {
+                return nullptr;
+            }
+        } else {
+            if (!PyArray_Check(events_object)) {
+                throw std::runtime_error("events must be a numpy array or Columns");
+            }
+            auto events_array = reinterpret_cast<PyArrayObject*>(events_object);
+            auto dtype = event_type_to_dtype<sepia::type::dvs>();
+            const auto equivalent = PyArray_EquivTypes(PyArray_DESCR(events_array), dtype);
+            Py_DECREF(dtype);
+            if (!equivalent || PyArray_NDIM(events_array) != 1) {
+                throw std::runtime_error(
+                    "events must be a one-dimensional array with the dtype returned by next_packet");
+            }
+            if (!read_events(PyArray_SIZE(events_array), [&](npy_intp index) {
+                    const auto payload = reinterpret_cast<const uint8_t*>(PyArray_GETPTR1(events_array, index));
+                    return sepia::dvs_event{
+                        *reinterpret_cast<const uint64_t*>(payload + data->dvs_offsets[0]),
+                        *reinterpret_cast<const uint16_t*>(payload + data->dvs_offsets[1]),
+                        *reinterpret_cast<const uint16_t*>(payload + data->dvs_offsets[2]),
+                        *reinterpret_cast<const bool*>(payload + data->dvs_offsets[3]),
+                    };
+                })) {
+                return nullptr;
+            }
+        }
+        data->previous_t = previous_t;
+        std::vector<frame> frames;
+        std::exception_ptr exception;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            data->accumulator->push(
+                data->events.begin(),
+                data->events.end(),
+                [&](uint64_t begin_t, uint64_t end_t, const std::vector<float>& values) {
+                    frames.push_back({begin_t, end_t, values});
+                });
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        Py_END_ALLOW_THREADS
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return frames_to_list(frames, data);
+    } catch (const std::exception& exception) {
+        PyErr_SetString(PyExc_RuntimeError, exception.what());
+        return nullptr;
+    }
+    return nullptr;
+}
+static PyObject* accumulator_flush(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<accumulator*>(self);
+    try {
+        std::vector<frame> frames;
+        current->data->accumulator->flush([&](uint64_t begin_t, uint64_t end_t, const std::vector<float>& values) {
+            frames.push_back({begin_t, end_t, values});
+        });
+        return frames_to_list(frames, current->data);
+    } catch (const std::exception& exception) {
+        PyErr_SetString(PyExc_RuntimeError, exception.what());
+        return nullptr;
+    }
+    return nullptr;
+}
+static PyMethodDef accumulator_methods[] = {
+    {"push", accumulator_push, METH_VARARGS, nullptr},
+    {"flush", accumulator_flush, METH_NOARGS, nullptr},
+    {nullptr, nullptr, 0, nullptr},
+};
+static int accumulator_init(PyObject* self, PyObject* args, PyObject*) {
+    auto current = reinterpret_cast<accumulator*>(self);
+    unsigned short width;
+    unsigned short height;
+    const char* representation;
+    const char* window_mode;
+    unsigned long long window;
+    float tau;
+    Py_ssize_t bins;
+    Py_ssize_t threads;
+    if (!PyArg_ParseTuple(
+            args, "HHssKfnn", &width, &height, &representation, &window_mode, &window, &tau, &bins, &threads)) {
+        return -1;
+    }
+    try {
+        if (bins < 0 || threads < 0) {
+            throw std::runtime_error("bins and threads must be positive or zero");
+        }
+        current->data = new accumulator_data;
+        current->data->dvs_offsets = get_offsets<sepia::type::dvs>();
+        current->data->previous_t = 0;
+        current->data->accumulator = std::make_unique<sepia::accumulate::accumulator<sepia::dvs_event>>(
+            width,
+            height,
+            sepia::accumulate::string_to_representation(representation),
+            sepia::accumulate::string_to_window_mode(window_mode),
+            window,
+            tau,
+            static_cast<std::size_t>(bins),
+            static_cast<std::size_t>(threads));
+    } catch (const std::exception& exception) {
+        PyErr_SetString(PyExc_RuntimeError, exception.what());
+        return -1;
+    }
+    return 0;
+}
+static PyTypeObject accumulator_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+/// make_packet provides the file reader with packets from a pool.
+struct make_packet {
+    std::shared_ptr<packet_pool> pool;
+
+    packet operator()() {
+        return pool->acquire();
+    }
+};
+
+/// push_to_packet appends events to the file reader's packets.
+struct push_to_packet {
+    bool columns;
+
+    void operator()(packet& events, sepia::dvs_event event) {
+        events.push(event, columns);
+    }
+};
+
+/// reader reads DVS events from an Event Stream file in chunks.
+struct reader_data {
+    bool columns;
+    std::shared_ptr<packet_pool> pool;
+    std::unique_ptr<sepia::es::reader<packet, make_packet, push_to_packet>> reader;
+};
+struct reader {
+    PyObject_HEAD reader_data* data;
+};
+static void reader_dealloc(PyObject* self) {
+    auto current = reinterpret_cast<reader*>(self);
+    if (current->data) {
+        delete current->data;
+        current->data = nullptr;
+    }
+    Py_TYPE(self)->tp_free(self);
+}
+static PyObject* reader_new(PyTypeObject* type, PyObject*, PyObject*) {
+    return type->tp_alloc(type, 0);
+}
+static PyMemberDef reader_members[] = {
+    {nullptr, 0, 0, 0, nullptr},
+};
+static PyObject* reader_next_chunk(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<reader*>(self);
+    try {
+        packet chunk;
+        auto available = false;
+        std::exception_ptr exception;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            available = current->data->reader->next(chunk);
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        Py_END_ALLOW_THREADS
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        if (!available) {
+            Py_RETURN_NONE;
+        }
+        return packet_to_object(std::move(chunk), current->data->columns, current->data->pool);
+    } catch (const std::exception& exception) {
+        PyErr_SetString(PyExc_RuntimeError, exception.what());
+        return nullptr;
+    }
+    return nullptr;
+}
+static PyObject* reader_dimensions(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<reader*>(self);
+    const auto& header = current->data->reader->header();
+    PyObject* dimensions = PyTuple_New(2);
+    PyTuple_SET_ITEM(dimensions, 0, PyLong_FromUnsignedLong(header.width));
+    PyTuple_SET_ITEM(dimensions, 1, PyLong_FromUnsignedLong(header.height));
+    return dimensions;
+}
+static PyMethodDef reader_methods[] = {
+    {"next_chunk", reader_next_chunk, METH_NOARGS, nullptr},
+    {"dimensions", reader_dimensions, METH_NOARGS, nullptr},
+    {nullptr, nullptr, 0, nullptr},
+};
+static int reader_init(PyObject* self, PyObject* args, PyObject*) {
+    auto current = reinterpret_cast<reader*>(self);
+    PyObject* path;
+    Py_ssize_t chunk_events;
+    unsigned long long chunk_duration;
+    unsigned long long begin_t;
+    unsigned long long end_t;
+    int columns;
+    Py_ssize_t prefetch;
+    if (!PyArg_ParseTuple(
+            args, "OnKKKpn", &path, &chunk_events, &chunk_duration, &begin_t, &end_t, &columns, &prefetch)) {
+        return -1;
+    }
+    try {
+        if (chunk_events < 0 || prefetch < 1) {
+            throw std::runtime_error("chunk_events must be positive or zero, and prefetch must be larger than zero");
+        }
+        const auto filename = python_path_to_string(path);
+        current->data = new reader_data;
+        current->data->columns = columns != 0;
+        current->data->pool = std::make_shared<packet_pool>(packets_pool_capacity);
+        current->data->reader = sepia::es::make_reader<packet>(
+            filename,
+            make_packet{current->data->pool},
+            push_to_packet{current->data->columns},
+            static_cast<std::size_t>(chunk_events),
+            chunk_duration,
+            begin_t,
+            end_t,
+            static_cast<std::size_t>(prefetch));
+    } catch (const std::exception& exception) {
+        PyErr_SetString(PyExc_RuntimeError, exception.what());
+        return -1;
+    }
+    return 0;
+}
+static PyTypeObject reader_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+/// subscriber reads the events published by a camera in another process (see common/shared_ring.hpp).
+struct subscriber_data {
+    bool columns;
+    std::shared_ptr<packet_pool> pool;
+#ifndef _WIN32
+    std::unique_ptr<sepia::shared_ring::reader> reader;
+#endif
+    std::vector<sepia::dvs_event> events;
+};
+struct subscriber {
+    PyObject_HEAD subscriber_data* data;
+};
+static void subscriber_dealloc(PyObject* self) {
+    auto current = reinterpret_cast<subscriber*>(self);
+    if (current->data) {
+        delete current->data;
+        current->data = nullptr;
+    }
+    Py_TYPE(self)->tp_free(self);
+}
+static PyObject* subscriber_new(PyTypeObject* type, PyObject*, PyObject*) {
+    return type->tp_alloc(type, 0);
+}
+static PyMemberDef subscriber_members[] = {
+    {nullptr, 0, 0, 0, nullptr},
+};
+#ifndef _WIN32
+static PyObject* subscriber_next_packet(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<subscriber*>(self);
+    auto events = current->data->pool->acquire();
+    current->data->events.clear();
+    current->data->reader->read(current->data->events);
+    for (const auto& event : current->data->events) {
+        events.push(event, current->data->columns);
+    }
+    return packet_to_object(std::move(events), current->data->columns, current->data->pool);
+}
+static PyObject* subscriber_lost(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<subscriber*>(self);
+    return PyLong_FromUnsignedLongLong(current->data->reader->lost());
+}
+static PyObject* subscriber_dimensions(PyObject* self, PyObject* args) {
+    auto current = reinterpret_cast<subscriber*>(self);
+    PyObject* dimensions = PyTuple_New(2);
+    PyTuple_SET_ITEM(dimensions, 0, PyLong_FromUnsignedLong(current->data->reader->width()));
+    PyTuple_SET_ITEM(dimensions, 1, PyLong_FromUnsignedLong(current->data->reader->height()));
+    return dimensions;
+}
+#endif
+static PyMethodDef subscriber_methods[] = {
+#ifndef _WIN32
+    {"next_packet", subscriber_next_packet, METH_NOARGS, nullptr},
+    {"lost", subscriber_lost, METH_NOARGS, nullptr},
+    {"dimensions", subscriber_dimensions, METH_NOARGS, nullptr},
+#endif
+    {nullptr, nullptr, 0, nullptr},
+};
+static int subscriber_init(PyObject* self, PyObject* args, PyObject*) {
+    auto current = reinterpret_cast<subscriber*>(self);
+    const char* name;
+    int from_oldest;
+    int columns;
+    if (!PyArg_ParseTuple(args, "spp", &name, &from_oldest, &columns)) {
+        return -1;
+    }
+    try {
+#ifdef _WIN32
+        throw std::runtime_error("shared rings are not supported on Windows");
+#else
+        current->data = new subscriber_data;
+        current->data->columns = columns != 0;
+        current->data->pool = std::make_shared<packet_pool>(packets_pool_capacity);
+        current->data->reader = sepia::make_unique<sepia::shared_ring::reader>(name, from_oldest != 0);
+#endif
+    } catch (const std::exception& exception) {
+        PyErr_SetString(PyExc_RuntimeError, exception.what());
+        return -1;
+    }
+    return 0;
+}
+static PyTypeObject subscriber_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static PyObject* build_index(PyObject*, PyObject* args) {
+    PyObject* path;
+    unsigned long long period;
+    if (!PyArg_ParseTuple(args, "OK", &path, &period)) {
+        return nullptr;
+    }
+    try {
+        const auto filename = python_path_to_string(path);
+        std::exception_ptr exception;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            sepia::es::write_index(filename, period);
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        Py_END_ALLOW_THREADS
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        Py_RETURN_NONE;
+    } catch (const std::exception& exception) {
+        PyErr_SetString(PyExc_RuntimeError, exception.what());
+        return nullptr;
+    }
+    return nullptr;
+}
+
 static PyObject* system_timestamp_now(PyObject*, PyObject*) {
     return PyLong_FromUnsignedLongLong(sepia::system_timestamp_now());
 }
@@ -536,6 +1927,7 @@ static PyMethodDef evk4_extension_methods[] = {
      system_timestamp_now,
      METH_NOARGS,
      "returns a monotonic arbitrary time representation in nanoseconds"},
+    {"build_index", build_index, METH_VARARGS, "writes an index next to an Event Stream file"},
     {nullptr, nullptr, 0, nullptr}};
 static struct PyModuleDef evk4_extension_definition = {
     PyModuleDef_HEAD_INIT,
@@ -556,5 +1948,38 @@ PyMODINIT_FUNC PyInit_evk4_extension() {
     camera_type.tp_init = camera_init;
     PyType_Ready(&camera_type);
     PyModule_AddObject(module, "Camera", (PyObject*)&camera_type);
+    PyStructSequence_InitType(&columns_type, &columns_description);
+    Py_INCREF(&columns_type);
+    PyModule_AddObject(module, "Columns", (PyObject*)&columns_type);
+    accumulator_type.tp_name = "evk4_extension.Accumulator";
+    accumulator_type.tp_basicsize = sizeof(accumulator);
+    accumulator_type.tp_dealloc = accumulator_dealloc;
+    accumulator_type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
+    accumulator_type.tp_methods = accumulator_methods;
+    accumulator_type.tp_members = accumulator_members;
+    accumulator_type.tp_new = accumulator_new;
+    accumulator_type.tp_init = accumulator_init;
+    PyType_Ready(&accumulator_type);
+    PyModule_AddObject(module, "Accumulator", (PyObject*)&accumulator_type);
+    reader_type.tp_name = "evk4_extension.Reader";
+    reader_type.tp_basicsize = sizeof(reader);
+    reader_type.tp_dealloc = reader_dealloc;
+    reader_type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
+    reader_type.tp_methods = reader_methods;
+    reader_type.tp_members = reader_members;
+    reader_type.tp_new = reader_new;
+    reader_type.tp_init = reader_init;
+    PyType_Ready(&reader_type);
+    PyModule_AddObject(module, "Reader", (PyObject*)&reader_type);
+    subscriber_type.tp_name = "evk4_extension.Subscriber";
+    subscriber_type.tp_basicsize = sizeof(subscriber);
+    subscriber_type.tp_dealloc = subscriber_dealloc;
+    subscriber_type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
+    subscriber_type.tp_methods = subscriber_methods;
+    subscriber_type.tp_members = subscriber_members;
+    subscriber_type.tp_new = subscriber_new;
+    subscriber_type.tp_init = subscriber_init;
+    PyType_Ready(&subscriber_type);
+    PyModule_AddObject(module, "Subscriber", (PyObject*)&subscriber_type);
     return module;
 }
@@ -26,7 +26,7 @@ libraries = []
 if sys.platform == "linux":
     extra_compile_args += ["-std=c++17", "-O3"]
     extra_link_args += ["-std=c++17", "-O3"]
-    libraries += ["usb-1.0"]
+    libraries += ["usb-1.0", "rt"]
 elif sys.platform == "darwin":
     os.environ[
         "LDFLAGS"
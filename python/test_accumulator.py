@@ -0,0 +1,25 @@
+import pathlib
+import evk4
+import time
+
+dirname = pathlib.Path(__file__).resolve().parent
+
+camera = evk4.Camera(
+    recordings_path=dirname / "recordings",
+    log_path=dirname / "recordings" / "log.jsonl",
+)
+accumulator = evk4.Accumulator(
+    representation="time_surface",
+    window_mode="duration",
+    window=20000,
+    tau=10000.0,
+)
+
+while True:
+    events = camera.next_packet()
+    for frame in accumulator.push(events):
+        print(
+            f"{frame.begin_t=}, {frame.end_t=}, {frame.values.shape=}, {frame.values.max()=}"
+        )
+    if len(events) == 0:
+        time.sleep(0.1)
@@ -0,0 +1,14 @@
+import pathlib
+import sys
+import evk4
+
+path = pathlib.Path(sys.argv[1])
+
+# build_index is optional, it lets the reader skip the events before begin
+evk4.build_index(path, period=100000)
+
+reader = evk4.Reader(path, duration=10000, begin=1000000, end=2000000)
+print(f"{reader.width} x {reader.height}")
+for chunk in reader:
+    # chunks have the same layout as Camera packets (columns=True returns evk4.Columns)
+    print(f"t = [{chunk['t'][0]}, {chunk['t'][-1]}], events = {len(chunk)}")
@@ -0,0 +1,16 @@
+import pathlib
+import evk4
+import time
+
+dirname = pathlib.Path(__file__).resolve().parent
+
+# the camera publishes events once, regardless of the number of subscribers (see test_subscriber.py)
+camera = evk4.Camera(
+    recordings_path=dirname / "recordings",
+    log_path=dirname / "recordings" / "log.jsonl",
+    packets=False,
+    shared_ring="evk4",
+)
+
+while True:
+    time.sleep(1.0)
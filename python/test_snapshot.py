@@ -0,0 +1,21 @@
+import pathlib
+import evk4
+import time
+
+dirname = pathlib.Path(__file__).resolve().parent
+
+# packets=False: events are reduced in the decoding thread and never copied to Python
+camera = evk4.Camera(
+    recordings_path=dirname / "recordings",
+    log_path=dirname / "recordings" / "log.jsonl",
+    frames=("count", "time_surface", "polarity"),
+    tau=10000.0,
+    packets=False,
+)
+
+while True:
+    time.sleep(1.0 / 30.0)
+    snapshot = camera.snapshot()
+    print(
+        f"{snapshot.t=}, {snapshot.count.sum()=}, {snapshot.time_surface.max()=}, {(snapshot.polarity > 0).sum()=}"
+    )
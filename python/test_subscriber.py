@@ -0,0 +1,10 @@
+import time
+import evk4
+
+# run python3 test_shared_ring.py first (or any script that creates a camera with shared_ring="evk4")
+subscriber = evk4.Subscriber("evk4")
+
+while True:
+    events = subscriber.next_packet()
+    print(f"events = {len(events)}, lost = {subscriber.lost()}")
+    time.sleep(0.1)
@@ -0,0 +1,25 @@
+import pathlib
+import evk4
+
+dirname = pathlib.Path(__file__).resolve().parent
+
+camera = evk4.Camera(
+    recordings_path=dirname / "recordings",
+    log_path=dirname / "recordings" / "log.jsonl",
+    packets=False,
+)
+
+rows = camera.sweep(
+    axes={"diff_on": range(90, 160, 10), "diff_off": range(40, 90, 10)},
+    base=evk4.Parameters(biases=evk4.Biases()),
+    settle=0.5,
+    duration=1.0,
+)
+
+# keep the settings that fit in a 5 Mev/s budget, with the fewest events from hot pixels
+budget = [row for row in rows if row.peak_buffer_rate < 5e6]
+for row in sorted(budget, key=lambda row: (row.hot_pixel_share, row.event_rate)):
+    print(
+        f"{row.biases}: {row.event_rate / 1e6:.3f} Mev/s (peak {row.peak_buffer_rate / 1e6:.3f}), "
+        f"on ratio {row.on_ratio:.2f}, {row.hot_pixels} hot pixels ({row.hot_pixel_share * 100:.1f} % of events)"
+    )
@@ -0,0 +1,15 @@
+import pathlib
+import evk4
+
+dirname = pathlib.Path(__file__).resolve().parent
+
+camera = evk4.Camera(
+    recordings_path=dirname / "recordings",
+    log_path=dirname / "recordings" / "log.jsonl",
+)
+
+while True:
+    # wait_events blocks without the GIL until at least 100000 events are available (or 1 s elapsed)
+    # wait_packet(timeout) returns a single packet instead, timeout=None waits indefinitely
+    events = camera.wait_events(100000, 1.0)
+    print(f"events = {len(events)}, backlog = {camera.backlog()}")
@@ -1,6 +1,7 @@
 import dataclasses
 import pathlib
 import evk4_recorder_3d_extension
+import numpy
 import re
 import dataclasses
 
@@ -34,6 +35,17 @@ class RecordingStatus:
     size: int = 0
 
 
+@dataclasses.dataclass
+class Slice:
+    index: int
+    slot: int
+    end_t: int
+    on_events: numpy.ndarray
+    off_events: numpy.ndarray
+
+
+position_dtype = numpy.dtype([("position", numpy.float32, 3)])
+
 recording_name_pattern = re.compile(r"^[-\w .]+$")
 
 
@@ -76,3 +88,20 @@ class Camera(evk4_recorder_3d_extension.Camera):
     def recording_status(self):
         data = super().recording_status()
         return RecordingStatus(name=data[0], duration=data[1], size=data[2])
+
+    def new_slices(self, cursor: int) -> tuple[int, list[Slice]]:
+        """Returns the new cursor and the slices completed since cursor (0 or the value returned by the last call).
+
+        Events are (x, y, t modulo 2^32) positions, with the dtype expected by point_cloud.PointCloudVisual.push.
+        """
+        cursor, slices = super().new_slices(cursor)
+        return cursor, [
+            Slice(
+                index=index,
+                slot=slot,
+                end_t=end_t,
+                on_events=on_events.view(position_dtype).reshape(-1),
+                off_events=off_events.view(position_dtype).reshape(-1),
+            )
+            for index, slot, end_t, on_events, off_events in slices
+        ]
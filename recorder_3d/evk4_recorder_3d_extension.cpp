@@ -92,6 +92,7 @@ struct camera_data {
     std::unique_ptr<std::ofstream> jsonl_log;
     std::vector<slice> slices;
     std::size_t active_slice_index;
+    uint64_t completed_slices;
     std::unique_ptr<sepia::evk4::base_camera> base_camera;
 };
 struct camera {
@@ -206,8 +207,7 @@ static PyArrayObject* check_counts(PyObject* object) {
     if (!PyArray_ISONESEGMENT(counts)) {
         throw std::runtime_error("counts' memory must be contiguous");
     }
-    auto description = PyArray_DESCR(counts);
-    if (description->kind != 'u' || description->elsize != 8) {
+    if (PyArray_DESCR(counts)->kind != 'u' || PyArray_ITEMSIZE(counts) != 8) {
         throw std::runtime_error("counts' dtype must be numpy.uint64");
     }
     return counts;
@@ -328,11 +328,88 @@ static PyObject* update_points(PyObject* self, PyObject* args) {
     return nullptr;
 }
 
+/// slice_events_to_array copies the (x, y, t) triples of a slice to a new float32 array with shape (n, 3).
+static PyObject* slice_events_to_array(const std::vector<float>& events) {
+    npy_intp dimensions[2] = {static_cast<npy_intp>(events.size() / 3), 3};
+    auto array = PyArray_SimpleNew(2, dimensions, NPY_FLOAT32);
+    if (array && !events.empty()) {
+        std::memcpy(
+            PyArray_DATA(reinterpret_cast<PyArrayObject*>(array)), events.data(), events.size() * sizeof(float));
+    }
+    return array;
+}
+
+/// new_slices returns the slices completed since cursor (a value returned by a previous call, or 0).
+/// Slices are numbered from 0 in order of completion, and each slice is returned as (index, slot, end_t, on_events,
+/// off_events), where slot is its position in the ring. The ring keeps the last slices_count - 1 completed slices,
+/// hence slices older than that are skipped. The return value is (cursor, slices).
+static PyObject* new_slices(PyObject* self, PyObject* args) {
+    uint64_t cursor;
+    if (!PyArg_ParseTuple(args, "K", &cursor)) {
+        return nullptr;
+    }
+    auto current = reinterpret_cast<camera*>(self);
+    auto data = current->data;
+    auto slices = PyList_New(0);
+    if (!slices) {
+        return nullptr;
+    }
+    std::exception_ptr exception;
+    auto allocated = true;
+    while (data->accessing_camera.test_and_set(std::memory_order_acquire)) {
+    }
+    const auto completed = data->completed_slices;
+    if (data->exception) {
+        exception = data->exception;
+    } else {
+        const auto available = std::min(completed, static_cast<uint64_t>(data->slices.size() - 1));
+        for (auto index = std::max(cursor, completed - available); index < completed; ++index) {
+            const auto slot =
+                (data->active_slice_index + data->slices.size() - static_cast<std::size_t>(completed - index))
+                % data->slices.size();
+            // Py_BuildValue steals both arrays, hence they are checked first to avoid leaking one of them
+            auto on_events = slice_events_to_array(data->slices[slot].on_events);
+            auto off_events = slice_events_to_array(data->slices[slot].off_events);
+            if (!on_events || !off_events) {
+                Py_XDECREF(on_events);
+                Py_XDECREF(off_events);
+                allocated = false;
+                break;
+            }
+            auto item = Py_BuildValue(
+                "KnKNN", index, static_cast<Py_ssize_t>(slot), data->slices[slot].end_t, on_events, off_events);
+            if (!item || PyList_Append(slices, item) < 0) {
+                Py_XDECREF(item);
+                allocated = false;
+                break;
+            }
+            Py_DECREF(item);
+        }
+    }
+    data->accessing_camera.clear(std::memory_order_release);
+    if (!allocated) {
+        Py_DECREF(slices);
+        return nullptr;
+    }
+    try {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return Py_BuildValue("KN", completed, slices);
+    } catch (const std::exception& exception) {
+        Py_DECREF(slices);
+        PyErr_SetString(PyExc_RuntimeError, exception.what());
+        return nullptr;
+    }
+    return nullptr;
+}
+
 static PyMethodDef camera_methods[] = {
     {"set_parameters", set_parameters, METH_VARARGS, nullptr},
     {"record_to", record_to, METH_VARARGS, nullptr},
     {"recording_status", recording_status, METH_NOARGS, nullptr},
     {"update_points", update_points, METH_VARARGS, nullptr},
+    {"new_slices", new_slices, METH_VARARGS, nullptr},
     {nullptr, nullptr, 0, nullptr},
 };
 static int camera_init(PyObject* self, PyObject* args, PyObject*) {
@@ -364,6 +441,7 @@ static int camera_init(PyObject* self, PyObject* args, PyObject*) {
             slice.off_events.reserve(slice_initial_capacity * 3);
         }
         data->active_slice_index = 0;
+        data->completed_slices = 0;
         data->slices[data->active_slice_index].end_t = slice_duration;
         data->base_camera = sepia::evk4::make_camera(
             [slice_duration, slices_count, data](sepia::dvs_event event) {
@@ -373,6 +451,7 @@ static int camera_init(PyObject* self, PyObject* args, PyObject*) {
                     while (event.t >= data->slices[data->active_slice_index].end_t) {
                         const auto end_t = data->slices[data->active_slice_index].end_t;
                         data->active_slice_index = (data->active_slice_index + 1) % slices_count;
+                        ++data->completed_slices;
                         data->slices[data->active_slice_index].end_t = end_t + slice_duration;
                         data->slices[data->active_slice_index].on_events.clear();
                         data->slices[data->active_slice_index].off_events.clear();
@@ -401,7 +480,7 @@ static int camera_init(PyObject* self, PyObject* args, PyObject*) {
                 data->previous_t = event.t;
             },
             [](sepia::evk4::trigger_event) {},
-            [=]() {},
+            [=](std::size_t, std::size_t) { return true; },
             [=]() {
                 while (data->accessing_camera.test_and_set(std::memory_order_acquire)) {
                 }
@@ -452,9 +531,10 @@ static int camera_init(PyObject* self, PyObject* args, PyObject*) {
             "",
             std::chrono::milliseconds(100),
             64,
-            [=](std::size_t dropped_bytes) {
+            4096,
+            [=]() {
                 std::stringstream message;
-                message << "{\"utc_timestamp\":" << now() << ",\"type\":\"drop\",\"bytes\":" << dropped_bytes << "}\n";
+                message << "{\"utc_timestamp\":" << now() << ",\"type\":\"drop\"}\n";
                 const std::string message_string = message.str();
                 data->jsonl_log->write(message_string.data(), message_string.size());
                 data->jsonl_log->flush();
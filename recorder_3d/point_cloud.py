@@ -3,17 +3,26 @@ import vispy.color
 import vispy.gloo
 import vispy.visuals
 
+BIG_FLOAT = 1e10
+
 VERTEX_SHADER = """
 attribute vec3 position;
 uniform float base_point_size;
 uniform bool floor_timestamps;
 uniform float end_t;
+uniform float window;
 float big_float = 1e10;
 void main (void) {
+    float delta_t = position[2] - end_t;
+    if (delta_t > 0.0 || delta_t < -window) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        gl_PointSize = 0.0;
+        return;
+    }
     vec4 visual_position = vec4(
         position[0],
         position[1],
-        floor_timestamps ? (int(position[2] - end_t) / 10000) * 10000 : position[2] - end_t,
+        floor_timestamps ? (int(delta_t) / 10000) * 10000 : delta_t,
         1.0
     );
     vec4 framebuffer_position = $visual_to_framebuffer(visual_position);
@@ -57,6 +66,9 @@ class PointCloudVisual(vispy.visuals.Visual):
         self.base_point_size = base_point_size
         self.floor_timestamps = False
         self.end_t = 0.0
+        self.window = BIG_FLOAT
+        self.capacity = 0
+        self.written = 0
         self.set_color(color)
         self.update()
 
@@ -64,6 +76,30 @@ class PointCloudVisual(vispy.visuals.Visual):
         self.vbo.set_data(pos)
         self.shared_program.bind(self.vbo)
 
+    def allocate(self, capacity: int, window: float):
+        """Replaces the points with a ring of capacity points, filled with push.
+
+        Points older than end_t - window (in µs) are not drawn.
+        """
+        points = numpy.zeros(capacity, dtype=[("position", numpy.float32, 3)])
+        points["position"][:, 2] = -BIG_FLOAT
+        self.set_data(points)
+        self.capacity = capacity
+        self.written = 0
+        self.window = window
+
+    def push(self, points: numpy.ndarray):
+        """Uploads points after the previous ones, overwriting the oldest points once the ring is full."""
+        if len(points) > self.capacity:
+            points = points[len(points) - self.capacity :]
+        begin = self.written % self.capacity
+        first_count = min(len(points), self.capacity - begin)
+        if first_count > 0:
+            self.vbo.set_subdata(points[0:first_count], offset=begin)
+        if first_count < len(points):
+            self.vbo.set_subdata(points[first_count:], offset=0)
+        self.written += len(points)
+
     def _prepare_transforms(self, view):
         view.view_program.vert["visual_to_framebuffer"] = view.get_transform(
             "visual", "framebuffer"
@@ -83,6 +119,7 @@ class PointCloudVisual(vispy.visuals.Visual):
             view.view_program["base_point_size"] = self.base_point_size
             view.view_program["floor_timestamps"] = self.floor_timestamps
             view.view_program["end_t"] = self.end_t
+            view.view_program["window"] = self.window
         return True
 
     def set_color(self, color: numpy.ndarray):
@@ -61,11 +61,8 @@ class MyWindow(PyQt5.QtWidgets.QMainWindow, form_class):
         self.fps = fps
         self.w = 1280
         self.h = 720
-        self.on_events = np.zeros(2**20, dtype=[("position", np.float32, 3)])
-        self.off_events = np.zeros(2**20, dtype=[("position", np.float32, 3)])
-        self.counts = np.array(
-            [int(fps * self.time_window), 0, 0, 0, 0], dtype=np.uint64
-        )
+        self.capacity = 2**20  # points per polarity
+        self.cursor = 0
         self.space_scale = 1 / self.w  # GL coordinates / px
         self.time_scale = 1e-8  # GL coordinates / µs
         self.updateMatrix()
@@ -138,6 +135,8 @@ class MyWindow(PyQt5.QtWidgets.QMainWindow, form_class):
             base_point_size=1.05 * self.space_scale,
         )
         self.view.add(self.off)
+        self.on.allocate(self.capacity, window=self.time_window * 1e6)
+        self.off.allocate(self.capacity, window=self.time_window * 1e6)
         self.updateMatrix()
         self.on.transform = vispy.visuals.transforms.linear.MatrixTransform(
             matrix=self.matrix
@@ -161,9 +160,6 @@ class MyWindow(PyQt5.QtWidgets.QMainWindow, form_class):
             else:
                 self.next_update += self.frame_duration
                 if not self.paused:
-                    self.camera.update_points(
-                        self.on_events, self.off_events, self.counts
-                    )
                     self.redraw()
         else:
             # clean up and exit
@@ -182,11 +178,16 @@ class MyWindow(PyQt5.QtWidgets.QMainWindow, form_class):
         )
 
     def redraw(self):
-        end_t = float(self.counts[4])
+        # only the slices completed since the last frame are uploaded
+        self.cursor, slices = self.camera.new_slices(self.cursor)
+        if len(slices) == 0:
+            return
+        for slice in slices:
+            self.on.push(slice.on_events)
+            self.off.push(slice.off_events)
+        end_t = float(slices[-1].end_t & 0xFFFFFFFF)
         self.on.end_t = end_t
         self.off.end_t = end_t
-        self.on.set_data(self.on_events[0 : self.counts[1]])
-        self.off.set_data(self.off_events[0 : self.counts[2]])
         self.canvas.update()
 
     def setOnThreshold(self):